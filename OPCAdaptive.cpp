@@ -0,0 +1,256 @@
+//Optical Particle Counter Library
+
+//University of Minnesota - Candler MURI
+
+/*This is the definitions file for adaptive sampling.
+The change detector is an EWMA with a two-sided CUSUM, and each sensor goes
+between the slow and fast modes on its shifts. See OPCAdaptive.h for the details.*/
+
+#include "OPCAdaptive.h"
+
+
+
+//////////CHANGE DETECTOR//////////
+
+
+
+OPCChangeDetector::OPCChangeDetector(){
+	alpha = 0.01;
+	slack = 0.5;
+	threshold = 8;
+	minDeviation = 0.05;
+	settle = 10;
+	counting = false;
+	reset();
+}
+
+void OPCChangeDetector::setWeight(float weight){
+	if (weight < 0.0001) weight = 0.0001;								//A weight of 0 would never move the average
+	if (weight > 1) weight = 1;
+	alpha = weight;
+}
+
+void OPCChangeDetector::setLimits(float k, float h){
+	slack = k;
+	threshold = h;
+}
+
+void OPCChangeDetector::setFloor(float sd){ minDeviation = sd; }
+
+void OPCChangeDetector::setSettle(uint16_t samples){ settle = samples; }
+
+void OPCChangeDetector::setCounting(bool counts){ counting = counts; }
+
+void OPCChangeDetector::reset(){
+	mean = 0;
+	trend = 0;
+	var = 0;
+	high = 0;
+	low = 0;
+	n = 0;
+	last = 0;
+}
+
+void OPCChangeDetector::restart(){										//Keeps the trend and variance as a first guess
+	high = 0;
+	low = 0;
+	if (n) n = 1;
+}
+
+int8_t OPCChangeDetector::update(float value, float seconds){
+	if (seconds <= 0) seconds = 1;
+	if (n == 0){														//The first sample starts the average
+		mean = value;
+		n = 1;
+		return 0;
+	}
+	if (n == 1) mean = value - trend*seconds;							//First sample after a restart, start from the new level
+	n++;
+
+	float steady = alpha*seconds;										//Weights are per second, so the fast and slow periods age the average alike
+	if (steady > 1) steady = 1;
+	float weight = (1.0/n > steady) ? 1.0/n : steady;					//Plain averages until there are enough samples for the EWMA
+	float scale = counting ? sqrt(seconds) : 1;							//Counting noise falls with the square root of the sample length
+	float forecast = mean + trend*seconds;
+	float error = value - forecast;
+	float z = error*scale/getDeviation();								//Distance from the forecast, in standard deviations
+	mean = forecast + weight*error;
+	trend += 0.3*steady*error/seconds;									//Slow drifts, like the fall off with altitude, are followed and not found
+	var = (1 - weight)*(var + weight*error*error*scale*scale);			//Exponentially weighted variance, of a one second sample when counting
+	if (n <= settle) return 0;											//Still learning the average
+
+	high += z - slack;
+	low += -z - slack;
+	if (high < 0) high = 0;
+	if (low < 0) low = 0;
+	if (high < threshold && low < threshold) return 0;
+
+	last = (high >= threshold) ? 1 : -1;
+	restart();															//Start over from the new level, so a lasting shift is found once
+	return last;
+}
+
+float OPCChangeDetector::getMean(){ return mean; }
+
+float OPCChangeDetector::getDeviation(){
+	float deviation = sqrt(var);
+	float least = minDeviation;
+	if (counting && least < 0.5) least = 0.5;							//The square root of a one second count can not be steadier than this
+	return (deviation > least) ? deviation : least;
+}
+
+float OPCChangeDetector::getScore(){ return ((high > low) ? high : low)/threshold; }
+
+int8_t OPCChangeDetector::getLast(){ return last; }
+
+
+
+//////////ADAPTIVE SAMPLING//////////
+
+
+
+OPCAdaptive::OPCAdaptive(){
+	nSensors = 0;
+	hold = 60000;
+}
+
+bool OPCAdaptive::addSensor(OPC &sensor, unsigned long slowPeriod, unsigned long fastPeriod, uint8_t source){
+	if (nSensors >= OPC_ADAPT_MAX_SENSORS) return false;				//No room for another sensor
+
+	AdaptSensor &entry = sensors[nSensors++];
+	entry.sensor = &sensor;
+	entry.slowPeriod = slowPeriod;
+	entry.fastPeriod = fastPeriod;
+	entry.source = source;
+	entry.mode = OPC_ADAPT_SLOW;
+	entry.detector.reset();
+	entry.detector.setCounting(source == OPC_ADAPT_COUNTS);
+	entry.lastSample = 0;
+	entry.lastSeen = 0;
+	entry.nextDue = 0;
+	entry.lastShift = 0;
+	entry.modeStart = 0;
+	entry.fastTime = 0;
+	entry.shifts = 0;
+	entry.reads = 0;
+	return true;
+}
+
+void OPCAdaptive::setHold(unsigned long ms){ hold = ms; }
+
+void OPCAdaptive::begin(){
+	unsigned long now = millis();
+	for (uint8_t i = 0; i < nSensors; i++){
+		sensors[i].mode = OPC_ADAPT_SLOW;
+		sensors[i].modeStart = now;
+		sensors[i].nextDue = now;
+		if (sensors[i].source == OPC_ADAPT_MANUAL) continue;
+		sensors[i].lastSample = sensors[i].sensor->getSampleTime();		//Samples from before the start are not used
+		sensors[i].lastSeen = sensors[i].lastSample;
+	}
+}
+
+void OPCAdaptive::update(){
+	for (uint8_t i = 0; i < nSensors; i++){
+		AdaptSensor &entry = sensors[i];
+		unsigned long now = millis();
+
+		uint64_t sampleTime = entry.sensor->getSampleTime();
+		if (entry.source != OPC_ADAPT_MANUAL && sampleTime != entry.lastSeen){
+			entry.lastSeen = sampleTime;
+			float data[OPC_MAX_BINS];
+			uint8_t len = entry.sensor->getData(data, OPC_MAX_BINS);
+			if (len > 0){												//PM-only reads have no bins, and do not end a histogram
+				float total = 0;
+				for (uint8_t j = 0; j < len; j++) total += data[j];
+				if (total < 0) total = 0;
+
+				float seconds = entry.sensor->getSamplePeriod();		//The R1 and N3 report how long each histogram counted.
+				if (seconds <= 0 && entry.lastSample) seconds = (sampleTime - entry.lastSample)/1e6;	//Otherwise, the time since the last sample
+				entry.lastSample = sampleTime;
+
+				if (seconds > 0 && !entry.sensor->warmingUp()){			//The first sample may have no known length
+					float signal;
+					if (entry.source == OPC_ADAPT_COUNTS) signal = sqrt(total/seconds);	//Counts per second, so the slow and fast histograms match. The
+					else signal = log(1 + total);						//square root makes the counting noise the same at any concentration.
+					shift(entry, entry.detector.update(signal, seconds));
+				}
+			}
+		}
+
+		if (entry.mode == OPC_ADAPT_FAST && now - entry.lastShift >= hold){	//Quiet for the hold time, back to slow
+			entry.fastTime += now - entry.modeStart;
+			entry.mode = OPC_ADAPT_SLOW;
+			entry.modeStart = now;
+		}
+	}
+}
+
+void OPCAdaptive::shift(AdaptSensor &entry, int8_t direction){
+	if (!direction) return;
+	unsigned long now = millis();
+	entry.shifts++;
+	entry.lastShift = now;
+	if (entry.mode == OPC_ADAPT_FAST) return;							//Already fast, the hold starts over
+
+	entry.mode = OPC_ADAPT_FAST;
+	entry.modeStart = now;
+	if ((long)(entry.nextDue - now) > (long)entry.fastPeriod) entry.nextDue = now;	//Read right away instead of waiting out the slow period
+}
+
+bool OPCAdaptive::due(uint8_t index){
+	if (index >= nSensors) return false;
+	AdaptSensor &entry = sensors[index];
+	unsigned long now = millis();
+	if ((long)(now - entry.nextDue) < 0) return false;
+
+	unsigned long period = getPeriod(index);
+	entry.nextDue += period;
+	if ((long)(now - entry.nextDue) >= 0) entry.nextDue = now + period;	//A long block skips the reads it missed
+	entry.reads++;
+	return true;
+}
+
+int8_t OPCAdaptive::feed(uint8_t index, float value){
+	if (index >= nSensors) return 0;
+	AdaptSensor &entry = sensors[index];
+	uint64_t now = opcMicros();
+	float seconds = entry.lastSample ? (now - entry.lastSample)/1e6 : 1;
+	entry.lastSample = now;
+	int8_t direction = entry.detector.update(log(1 + ((value > 0) ? value : 0)), seconds);
+	shift(entry, direction);
+	return direction;
+}
+
+OPCChangeDetector &OPCAdaptive::getDetector(uint8_t index){
+	static OPCChangeDetector unused;									//Out of range indexes get a detector that is not in use
+	if (index >= nSensors) return unused;
+	return sensors[index].detector;
+}
+
+uint8_t OPCAdaptive::getMode(uint8_t index){
+	if (index >= nSensors) return OPC_ADAPT_SLOW;
+	return sensors[index].mode;
+}
+
+unsigned long OPCAdaptive::getPeriod(uint8_t index){
+	if (index >= nSensors) return 0;
+	return (sensors[index].mode == OPC_ADAPT_FAST) ? sensors[index].fastPeriod : sensors[index].slowPeriod;
+}
+
+unsigned long OPCAdaptive::getFastTime(uint8_t index){
+	if (index >= nSensors) return 0;
+	AdaptSensor &entry = sensors[index];
+	if (entry.mode == OPC_ADAPT_FAST) return entry.fastTime + (millis() - entry.modeStart);	//Include the time in the current stretch
+	return entry.fastTime;
+}
+
+uint32_t OPCAdaptive::getShifts(uint8_t index){
+	if (index >= nSensors) return 0;
+	return sensors[index].shifts;
+}
+
+uint32_t OPCAdaptive::getReads(uint8_t index){
+	if (index >= nSensors) return 0;
+	return sensors[index].reads;
+}
@@ -0,0 +1,122 @@
+//Optical Particle Counter Library
+
+//University of Minnesota - Candler MURI
+
+/*This is the header file for adaptive sampling.
+Clouds and aerosol layers pass by in tens of seconds during the ascent, but
+most of the flight is in clean, slowly changing air. An OPCAdaptive object
+reads each sensor slowly in clean air, and quickly while the concentration is
+changing, so the same storage and power budget buys more resolution in the
+layers that matter.
+
+Each sensor has a change detector (OPCChangeDetector) on its concentration.
+The detector keeps an exponentially weighted moving average (EWMA) of the
+signal, with a slow trend so the fall off with altitude is followed, and of
+the variance of its forecast error. A two-sided cumulative sum (CUSUM) adds up
+how far each sample is from the forecast, in standard deviations. Small random
+steps are eaten by the slack, while a lasting shift builds up the sum until
+it crosses the threshold. After each shift, the average is learned again from
+the new samples.
+
+The signal is the log of the total concentration from .getData(), so the same
+relative step is found at the ground and at 30 km. Histogram counts (R1, N3)
+are turned into counts per second, and their square root is used instead,
+which has the same counting noise at any concentration. The detector is told
+how long each sample is, so its averages age the same in either period, and
+the noise of a short histogram is weighed against a long one fairly.
+
+When a shift is found, the sensor goes to its fast period right away, and
+stays there until no shift has been found for the hold time. In the slow
+period, the Alphasense histograms count over the whole period, so a slow log
+is an aggregate of the air in between and not a single snapshot.
+*/
+
+
+#ifndef OPCAdaptive_h
+#define OPCAdaptive_h
+
+#include "OPCSensor.h"
+#include "OPCBins.h"
+
+#define OPC_ADAPT_MAX_SENSORS 5											//Most sensors in one schedule
+#define OPC_ADAPT_SLOW 0												//Sampling modes
+#define OPC_ADAPT_FAST 1
+#define OPC_ADAPT_CONCENTRATION 0										//Signal sources: the sum of .getData() as it is
+#define OPC_ADAPT_COUNTS 1												//The sum of .getData() per second between samples (histogram counts)
+#define OPC_ADAPT_MANUAL 2												//Values given to .feed(), such as a PM value
+
+
+
+class OPCChangeDetector
+{
+	private:
+	float alpha;														//EWMA weight of each second of samples
+	float slack;														//CUSUM slack (standard deviations)
+	float threshold;													//CUSUM threshold (standard deviations)
+	float minDeviation;													//Smallest standard deviation used
+	uint16_t settle;													//Samples used to learn the average before shifts are found
+	float mean, trend, var;												//Level, change per second, and variance of the forecast error
+	bool counting;														//Noise falls with the length of the sample
+	float high, low;													//Cumulative sums of upward and downward steps
+	uint32_t n;
+	int8_t last;														//Direction of the last shift
+
+	public:
+	OPCChangeDetector();
+	void setWeight(float weight);										//EWMA weight of each second, 0 to 1 (default .01)
+	void setLimits(float k, float h);									//CUSUM slack and threshold in standard deviations (default .5 and 8)
+	void setFloor(float sd);											//Smallest standard deviation, so a flat signal does not trip on one count (default .05)
+	void setSettle(uint16_t samples);									//Samples before shifts are found (default 10)
+	void setCounting(bool counts);										//True if the samples are the square root of counts per second. The floor is then at least .5.
+	int8_t update(float value, float seconds = 1);						//Sample and its length. Returns 1 for an upward shift, -1 for a downward shift, and 0 for none
+	void reset();
+	void restart();														//Learn the average again from the next sample
+	float getMean();
+	float getDeviation();
+	float getScore();													//Larger of the two sums, over the threshold. A shift is found at 1.
+	int8_t getLast();
+};
+
+
+
+class OPCAdaptive
+{
+	private:
+	struct AdaptSensor{
+		OPC *sensor;
+		unsigned long slowPeriod;										//Time between reads in clean air (ms)
+		unsigned long fastPeriod;										//Time between reads during a shift (ms)
+		uint8_t source;													//OPC_ADAPT_* signal source
+		uint8_t mode;
+		OPCChangeDetector detector;
+		uint64_t lastSample;											//Time of the last sample with bins (us)
+		uint64_t lastSeen;												//Time of the last sample looked at, with bins or not (us)
+		unsigned long nextDue;											//Time of the next read
+		unsigned long lastShift;										//Time of the last shift
+		unsigned long modeStart;										//Time the current mode began
+		unsigned long fastTime;											//Total time in the fast mode (ms)
+		uint32_t shifts;												//Number of shifts found
+		uint32_t reads;													//Number of reads asked for by .due()
+	} sensors[OPC_ADAPT_MAX_SENSORS];
+
+	uint8_t nSensors;
+	unsigned long hold;													//Time to stay fast after the last shift (ms)
+	void shift(AdaptSensor &entry, int8_t direction);
+
+	public:
+	OPCAdaptive();
+	bool addSensor(OPC &sensor, unsigned long slowPeriod, unsigned long fastPeriod, uint8_t source = OPC_ADAPT_CONCENTRATION);
+	void setHold(unsigned long ms);										//Time to stay fast after the last shift, in milliseconds (default 60000)
+	void begin();														//Start every sensor in the slow mode, due now
+	void update();														//Give new samples to the detectors and change modes. Call from the loop.
+	bool due(uint8_t index);											//True once per period. Read or log the sensor when it is.
+	int8_t feed(uint8_t index, float value);							//Give a value to a detector yourself, for OPC_ADAPT_MANUAL
+	OPCChangeDetector &getDetector(uint8_t index);						//To tune the detector of a sensor
+	uint8_t getMode(uint8_t index);										//OPC_ADAPT_* mode of a sensor
+	unsigned long getPeriod(uint8_t index);								//Current time between reads (ms)
+	unsigned long getFastTime(uint8_t index);							//Total time in the fast mode (ms)
+	uint32_t getShifts(uint8_t index);
+	uint32_t getReads(uint8_t index);
+};
+
+#endif
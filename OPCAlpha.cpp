@@ -0,0 +1,64 @@
+//Optical Particle Counter Library
+
+//University of Minnesota - Candler MURI
+
+/*This is the definitions file for the SPI transfer of the Alphasense
+sensors. The R1 and N3 use the same handshake, so it is only compiled in
+when at least one of them is.*/
+
+#include "OPCSensor.h"
+
+#if OPC_USE_R1 || OPC_USE_N3
+#include <SPI.h>
+
+
+
+//////////ALPHASENSE//////////
+
+
+
+bool OPC::alphaRead(uint8_t cs, uint32_t speed, byte command, byte *data, uint8_t len, uint64_t &arrival){	//The command byte is sent until the
+	byte byte1 = 0x00;													//busy and then ready bytes come back, then the data is clocked out.
+	byte byte2 = 0x00; 
+	bool success = false;
+	if (!claimSPI()) return false;										//Another sensor is in the middle of a polled handshake
+																		//Open data translation
+	SPI.beginTransaction(SPISettings(speed, MSBFIRST, SPI_MODE1));
+	digitalWrite(cs,LOW);
+
+	for (unsigned short bail = 0; !success && (bail < 25); bail++){		//Make 25 attempts to make contact as fast as possible
+		if (bail > 0) delay(10);										//The sensor needs time between handshake bytes, but not before the first
+		byte1 = byte2;
+		byte2 = SPI.transfer(command);
+		success = ((byte1 == 0x31)&&(byte2 == 0xF3));					//The busy and then active byte indicates success
+	}
+
+	if (success){														//Pull the data from the system
+		for (uint8_t i = 0; i < len; i++){
+			delayMicroseconds(10);
+			data[i] = SPI.transfer(0x00);
+		}
+		arrival = opcMicros();											//The transfer is complete once the last byte is clocked in
+	}
+
+	digitalWrite(cs, HIGH); 	 
+	SPI.endTransaction();
+	releaseSPI();
+	return success;
+}
+
+uint32_t OPC::alphaPMQuality(float pm1, float pm2_5, float pm10){		//Each PM value holds the smaller sizes, so none can be under a smaller one
+	return ((pm1 <= pm2_5) && (pm2_5 <= pm10)) ? 0 : OPC_FLAG_RANGE;	//A NaN fails too
+}
+
+bool OPC::alphaCheckPM(uint32_t quality){								//PM-only frames have no counts or timing words, so steady air repeats
+	if (frameFlags & OPC_FLAG_STALE){									//them for as long as it lasts. They are not hashed, and are only stale
+		staleFrames++;													//while the last histogram was, which also leaves the repeats of the
+		return false;													//histograms alone.
+	}
+	frameFlags = quality;
+	if (quality) suspectFrames++;
+	return true;
+}
+
+#endif
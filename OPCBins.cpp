@@ -0,0 +1,38 @@
+//Optical Particle Counter Library
+
+//University of Minnesota - Candler MURI
+
+/*This is the definitions file for the bin layouts of the supported sensors.*/
+
+#include "OPCBins.h"
+
+
+
+//////////LAYOUTS//////////
+
+
+
+static const float plantowerEdges[7] = {0.3, 0.5, 1.0, 2.5, 5.0, 10.0, 20.0};	//The 10um channel is open ended, so it is given a nominal top edge
+static const float spsEdges[6] = {0.3, 0.5, 1.0, 2.5, 4.0, 10.0};
+static const float r1Edges[17] = {0.4, 0.7, 1.1, 1.5, 1.9, 2.4, 3.0, 4.0, 5.0, 6.0, 7.0, 8.0, 9.0, 10.0, 11.0, 12.0, 12.4};
+static const float n3Edges[25] = {0.35, 0.46, 0.66, 1.0, 1.3, 1.7, 2.3, 3.0, 4.0, 5.2, 6.5, 8.0, 10.0,
+								  12.0, 14.0, 16.0, 18.0, 20.0, 22.0, 25.0, 28.0, 31.0, 34.0, 37.0, 40.0};
+
+const OPCBinLayout OPC_LAYOUT_PLANTOWER = {OPC_TYPE_PLANTOWER, 6, OPC_BINS_ABOVE, plantowerEdges};
+const OPCBinLayout OPC_LAYOUT_SPS = {OPC_TYPE_SPS, 5, OPC_BINS_BELOW, spsEdges};
+const OPCBinLayout OPC_LAYOUT_R1 = {OPC_TYPE_R1, 16, OPC_BINS_DIFFERENTIAL, r1Edges};
+const OPCBinLayout OPC_LAYOUT_N3 = {OPC_TYPE_N3, 24, OPC_BINS_DIFFERENTIAL, n3Edges};
+
+void opcDifferential(const OPCBinLayout &layout, const float *bins, float *counts){
+	uint8_t n = layout.nBins;
+
+	if (layout.form == OPC_BINS_ABOVE){									//Counts at or above each size
+		for (uint8_t i = 0; i < n - 1; i++) counts[i] = bins[i] - bins[i + 1];
+		counts[n - 1] = bins[n - 1];
+	} else if (layout.form == OPC_BINS_BELOW){							//Counts from the bottom up to each size
+		counts[0] = bins[0];
+		for (uint8_t i = 1; i < n; i++) counts[i] = bins[i] - bins[i - 1];
+	} else {
+		for (uint8_t i = 0; i < n; i++) counts[i] = bins[i];
+	}
+}
@@ -0,0 +1,42 @@
+//Optical Particle Counter Library
+
+//University of Minnesota - Candler MURI
+
+/*This is the header file for the bin layouts of the supported sensors.
+Every OPC reports its sizes differently. The R1 and N3 report a count for each
+bin. The Plantower reports the counts at or above each size, and the SPS 30
+reports the concentration from .3 microns up to each size. A layout gives the
+bin edges and the form of the bins, so the other modules can turn any of them
+into plain per-bin counts.
+
+It has no Arduino dependencies, so it can also be used on a computer.
+*/
+
+
+#ifndef OPCBins_h
+#define OPCBins_h
+
+#include <stdint.h>
+#include "OPCRecord.h"
+
+#define OPC_MAX_BINS 24													//Most bins of any layout (N3)
+
+#define OPC_BINS_DIFFERENTIAL 0											//Each bin holds only its own particles
+#define OPC_BINS_ABOVE 1												//Each bin holds its particles and every bin above it (Plantower)
+#define OPC_BINS_BELOW 2												//Each bin holds its particles and every bin below it (SPS 30)
+
+struct OPCBinLayout{													//Describes the bins of one sensor
+	uint8_t type;														//Sensor type (OPC_TYPE_*)
+	uint8_t nBins;														//Number of bins
+	uint8_t form;														//OPC_BINS_* form of the reported bins
+	const float *edges;													//Bin edges in microns, nBins + 1 of them
+};
+
+extern const OPCBinLayout OPC_LAYOUT_PLANTOWER;							//Layouts for the supported sensors
+extern const OPCBinLayout OPC_LAYOUT_SPS;
+extern const OPCBinLayout OPC_LAYOUT_R1;
+extern const OPCBinLayout OPC_LAYOUT_N3;
+
+void opcDifferential(const OPCBinLayout &layout, const float *bins, float *counts);	//Turn reported bins into counts for each bin alone
+
+#endif
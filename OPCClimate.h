@@ -0,0 +1,40 @@
+//Optical Particle Counter Library
+
+//University of Minnesota - Candler MURI
+
+/*This is the header file for the temperature and humidity conversions.
+The R1 and N3 send the temperature and humidity of their sample air as the
+raw 16 bit words of their sensor. The data structs keep those words as they
+came (tempRaw and humidRaw), so nothing is lost, and these turn them into
+values:
+ - temperature: -45 + 175*raw/65535 degrees C
+ - humidity: 100*raw/65535 percent RH
+
+The fixed point versions are centi-degrees (-4500 to 13000) and per-mille RH
+(0 to 1000), worked out with one integer multiply and divide, rounded to the
+nearest. They are what the CSV logs print. The float versions are single
+precision, with no double math.
+
+They have no Arduino dependencies, so the same code can convert the raw
+words of a binary log on a computer.
+*/
+
+
+#ifndef OPCClimate_h
+#define OPCClimate_h
+
+#include <stdint.h>
+
+inline int16_t opcCentiDegrees(uint16_t raw){							//Temperature in hundredths of a degree C
+	return (int16_t)(((uint32_t)raw*17500 + 32767)/65535) - 4500;
+}
+
+inline uint16_t opcPerMille(uint16_t raw){								//Relative humidity in tenths of a percent
+	return ((uint32_t)raw*1000 + 32767)/65535;
+}
+
+inline float opcCelsius(uint16_t raw){ return -45.0f + raw*(175.0f/65535.0f); }
+
+inline float opcHumidity(uint16_t raw){ return raw*(100.0f/65535.0f); }	//Percent RH
+
+#endif
@@ -0,0 +1,79 @@
+//Optical Particle Counter Library
+
+//University of Minnesota - Candler MURI
+
+/*This is the build configuration of the library. Change it here, or define
+the same names in the compiler flags.
+
+Each sensor is its own translation unit, and only the ones turned on below
+are compiled. A payload that flies one Plantower sets the others to 0, and
+drops their code along with SPI (R1 and N3) and i2c_t3 (the SPS on I2C).
+The optional features are the serial readout (.logReadout() and
+.setConsole()), the SPS I2C transport, and the reset that power cycles a
+sensor whose last good log is too old. extras/size/opcsize.sh reports the
+flash and RAM of each part.
+
+OPC_STATIC_RAM leaves every String function out of the sensor classes:
+.CSVHeader(), .logUpdate(), and .logReadout(name). What is left writes into
+buffers the caller gives it (.CSVHeader(buffer, length), .logLine(buffer,
+length), .logReadout(name, buffer, length), and .logBinary(buffer,
+length)), so after .initOPC() the sensors never use the heap. A sketch that
+still calls a String function will not compile, which is the point.
+
+In the same mode, the size of every sensor object is checked against a RAM
+budget when the library is compiled. The defaults below are the sizes on
+the Teensy 3.5/3.6, so a change that makes a sensor bigger stops the build
+until its budget is raised on purpose. Lower a budget to hold a deployment
+to it. A sensor also uses stack while it logs: up to OPC_READOUT_SIZE bytes
+(OPCText.h) for a readout, and nothing more for the other logs.
+*/
+
+
+#ifndef OPCConfig_h
+#define OPCConfig_h
+
+#ifndef OPC_USE_PLANTOWER												//Sensors to compile, 1 or 0
+#define OPC_USE_PLANTOWER 1
+#endif
+#ifndef OPC_USE_SPS
+#define OPC_USE_SPS 1
+#endif
+#ifndef OPC_USE_R1
+#define OPC_USE_R1 1
+#endif
+#ifndef OPC_USE_HPM
+#define OPC_USE_HPM 1
+#endif
+#ifndef OPC_USE_N3
+#define OPC_USE_N3 1
+#endif
+
+#ifndef OPC_USE_READOUT													//Optional features, 1 or 0
+#define OPC_USE_READOUT 1												//.logReadout() and .setConsole()
+#endif
+#ifndef OPC_USE_SPS_I2C
+#define OPC_USE_SPS_I2C 1												//The I2C constructor of the SPS, which needs i2c_t3
+#endif
+#ifndef OPC_USE_RESET
+#define OPC_USE_RESET 1													//Power cycle a sensor after .setReset() time with no good log
+#endif
+
+//#define OPC_STATIC_RAM												//No Strings in the sensor classes, and RAM budgets checked
+
+#ifndef OPC_RAM_PLANTOWER												//RAM budgets of each sensor object (bytes)
+#define OPC_RAM_PLANTOWER 264
+#endif
+#ifndef OPC_RAM_SPS
+#define OPC_RAM_SPS 408
+#endif
+#ifndef OPC_RAM_R1
+#define OPC_RAM_R1 456
+#endif
+#ifndef OPC_RAM_HPM
+#define OPC_RAM_HPM 224
+#endif
+#ifndef OPC_RAM_N3
+#define OPC_RAM_N3 440
+#endif
+
+#endif
@@ -0,0 +1,67 @@
+//Optical Particle Counter Library
+
+//University of Minnesota - Candler MURI
+
+/*This is the definitions file for the console readout.
+The queue is a ring, so a readout may be split across the end of the buffer.
+.service() writes the two pieces as separate writes.*/
+
+#include "OPCConsole.h"
+
+
+
+//////////CONSOLE//////////
+
+
+
+OPCConsole::OPCConsole(Print &out){
+	port = &out;
+	head = 0;
+	count = 0;
+	highWater = 0;
+	written = 0;
+	dropped = 0;
+}
+
+bool OPCConsole::write(const char *text, uint16_t len){
+	if (len > OPC_CONSOLE_SIZE - count){								//Backpressure: drop the whole readout, never part of one
+		dropped++;
+		return false;
+	}
+	uint16_t tail = (head + count)%OPC_CONSOLE_SIZE;
+	uint16_t first = OPC_CONSOLE_SIZE - tail;							//Room before the queue wraps
+	if (first > len) first = len;
+	memcpy(&queue[tail], text, first);
+	memcpy(queue, text + first, len - first);
+	count += len;
+	if (count > highWater) highWater = count;
+	written++;
+	return true;
+}
+
+bool OPCConsole::write(OPCReadout &readout){ return write(readout.c_str(), readout.getLength()); }
+
+uint16_t OPCConsole::service(){
+	uint16_t sent = 0;
+	while (count){														//At most two passes, one on each side of the wrap
+		int room = port->availableForWrite();
+		if (room <= 0) break;
+		uint16_t n = OPC_CONSOLE_SIZE - head;
+		if (n > count) n = count;
+		if ((int)n > room) n = room;
+		n = port->write(&queue[head], n);
+		if (!n) break;
+		head = (head + n)%OPC_CONSOLE_SIZE;
+		count -= n;
+		sent += n;
+	}
+	return sent;
+}
+
+uint16_t OPCConsole::getQueued(){ return count; }
+
+uint16_t OPCConsole::getHighWater(){ return highWater; }
+
+uint32_t OPCConsole::getWritten(){ return written; }
+
+uint32_t OPCConsole::getDropped(){ return dropped; }
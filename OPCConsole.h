@@ -0,0 +1,54 @@
+//Optical Particle Counter Library
+
+//University of Minnesota - Candler MURI
+
+/*This is the header file for the console readout.
+.logReadout() prints a readable summary of each sample for the serial
+monitor. Printed line by line, that is about 25 print calls and as many
+Strings for each sample, and every call waits whenever the serial buffer is
+full, so a slow monitor holds up the whole loop.
+
+An OPCReadout (OPCText.h) formats a whole summary into one fixed buffer,
+with no Strings. An OPCConsole holds a bounded queue in front of a port
+(Serial, or a hardware serial port), and .service() hands the port only as
+much as it can take without waiting. A readout that does not fit in the queue is
+dropped and counted, so a backed up monitor costs readouts, not samples.
+
+Give each sensor the console with .setConsole(). A sensor without one
+writes each readout to Serial in one call, which can still wait.
+*/
+
+
+#ifndef OPCConsole_h
+#define OPCConsole_h
+
+#include <arduino.h>
+#include "OPCText.h"
+
+#define OPC_CONSOLE_SIZE 2048											//Bytes the queue holds, a few readouts
+
+
+
+class OPCConsole
+{
+	private:
+	Print *port;
+	uint8_t queue[OPC_CONSOLE_SIZE];
+	uint16_t head;														//Next byte out
+	uint16_t count;														//Bytes waiting
+	uint16_t highWater;
+	uint32_t written;													//Readouts queued
+	uint32_t dropped;													//Readouts that did not fit
+
+	public:
+	OPCConsole(Print &out);
+	bool write(const char *text, uint16_t len);							//Queue all of the text, or none of it. False if it was dropped.
+	bool write(OPCReadout &readout);
+	uint16_t service();													//Hand the port what it can take without waiting. Returns the bytes sent.
+	uint16_t getQueued();
+	uint16_t getHighWater();
+	uint32_t getWritten();
+	uint32_t getDropped();
+};
+
+#endif
@@ -0,0 +1,130 @@
+//Optical Particle Counter Library
+
+//University of Minnesota - Candler MURI
+
+/*This is the definitions file for the derived size distribution products.
+See OPCDerived.h for the products and their units.*/
+
+#include "OPCDerived.h"
+
+
+
+//////////DERIVED//////////
+
+
+
+OPCDerived::OPCDerived(const OPCBinLayout &binLayout, float particleDensity){
+	layout = &binLayout;
+	products = OPC_DERIVED_ALL;
+	lastSample = 0;
+	valid = false;
+
+	for (uint8_t i = 0; i < layout->nBins; i++){						//The per-bin constants are only worked out once
+		float lower = layout->edges[i];
+		float upper = layout->edges[i + 1];
+		float mid = sqrt(lower*upper);									//Geometric midpoint of the bin
+
+		invLogWidth[i] = 1.0/log10(upper/lower);
+		particleVolume[i] = (PI/6.0)*mid*mid*mid;
+	}
+	setDensity(particleDensity);
+}
+
+void OPCDerived::setProducts(uint8_t select){ products = select; }
+
+void OPCDerived::setDensity(float particleDensity){
+	density = particleDensity;
+	for (uint8_t i = 0; i < layout->nBins; i++) particleMass[i] = particleVolume[i]*density;
+}
+
+uint8_t OPCDerived::getBins(){ return layout->nBins; }
+
+void OPCDerived::compute(const float *bins){							//Every product, from one sample
+	uint8_t n = layout->nBins;
+	opcDifferential(*layout, bins, counts);
+
+	totalCount = 0;														//These loops have no branches, so they can be vectorized
+	totalVolume = 0;
+	totalMass = 0;
+	for (uint8_t i = 0; i < n; i++){
+		dNdlogDp[i] = counts[i]*invLogWidth[i];
+		volume[i] = counts[i]*particleVolume[i];
+		mass[i] = counts[i]*particleMass[i];
+		totalCount += counts[i];
+		totalVolume += volume[i];
+		totalMass += mass[i];
+	}
+
+	float above = 0;													//Running sum from the top bin down
+	for (uint8_t i = n; i > 0; i--){
+		above += counts[i - 1];
+		cumulative[i - 1] = above;
+	}
+	valid = true;
+}
+
+bool OPCDerived::update(OPC &sensor){									//Only a new sample from the sensor is computed
+	float bins[OPC_MAX_BINS];
+	if (!sensor.getNewData(bins, layout->nBins, lastSample)){
+		valid = false;
+		return false;
+	}
+	compute(bins);
+	return true;
+}
+
+String OPCDerived::CSVHeader(){											//Header with a column for every selected product and bin
+	String header = "";
+	const char *names[4] = {"dNdlogDp", "Cum", "Vol", "Mass"};
+
+	for (uint8_t p = 0; p < 4; p++){
+		if (!(products & (1 << p))) continue;
+		for (uint8_t i = 0; i < layout->nBins; i++){
+			if (header.length() > 0) header += ",";
+			header += String(names[p]) + String(i);
+		}
+	}
+	if (products & OPC_DERIVED_VOLUME) header += ",Vol Total";
+	if (products & OPC_DERIVED_MASS) header += ",Mass Total";
+	return header;
+}
+
+String OPCDerived::logUpdate(){											//The selected products of the last sample, in CSV format
+	String dataLogLocal = "";
+	const float *arrays[4] = {dNdlogDp, cumulative, volume, mass};
+
+	for (uint8_t p = 0; p < 4; p++){
+		if (!(products & (1 << p))) continue;
+		for (uint8_t i = 0; i < layout->nBins; i++){
+			if (dataLogLocal.length() > 0) dataLogLocal += ",";
+			if (valid) dataLogLocal += String(arrays[p][i], 4);
+			else dataLogLocal += "-";									//If there is no new sample, the string is populated with failure symbols.
+		}
+	}
+	if (products & OPC_DERIVED_VOLUME) dataLogLocal += valid ? ("," + String(totalVolume, 4)) : String(",-");
+	if (products & OPC_DERIVED_MASS) dataLogLocal += valid ? ("," + String(totalMass, 4)) : String(",-");
+	return dataLogLocal;
+}
+
+uint16_t OPCDerived::logBinary(uint8_t *buf, uint16_t len){				//The selected products in a binary record. The data is a byte with the selected
+	const float *arrays[4] = {dNdlogDp, cumulative, volume, mass};		//products, a byte with the number of bins, then the float arrays in order.
+	uint16_t dataLen = 0;
+
+	if (valid){
+		dataLen = 2;
+		for (uint8_t p = 0; p < 4; p++){
+			if (products & (1 << p)) dataLen += layout->nBins*sizeof(float);
+		}
+	}
+	uint16_t at = OPC::packHeader(OPC_TYPE_DERIVED | layout->type, 0, valid ? OPC_FLAG_GOOD : 0, dataLen, buf, len);
+	if (!at || !valid) return at;
+
+	buf[at++] = products;
+	buf[at++] = layout->nBins;
+	for (uint8_t p = 0; p < 4; p++){
+		if (!(products & (1 << p))) continue;
+		memcpy(buf + at, arrays[p], layout->nBins*sizeof(float));
+		at += layout->nBins*sizeof(float);
+	}
+	return at;
+}
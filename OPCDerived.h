@@ -0,0 +1,66 @@
+//Optical Particle Counter Library
+
+//University of Minnesota - Candler MURI
+
+/*This is the header file for the derived size distribution products.
+An OPCDerived object is built for one bin layout (see OPCBins.h). The per-bin constants (log widths and particle
+volumes) are worked out once in the constructor, so each sample only needs a
+few short loops with no logs or powers.
+
+The products are:
+ - dN/dlogDp, the differential number distribution
+ - cumulative, the count at or above the lower edge of each bin
+ - volume, the particle volume in each bin (um^3 per unit of the bin counts)
+ - mass, the volume times the particle density
+
+If the bins are in particles per cubic centimeter, the volume is in um^3/cm^3
+and the mass is in ug/m^3.
+*/
+
+
+#ifndef OPCDerived_h
+#define OPCDerived_h
+
+#include "OPCSensor.h"
+#include "OPCBins.h"
+
+#define OPC_DERIVED_DNDLOGDP 0x01										//Product selection bits
+#define OPC_DERIVED_CUMULATIVE 0x02
+#define OPC_DERIVED_VOLUME 0x04
+#define OPC_DERIVED_MASS 0x08
+#define OPC_DERIVED_ALL 0x0F
+
+
+
+class OPCDerived
+{
+	private:
+	const OPCBinLayout *layout;
+	uint8_t products;													//Selected products for the outputs
+	float density;														//Particle density (g/cm^3)
+	float invLogWidth[OPC_MAX_BINS];									//1/log10(upper/lower) for each bin
+	float particleVolume[OPC_MAX_BINS];									//Volume of one particle at the bin midpoint (um^3)
+	float particleMass[OPC_MAX_BINS];									//particleVolume times the density
+	uint64_t lastSample;												//Sample time of the last sample used
+	bool valid;															//The products hold a fresh sample
+
+	public:
+	float counts[OPC_MAX_BINS];											//Counts in each bin alone
+	float dNdlogDp[OPC_MAX_BINS];										//Derived products, per bin
+	float cumulative[OPC_MAX_BINS];
+	float volume[OPC_MAX_BINS];
+	float mass[OPC_MAX_BINS];
+	float totalCount, totalVolume, totalMass;							//Sums over all bins
+
+	OPCDerived(const OPCBinLayout &binLayout, float particleDensity = 1.65);
+	void setProducts(uint8_t select);									//Select products for the outputs (OPC_DERIVED_* bits)
+	void setDensity(float particleDensity);								//Particle density in g/cm^3 (default 1.65)
+	uint8_t getBins();
+	void compute(const float *bins);									//Work out every product from the reported bins
+	bool update(OPC &sensor);											//Compute from the sensor if it has a new sample
+	String CSVHeader();													//Header for the selected products
+	String logUpdate();													//Selected products in CSV format
+	uint16_t logBinary(uint8_t *buf, uint16_t len);						//Selected products in a binary record
+};
+
+#endif
@@ -0,0 +1,108 @@
+//Optical Particle Counter Library
+
+//University of Minnesota - Candler MURI
+
+/*This is the definitions file for the duty cycle scheduler.
+Each sensor goes from off, to warm-up, to sampling, and back to off.
+See OPCDutyCycle.h for the details.*/
+
+#include "OPCDutyCycle.h"
+
+
+
+//////////DUTY CYCLE//////////
+
+
+
+OPCDutyCycle::OPCDutyCycle(){
+	nSensors = 0;
+	stagger = 5000;
+}
+
+bool OPCDutyCycle::addSensor(OPC &sensor, unsigned long period, unsigned long warmup, unsigned long burst, bool pump){
+	if (nSensors >= OPC_DUTY_MAX_SENSORS) return false;					//No room for another sensor
+
+	DutySensor &entry = sensors[nSensors++];
+	entry.sensor = &sensor;
+	entry.period = period;
+	entry.warmup = warmup;
+	entry.burst = burst;
+	entry.pump = pump;
+	entry.state = OPC_DUTY_OFF;
+	entry.nextStart = 0;
+	entry.stateStart = 0;
+	entry.onTime = 0;
+	entry.sampleTime = 0;
+	entry.cycles = 0;
+	return true;
+}
+
+void OPCDutyCycle::setStagger(unsigned long offset){ stagger = offset; }
+
+void OPCDutyCycle::begin(){												//Everything starts off, and each sensor is given its first power on time
+	unsigned long now = millis();
+	for (uint8_t i = 0; i < nSensors; i++){
+		sensors[i].sensor->sleep();
+		sensors[i].state = OPC_DUTY_OFF;
+		sensors[i].stateStart = now;
+		sensors[i].nextStart = now + i*stagger;
+	}
+}
+
+void OPCDutyCycle::update(){
+	for (uint8_t i = 0; i < nSensors; i++){
+		DutySensor &entry = sensors[i];
+		unsigned long now = millis();
+		unsigned long inState = now - entry.stateStart;
+
+		switch (entry.state){
+			case OPC_DUTY_OFF:
+				if ((long)(now - entry.nextStart) < 0) break;			//Not time to power on yet
+				entry.sensor->wake(entry.warmup, entry.pump);
+				entry.nextStart += entry.period;
+				entry.state = OPC_DUTY_WARMUP;
+				entry.stateStart = millis();							//Power on can take a while, so the clock is read again
+				break;
+
+			case OPC_DUTY_WARMUP:
+				if (inState < entry.warmup) break;
+				entry.state = OPC_DUTY_SAMPLING;
+				entry.onTime += inState;
+				entry.stateStart = now;
+				break;
+
+			case OPC_DUTY_SAMPLING:
+				if (inState < entry.burst) break;
+				entry.sensor->sleep();
+				entry.onTime += inState;
+				entry.sampleTime += inState;
+				entry.cycles++;
+				entry.state = OPC_DUTY_OFF;
+				entry.stateStart = now;
+				if ((long)(now - entry.nextStart) > 0) entry.nextStart = now;	//The cycle ran past the next start, so the period is too short
+				break;
+		}
+	}
+}
+
+uint8_t OPCDutyCycle::getState(uint8_t index){
+	if (index >= nSensors) return OPC_DUTY_OFF;
+	return sensors[index].state;
+}
+
+bool OPCDutyCycle::isSampling(uint8_t index){ return (getState(index) == OPC_DUTY_SAMPLING); }
+
+unsigned long OPCDutyCycle::getOnTime(uint8_t index){
+	if (index >= nSensors) return 0;
+	return sensors[index].onTime;
+}
+
+unsigned long OPCDutyCycle::getSampleTime(uint8_t index){
+	if (index >= nSensors) return 0;
+	return sensors[index].sampleTime;
+}
+
+uint32_t OPCDutyCycle::getCycles(uint8_t index){
+	if (index >= nSensors) return 0;
+	return sensors[index].cycles;
+}
@@ -0,0 +1,67 @@
+//Optical Particle Counter Library
+
+//University of Minnesota - Candler MURI
+
+/*This is the header file for the duty cycle scheduler.
+Running every sensor for the whole flight drains the battery, and the data
+from the first 30 seconds after power on is not reliable because the fans
+must come up to speed. An OPCDutyCycle object powers each sensor on once per
+period, lets it warm up, keeps it on for a burst of sampling, then powers it
+off again.
+
+While a sensor is warming up, its samples are still read (so the buffers do
+not fill up), but they are thrown out and flagged with OPC_FLAG_WARMUP in the
+logs. While a sensor is off, it is not read at all, its logs are flagged with
+OPC_FLAG_ASLEEP, and it can not trip the automatic reset.
+
+The sensors are staggered so that no two fans spin up at the same time, which
+keeps the peak current down.
+*/
+
+
+#ifndef OPCDutyCycle_h
+#define OPCDutyCycle_h
+
+#include "OPCSensor.h"
+
+#define OPC_DUTY_MAX_SENSORS 5											//Most sensors in one schedule
+#define OPC_DUTY_OFF 0													//Duty cycle states
+#define OPC_DUTY_WARMUP 1
+#define OPC_DUTY_SAMPLING 2
+
+
+
+class OPCDutyCycle
+{
+	private:
+	struct DutySensor{
+		OPC *sensor;
+		unsigned long period;											//Time from one power on to the next (ms)
+		unsigned long warmup;											//Warm-up after power on (ms)
+		unsigned long burst;											//Sampling time after the warm-up (ms)
+		bool pump;														//Power on with .powerOnPump()
+		uint8_t state;
+		unsigned long nextStart;										//Time of the next power on
+		unsigned long stateStart;										//Time the current state began
+		unsigned long onTime;											//Total time powered on (ms)
+		unsigned long sampleTime;										//Total time sampling after warm-up (ms)
+		uint32_t cycles;												//Number of completed cycles
+	} sensors[OPC_DUTY_MAX_SENSORS];
+
+	uint8_t nSensors;
+	unsigned long stagger;												//Time between the first power on of each sensor (ms)
+
+	public:
+	OPCDutyCycle();
+	bool addSensor(OPC &sensor, unsigned long period, unsigned long warmup, unsigned long burst, bool pump = false);
+	void setStagger(unsigned long offset);								//Time between sensor power ons, in milliseconds (default 5000)
+	void begin();														//Power every sensor off and start the schedule
+	void update();														//Power sensors on and off as scheduled. Call from the loop.
+	uint8_t getState(uint8_t index);									//OPC_DUTY_* state of a sensor
+	bool isSampling(uint8_t index);										//True if the sensor is past its warm-up
+	unsigned long getOnTime(uint8_t index);								//Total time the sensor has been powered (ms)
+	unsigned long getSampleTime(uint8_t index);							//Total time the sensor has been sampling (ms)
+	uint32_t getCycles(uint8_t index);									//Number of completed cycles
+};
+
+#endif
@@ -0,0 +1,64 @@
+//Optical Particle Counter Library
+
+//University of Minnesota - Candler MURI
+
+/*This is the header file for the sensor events.
+Without events, the flight code has to check .getLogQuality(), the hits,
+and the warm-up of every sensor on every loop to notice that something
+happened. Each sensor can instead be given one handler with .setHandler(),
+which the sensor calls from inside its own reads and logs as soon as the
+state changes:
+ - OPC_EVENT_SAMPLE: a good frame was published
+ - OPC_EVENT_QUALITY: the log quality changed (detail 1 for good, 0 for bad)
+ - OPC_EVENT_RESET_START, OPC_EVENT_RESET_END: the automatic reset is about
+   to power cycle the sensor (value is the age of the last good log in
+   ms), and the sensor is back on
+ - OPC_EVENT_WARM: the warm-up after a .wake() is over (value is its length
+   in ms)
+ - OPC_EVENT_THRESHOLD: a bin set with .setThreshold() rose to the level
+   (detail 1) or fell below the level less the hysteresis (detail 0). value
+   is the reading of the bin, and bin is its index.
+ - OPC_EVENT_TRIGGER: .trigger() was called with an outside value, such as
+   the altitude from the flight computer (detail is the source)
+ - OPC_EVENT_CLEAN: the SPS started a fan clean because of a trigger
+   (value is the trigger value)
+
+Events are plain structs on the stack, there is no queue and nothing is
+allocated, and each event is one check of the mask and one call. The
+handler runs inside the read, so it should only note the event or start
+something short, and must not read or log the same sensor.
+*/
+
+
+#ifndef OPCEvent_h
+#define OPCEvent_h
+
+#include <stdint.h>
+
+#define OPC_EVENT_SAMPLE 0x01											//Event types, which are also the bits of the mask
+#define OPC_EVENT_QUALITY 0x02
+#define OPC_EVENT_RESET_START 0x04
+#define OPC_EVENT_RESET_END 0x08
+#define OPC_EVENT_WARM 0x10
+#define OPC_EVENT_THRESHOLD 0x20
+#define OPC_EVENT_TRIGGER 0x40
+#define OPC_EVENT_CLEAN 0x80
+#define OPC_EVENT_ALL 0xFF
+
+#define OPC_TRIGGER_ALTITUDE 0											//Sources of .trigger(), others are up to the flight code
+
+#define OPC_THRESHOLD_OFF 0xFF											//No bin is watched
+
+class OPC;
+
+struct OPCEvent{
+	OPC *sensor;														//Sensor that raised the event
+	uint8_t type;														//OPC_EVENT_*
+	uint8_t detail;														//Direction, quality, or trigger source
+	uint8_t bin;														//Bin watched by .setThreshold(), or OPC_THRESHOLD_OFF
+	float value;
+};
+
+typedef void (*OPCEventHandler)(const OPCEvent &event, void *context);
+
+#endif
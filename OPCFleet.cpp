@@ -0,0 +1,115 @@
+//Optical Particle Counter Library
+
+//University of Minnesota - Candler MURI
+
+/*This is the definitions file for the fleet poller.
+See OPCFleet.h for the details.*/
+
+#include "OPCFleet.h"
+
+
+
+//////////FLEET//////////
+
+
+
+OPCFleet::OPCFleet(){
+	nSensors = 0;
+	requestTime = 0;
+	cycleTime = 0;
+	timeout = 1000;
+	done = true;
+}
+
+bool OPCFleet::addSensor(OPC &sensor){
+	if (nSensors >= OPC_FLEET_MAX_SENSORS) return false;				//No room for another sensor
+
+	FleetSensor &entry = sensors[nSensors++];
+	entry.sensor = &sensor;
+	entry.state = OPC_COLLECT_WAITING;
+	entry.lag = 0;
+	entry.maxLag = 0;
+	entry.missed = 0;
+	return true;
+}
+
+void OPCFleet::request(unsigned long limit){							//Each sensor only sends its request here, so this returns right away
+	timeout = limit;
+	done = false;
+	cycleTime = 0;
+	requestTime = opcMicros();
+	for (uint8_t i = 0; i < nSensors; i++){
+		FleetSensor &entry = sensors[i];
+		entry.lag = 0;
+		if (entry.sensor->isAsleep()){									//A sleeping sensor is not read, and is not a miss
+			entry.state = OPC_COLLECT_FAILED;
+			continue;
+		}
+		entry.state = OPC_COLLECT_WAITING;
+		entry.sensor->requestData();
+	}
+}
+
+bool OPCFleet::update(){
+	if (done) return true;
+
+	bool busy = false;
+	for (uint8_t i = 0; i < nSensors; i++){
+		FleetSensor &entry = sensors[i];
+		if (entry.state != OPC_COLLECT_WAITING) continue;
+
+		entry.state = entry.sensor->collectData();
+		entry.lag = opcMicros() - requestTime;
+		if (entry.state == OPC_COLLECT_WAITING){
+			if (entry.lag < timeout*1000UL){
+				busy = true;
+				continue;
+			}
+			entry.state = OPC_COLLECT_FAILED;							//Took too long
+			entry.missed++;
+		}
+		if (entry.lag > entry.maxLag) entry.maxLag = entry.lag;
+	}
+
+	if (!busy){
+		done = true;
+		cycleTime = opcMicros() - requestTime;
+	}
+	return done;
+}
+
+bool OPCFleet::run(unsigned long limit){								//Blocking version, for a loop that only reads
+	request(limit);
+	while (!update()) {}
+	return (getGood() == nSensors);
+}
+
+uint8_t OPCFleet::getState(uint8_t index){
+	if (index >= nSensors) return OPC_COLLECT_FAILED;
+	return sensors[index].state;
+}
+
+unsigned long OPCFleet::getLag(uint8_t index){
+	if (index >= nSensors) return 0;
+	return sensors[index].lag;
+}
+
+unsigned long OPCFleet::getMaxLag(uint8_t index){
+	if (index >= nSensors) return 0;
+	return sensors[index].maxLag;
+}
+
+uint32_t OPCFleet::getMissed(uint8_t index){
+	if (index >= nSensors) return 0;
+	return sensors[index].missed;
+}
+
+unsigned long OPCFleet::getCycleTime(){ return cycleTime; }
+
+uint8_t OPCFleet::getGood(){
+	uint8_t good = 0;
+	for (uint8_t i = 0; i < nSensors; i++){
+		if (sensors[i].state == OPC_COLLECT_GOOD) good++;
+	}
+	return good;
+}
@@ -0,0 +1,64 @@
+//Optical Particle Counter Library
+
+//University of Minnesota - Candler MURI
+
+/*This is the header file for the fleet poller.
+A serial sensor is read by sending a request and waiting for the response.
+Reading several sensors one after another waits out every response in turn,
+so a cycle of N sensors takes N response times. An OPCFleet sends the
+request to every sensor first with .requestData(), then polls each one with
+.collectData() and takes the responses in whatever order they arrive. The
+waits overlap, so a cycle takes about as long as the slowest sensor.
+
+The SPS on a serial port and the Plantower in passive mode (.passiveMode())
+split their reads this way. A Plantower in active mode sends frames on its
+own, so it answers with the next frame. The other sensors read in one step
+when they are collected, which holds the loop for as long as a normal read.
+
+A good sample is held by the sensor, and the next log of that sensor uses it
+in place of a new read. The time from the request to each answer is kept, so
+a slow sensor or a slow line can be spotted in the logs.
+*/
+
+
+#ifndef OPCFleet_h
+#define OPCFleet_h
+
+#include "OPCSensor.h"
+
+#define OPC_FLEET_MAX_SENSORS 8											//Most sensors in one fleet
+
+
+
+class OPCFleet
+{
+	private:
+	struct FleetSensor{
+		OPC *sensor;
+		uint8_t state;													//OPC_COLLECT_* state of this cycle
+		unsigned long lag;												//Time from the request to the answer this cycle (us)
+		unsigned long maxLag;											//Longest lag of any cycle (us)
+		uint32_t missed;												//Cycles with no answer within the limit
+	} sensors[OPC_FLEET_MAX_SENSORS];
+
+	uint8_t nSensors;
+	uint64_t requestTime;												//Time of the last .request() (us)
+	unsigned long cycleTime;											//Time from the request until every sensor was done (us)
+	unsigned long timeout;
+	bool done;
+
+	public:
+	OPCFleet();
+	bool addSensor(OPC &sensor);
+	void request(unsigned long limit = 1000);							//Send the request to every sensor, giving up on any answer not in within the limit (ms)
+	bool update();														//Collect the answers that have arrived, true once every sensor is done. Call from the loop.
+	bool run(unsigned long limit = 1000);								//Request and collect until done, true if every sensor had a good sample
+	uint8_t getState(uint8_t index);									//OPC_COLLECT_* state of a sensor this cycle
+	unsigned long getLag(uint8_t index);								//Time the sensor took to answer this cycle (us)
+	unsigned long getMaxLag(uint8_t index);								//Longest time the sensor took to answer (us)
+	uint32_t getMissed(uint8_t index);									//Cycles the sensor did not answer in time
+	unsigned long getCycleTime();										//Time until every sensor was done (us)
+	uint8_t getGood();													//Number of sensors with a good sample this cycle
+};
+
+#endif
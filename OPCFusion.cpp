@@ -0,0 +1,148 @@
+//Optical Particle Counter Library
+
+//University of Minnesota - Candler MURI
+
+/*This is the definitions file for the multi-sensor fusion stage.
+See OPCFusion.h for the policies and timing.*/
+
+#include "OPCFusion.h"
+
+
+
+//////////FUSION//////////
+
+
+
+OPCFusion::OPCFusion(unsigned long tickPeriod){
+	nSources = 0;
+	period = (uint64_t)tickPeriod*1000;
+	lag = 0;
+	maxAge = 3*period;
+	nextTick = 0;
+	tickTime = 0;
+	ticks = 0;
+	missedTicks = 0;
+	started = false;
+}
+
+bool OPCFusion::addSensor(OPC &sensor, uint8_t channels, const char *label, uint8_t policy){
+	if (nSources >= OPC_FUSION_MAX_SENSORS) return false;				//No room for another sensor
+	if (channels > sensor.getBins()) channels = sensor.getBins();		//Only values the sensor has
+
+	FusionSource &src = sources[nSources++];
+	src.sensor = &sensor;
+	src.label = label;
+	src.channels = channels;
+	src.policy = policy;
+	src.count = 0;
+	src.present = false;
+	return true;
+}
+
+void OPCFusion::setDelay(unsigned long tickDelay){ lag = (uint64_t)tickDelay*1000; }
+
+void OPCFusion::setMaxAge(unsigned long age){ maxAge = (uint64_t)age*1000; }
+
+void OPCFusion::poll(FusionSource &src){								//A new sample is found by its sample time
+	if (src.sensor->isAsleep() || src.sensor->warmingUp()) return;		//Samples from a sleeping or warming sensor are not used
+	uint64_t sampleTime = src.sensor->getSampleTime();
+	if (sampleTime == 0) return;										//No good sample yet
+	if ((src.count > 0) && (sampleTime == src.time[1])) return;			//Nothing new
+
+	float fresh[OPC_MAX_BINS];
+	if (src.sensor->getData(fresh, src.channels) < src.channels) return;	//A sample without every value, such as a PM-only read, is skipped
+
+	src.time[0] = src.time[1];											//The newest sample becomes the older one
+	memcpy(src.values[0], src.values[1], src.channels*sizeof(float));
+	src.time[1] = sampleTime;
+	memcpy(src.values[1], fresh, src.channels*sizeof(float));
+	if (src.count < 2) src.count++;
+}
+
+void OPCFusion::fuse(FusionSource &src){								//Place the sensor on the tick
+	src.present = false;
+	if (src.count == 0) return;
+
+	if ((src.policy == OPC_FUSE_INTERPOLATE) && (src.count == 2) &&		//A line between the samples on either side of the tick
+		(src.time[0] <= tickTime) && (tickTime < src.time[1]) && ((tickTime - src.time[0]) <= maxAge)){
+		float f = (float)(tickTime - src.time[0])/(float)(src.time[1] - src.time[0]);
+		for (uint8_t i = 0; i < src.channels; i++) src.fused[i] = src.values[0][i] + f*(src.values[1][i] - src.values[0][i]);
+		src.present = true;
+		return;
+	}
+
+	int8_t k = -1;														//Otherwise, hold the newest sample at or before the tick
+	if (src.time[1] <= tickTime) k = 1;
+	else if ((src.count == 2) && (src.time[0] <= tickTime)) k = 0;
+	if ((k < 0) || ((tickTime - src.time[k]) > maxAge)) return;			//No usable sample, so the sensor is missing from this tick
+
+	memcpy(src.fused, src.values[k], src.channels*sizeof(float));
+	src.present = true;
+}
+
+bool OPCFusion::update(){
+	uint64_t now = opcMicros();
+	for (uint8_t s = 0; s < nSources; s++) poll(sources[s]);
+
+	if (!started){														//Ticks land on whole multiples of the period
+		nextTick = ((now/period) + 1)*period;
+		started = true;
+	}
+	if (now < (nextTick + lag)) return false;
+
+	uint64_t behind = (now - lag - nextTick)/period;					//If the loop was late, only the latest due tick is made,
+	missedTicks += behind;												//so a tick never takes longer than one pass over the sensors.
+	tickTime = nextTick + behind*period;
+	nextTick = tickTime + period;
+
+	for (uint8_t s = 0; s < nSources; s++) fuse(sources[s]);
+	ticks++;
+	return true;
+}
+
+uint64_t OPCFusion::getTickTime(){ return tickTime; }
+
+uint32_t OPCFusion::getTicks(){ return ticks; }
+
+uint32_t OPCFusion::getMissedTicks(){ return missedTicks; }
+
+String OPCFusion::CSVHeader(){											//Columns are the label of each sensor followed by the value number
+	String header = "tickTime";
+	for (uint8_t s = 0; s < nSources; s++){
+		for (uint8_t i = 0; i < sources[s].channels; i++) header += "," + String(sources[s].label) + String(i);
+	}
+	return header;
+}
+
+String OPCFusion::logUpdate(){											//Tick time in milliseconds, then the values of every sensor
+	String dataLogLocal = String((unsigned long)(tickTime/1000));
+	for (uint8_t s = 0; s < nSources; s++){
+		FusionSource &src = sources[s];
+		for (uint8_t i = 0; i < src.channels; i++){
+			if (src.present) dataLogLocal += "," + String(src.fused[i], 4);
+			else dataLogLocal += ",-";									//A missing sensor is populated with failure symbols.
+		}
+	}
+	return dataLogLocal;
+}
+
+uint16_t OPCFusion::logBinary(uint8_t *buf, uint16_t len){				//The data is the tick time (us), then for each sensor a byte that is 1 if the
+	uint16_t dataLen = sizeof(tickTime);								//sensor is present, followed by its values as floats.
+	bool any = false;
+
+	for (uint8_t s = 0; s < nSources; s++){
+		dataLen += 1 + sources[s].channels*sizeof(float);
+		any = any || sources[s].present;
+	}
+	uint16_t at = OPC::packHeader(OPC_TYPE_FUSION, ticks, any ? OPC_FLAG_GOOD : 0, dataLen, buf, len);
+	if (!at) return 0;
+
+	memcpy(buf + at, &tickTime, sizeof(tickTime));
+	at += sizeof(tickTime);
+	for (uint8_t s = 0; s < nSources; s++){
+		buf[at++] = sources[s].present ? 1 : 0;
+		memcpy(buf + at, sources[s].fused, sources[s].channels*sizeof(float));
+		at += sources[s].channels*sizeof(float);
+	}
+	return at;
+}
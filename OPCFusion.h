@@ -0,0 +1,78 @@
+//Optical Particle Counter Library
+
+//University of Minnesota - Candler MURI
+
+/*This is the header file for the multi-sensor fusion stage.
+Each OPC is read on its own schedule, so their samples never line up in time.
+An OPCFusion object watches a set of sensors and puts their latest samples on a
+shared time grid, one merged record per tick. The two most recent samples of
+each sensor are kept, so the memory used is fixed, and each tick only touches
+each value once.
+
+Each sensor is given a policy for how its values are placed on a tick:
+ - OPC_FUSE_HOLD uses the last sample at or before the tick
+ - OPC_FUSE_INTERPOLATE draws a line between the samples on either side of the
+   tick, and holds the last sample if the tick is past it
+
+Ticks are made a set delay after their time, so that a sample that lands just
+after the tick can still be used for interpolation. The delay should be shorter
+than the time between samples of the fastest sensor. A sensor whose sample is
+older than the max age at a tick is logged as missing.
+*/
+
+
+#ifndef OPCFusion_h
+#define OPCFusion_h
+
+#include "OPCSensor.h"
+#include "OPCBins.h"
+
+#define OPC_FUSION_MAX_SENSORS 5										//Most sensors in one fusion
+#define OPC_FUSE_HOLD 0													//Policies for placing samples on a tick
+#define OPC_FUSE_INTERPOLATE 1
+
+
+
+class OPCFusion
+{
+	private:
+	struct FusionSource{												//One registered sensor
+		OPC *sensor;
+		const char *label;												//Column prefix
+		uint8_t channels;												//Values used from .getData()
+		uint8_t policy;
+		uint8_t count;													//Samples held, up to 2
+		uint64_t time[2];												//Sample times, [1] is the newest
+		float values[2][OPC_MAX_BINS];
+		float fused[OPC_MAX_BINS];										//Values at the last tick
+		bool present;													//The sensor had a usable sample at the last tick
+	} sources[OPC_FUSION_MAX_SENSORS];
+
+	uint8_t nSources;
+	uint64_t period;													//Tick period (us)
+	uint64_t lag;														//Delay before a tick is made (us)
+	uint64_t maxAge;													//Oldest sample that can be used on a tick (us)
+	uint64_t nextTick;													//Time of the next tick (us)
+	uint64_t tickTime;													//Time of the last tick (us)
+	uint32_t ticks;														//Number of ticks made
+	uint32_t missedTicks;												//Ticks skipped because .update() was late
+	bool started;
+
+	void poll(FusionSource &src);										//Take in a new sample from a sensor
+	void fuse(FusionSource &src);										//Place a sensor on the tick
+
+	public:
+	OPCFusion(unsigned long tickPeriod);								//Tick period in milliseconds
+	bool addSensor(OPC &sensor, uint8_t channels, const char *label, uint8_t policy = OPC_FUSE_HOLD);
+	void setDelay(unsigned long tickDelay);								//Delay before a tick is made, in milliseconds (default 0)
+	void setMaxAge(unsigned long age);									//Oldest usable sample, in milliseconds (default 3 tick periods)
+	bool update();														//Check the sensors and make a tick if one is due. Call from the loop.
+	uint64_t getTickTime();												//Time of the last tick (us)
+	uint32_t getTicks();
+	uint32_t getMissedTicks();
+	String CSVHeader();													//Header with a column for every value
+	String logUpdate();													//The last tick in CSV format
+	uint16_t logBinary(uint8_t *buf, uint16_t len);						//The last tick in a binary record
+};
+
+#endif
@@ -0,0 +1,348 @@
+//Optical Particle Counter Library
+
+//University of Minnesota - Candler MURI
+
+/*This is the definitions file for the Honeywell HPM.
+The HPM runs the read data function with the log update function, and can
+record new data every 1 seconds.*/
+
+#include "OPCSensor.h"
+
+#if OPC_USE_HPM
+
+#ifdef OPC_STATIC_RAM
+static_assert(sizeof(HPM) <= OPC_RAM_HPM, "HPM is over its RAM budget");	//RAM budget from OPCConfig.h
+#endif
+
+
+
+//////////HPM//////////													//The HPM is no longer supported.
+
+
+
+HPM::HPM(Stream* ser) : OPC(ser) {										//Constructor
+	retry.setAttempts(20);												//The backoff is also the time the HPM has to respond
+	retry.setBackoff(50, 400);
+	retry.setDeadline(2500);
+	setStaleLimit(OPC_STALE_LIMIT_WHOLE);								//Four whole ug/m^3 values
+}	
+
+void HPM::sendCommand(byte cmd, byte chk){								//Send a command frame
+  s->write(0x68);
+  s->write(0x01);
+  s->write(cmd);
+  s->write(chk);
+}
+
+bool HPM::command(byte cmd, byte chk){									//Command system, will return true if command successful
+  byte checkIt[2] = {0};
+  bool more = true;
+  
+  retry.begin();
+  while (more){															//Will send the command until the retry policy runs out
+	sendCommand(cmd, chk);												//of attempts or time, or the proper bytes are returned
+	more = retry.backoff();
+	retry.wait();														//Time to respond
+	checkIt[0] = s->read();
+	checkIt[1] = s->read();
+	if ((checkIt[0] == 0xA5)&&(checkIt[1] == 0xA5)){
+	  retry.succeed();
+	  return true;
+	}
+  }
+  return retry.giveUp();
+}									
+
+void HPM::powerOn(){													//Power on
+  command(0x01,0x96);
+}
+
+void HPM::powerOff(){													//Power off
+  command(0x02,0x95);
+}
+
+void HPM::autoSendOn(){													//Auto send on
+  if(command(0x40,0x57)){												//When this is active, the HPM will automatically send data.
+	  autoSend = true;													//This is off by default.
+  }
+}
+
+void HPM::autoSendOff(){												//Auto send off
+  if(command(0x20,0x77)){												//This setting is recommended, and has been successfully tested.
+	  autoSend = false;
+  }
+}
+
+void HPM::initOPC(){													//System initialization
+	OPC::initOPC();
+	autoSend = true;
+		
+	powerOn();															//Will turn on particle detector
+	delay(100);
+	autoSendOff();														//Will turn off auto sending of data.
+}	
+
+void HPM::beginInit(){													//Non-blocking version of the initialization
+	OPC::initOPC();
+	autoSend = true;
+	
+	initState = OPC_INIT_BUSY;
+	initStep = 0;
+	retry.begin();
+	sendCommand(0x01,0x96);												//Will turn on particle detector
+	retry.backoff();
+}
+
+uint8_t HPM::pollInit(){												//The power on and auto send off commands are each sent until acknowledged
+	if (initState != OPC_INIT_BUSY) return initState;
+	if (!retry.ready()) return initState;								//Response time for a command
+	
+	byte checkIt[2];
+	checkIt[0] = s->read();
+	checkIt[1] = s->read();
+	
+	if ((checkIt[0] == 0xA5)&&(checkIt[1] == 0xA5)){
+		retry.succeed();
+		if (initStep == 0){
+			initStep = 1;
+			retry.begin();
+			sendCommand(0x20,0x77);										//Will turn off auto sending of data.
+			retry.backoff();
+		} else {
+			autoSend = false;
+			initState = OPC_INIT_READY;
+		}
+	} else if (retry.isExhausted()){
+		retry.giveUp();
+		initState = OPC_INIT_FAILED;
+	} else {
+		if (initStep == 0) sendCommand(0x01,0x96);
+		else sendCommand(0x20,0x77);
+		retry.backoff();
+	}
+	return initState;
+}
+
+static const char hpmHeader[] PROGMEM = ",1um,2.5um,4.0um,10um";
+
+uint16_t HPM::CSVHeader(char *buf, uint16_t len){ return headerText(hpmHeader, buf, len); }	//Data header in CSV format
+
+bool HPM::update(){														//Reads the data and updates the log quality for the log functions
+  if (sleeping()) return false;											//A sleeping sensor is not read
+  
+  if (takeSample()){													//If the data is successfully read, it will be logged
+    setQuality(true);
+    badLog = 0;
+    goodLogAge = millis();
+    if (warmingUp()) return false;										//Samples during the warm-up are thrown out
+    nTot++;
+    return true;
+  }
+  
+  badLog++;																//Otherwise, the system will indicate that the log is bad.
+  if (badLog >= 5) setQuality(false);
+#if OPC_USE_RESET
+  if ((millis()-goodLogAge)>=resetTime){								//If it has been a certain amount of time since the system has had a
+	fire(OPC_EVENT_RESET_START, 0, millis() - goodLogAge);
+	powerOff();															//good log, it will reset.
+	delay(20000);
+	powerOn();
+	goodLogAge = millis();
+	fire(OPC_EVENT_RESET_END, 0, 0);
+  }
+#endif
+  return false;
+}
+
+void HPM::dataText(OPCText &text, bool fresh){							//Mass concentrations
+  if (!fresh){															//Otherwise, the columns will be populated with error symbols
+    missingText(text, 4);
+    return;
+  }
+  const uint16_t columns[4] = {localData->PM1_0, localData->PM2_5, localData->PM4_0, localData->PM10_0};
+  for (uint8_t i = 0; i < 4; i++){
+    text.add(',');
+    text.add((unsigned long)columns[i]);
+  }
+}
+
+uint16_t HPM::logLine(char *buf, uint16_t len){							//This will update the data log in CSV format
+  unsigned int hits = nTot;												//This system only works when data is not being automatically sent.
+  bool fresh = update();
+  return lineText(hits, fresh, buf, len);
+}
+
+#if OPC_USE_READOUT
+uint16_t HPM::logReadout(const char *name, char *buf, uint16_t len){	//Same as log update, but with a readout for the serial monitor
+  unsigned int hits = nTot;
+  bool fresh = update();
+  OPCReadout readout;
+  readoutStart(readout, PSTR("HPM"), name, getSampleAge());
+  
+  if (fresh){
+    readout.line(PSTR("PM1 (ug/m^3): "), (unsigned long)localData->PM1_0);
+    readout.line(PSTR("PM2.5 (ug/m^3): "), (unsigned long)localData->PM2_5);
+    readout.line(PSTR("PM4 (ug/m^3): "), (unsigned long)localData->PM4_0);
+    readout.line(PSTR("PM10 (ug/m^3): "), (unsigned long)localData->PM10_0);
+  } else readout.line(PSTR("Bad log"));
+  
+  readoutSend(readout);
+  return lineText(hits, fresh, buf, len);
+}
+#endif
+
+#ifndef OPC_STATIC_RAM
+String HPM::CSVHeader(){
+  char line[OPC_LINE_SIZE];
+  CSVHeader(line, sizeof(line));
+  return String(line);
+}
+
+String HPM::logUpdate(){
+  char line[OPC_LINE_SIZE];
+  logLine(line, sizeof(line));
+  return String(line);
+}
+
+#if OPC_USE_READOUT
+String HPM::logReadout(String name){
+  char line[OPC_LINE_SIZE];
+  logReadout(name.c_str(), line, sizeof(line));
+  return String(line);
+}
+#endif
+#endif
+
+uint16_t HPM::logBinary(uint8_t *buf, uint16_t len){					//Same as log update, but packed into a binary record
+  unsigned int hits = nTot;
+  bool fresh = update();
+  return packRecord(OPC_TYPE_HPM, hits, fresh, &localData.latest(), sizeof(HPMdata), buf, len);
+}
+
+uint8_t HPM::getData(float *data, uint8_t len){						//Mass concentrations for 1, 2.5, 4, and 10 microns
+  uint16_t pm[4] = {localData->PM1_0, localData->PM2_5, localData->PM4_0, localData->PM10_0};
+  if (len > 4) len = 4;
+  for (uint8_t i = 0; i < len; i++) data[i] = pm[i];
+  return len;
+}
+
+uint8_t HPM::getBins(){ return 4; }
+
+static uint32_t hpmQuality(const HPM::HPMdata &frame){					//Each PM value holds the smaller sizes, so none can be under a smaller one
+	bool ordered = (frame.PM1_0 <= frame.PM2_5) && (frame.PM2_5 <= frame.PM4_0) && (frame.PM4_0 <= frame.PM10_0);
+	return ordered ? 0 : OPC_FLAG_RANGE;
+}
+
+bool HPM::readData(){													//This function will read the data
+  HPMdata &frame = localData.scratch();									//Decode into the scratch copy, so a bad frame is never seen
+  if (autoSend){														//If the system is in autosend mode, the first part of the code will try to read
+    byte inputArray[32] = {0};											//it. This should be run as fast as possible to get the data.
+	    
+    if (!s->available()){												//If the serial is not available, the data will not be read.
+      return false;
+    }
+  
+    if (s->peek() != 0x42){												//If the start byte is not found, the byte is discarded, and the data will not be read.
+      s->read();
+      return false;
+    }
+  
+    if (s->available() < 32){											//If there are not enough data bytes, the data will not be read.
+      return false;
+    }
+    
+    frame.checksum = 0;
+    for (int i = 0; i<32; i++){											//Data is read into the input array
+      inputArray[i] = s->read();
+      if (i<30) frame.checksum += inputArray[i];					//Checksum is calculated
+    }
+  
+    uint64_t arrival = opcMicros();										//The frame is complete once the last byte is read
+    frame.checksumR = bytes2int(inputArray[31],inputArray[30]);		//Sent checksum is read
+   if (frame.checksum != frame.checksumR){						//If the checksums do not match, the data will not be saved.
+     return false;
+   }
+
+   frame.PM1_0 = bytes2int(inputArray[5],inputArray[4]);			//Data is saved
+   frame.PM2_5 = bytes2int(inputArray[7],inputArray[6]);
+   frame.PM4_0 = bytes2int(inputArray[9],inputArray[8]);
+   frame.PM10_0 = bytes2int(inputArray[11],inputArray[10]);
+   if (!checkFrame(&frame.PM1_0, 8, hpmQuality(frame))) return false;	//The four PM values. A stale frame is not published.
+   frame.sampleTime = sampleTime = arrival;
+   localData.publish();
+   sampleEvent();
+
+   return true;
+   
+  } else {																//If the system is not in auto send mode, then this code will be used.
+   byte head;
+   byte len;
+   byte cmd;
+
+   for (unsigned short i = 0; i<32; i++) s->read();						//Clear the buffer (redundant, but helpful)
+
+   s->write(0x68);														//Data is requested
+   s->write(0x01);
+   s->write(0x04);
+   s->write(0x93);
+
+   delay(50);
+   
+   if (!s->available()){ 												//If the serial port is not available, the data is not read.
+     return false;
+   }
+
+   if (s->peek() == 0x96){												//If the failure bytes are sent, the data is not read.
+      s->read();
+      s->read();
+      return false;
+   }
+
+    head = s->read();
+    len = s->read();
+    cmd = s->read();
+
+   if (head != 0x40){													//If the start byte is not correct, the data is not read.
+     return false;
+   }  
+
+    if (s->available()<(len)){											//If there are not enough bytes, the data is not read.
+     return false;
+   }
+
+   if (cmd != 0x04){													//If the command is incorrect, the data is not read.
+     return false;
+   }
+
+   if ((len < 9)||(len > 32)){											//A length that can not hold the data and checksum is line noise
+     return false;
+   }
+
+   uint16_t inputArray[32];												//Array for data, sized for the longest response
+   for (unsigned short i = 0; i<len; i++){								//Data is read into an array. Only len bytes are taken, so
+     inputArray[i] = s->read();											//extra bytes can not run past the array.
+   }
+   uint64_t arrival = opcMicros();
+
+   frame.checksum = 65536 - (head + len + cmd);						//Checksum is calculated
+   for (unsigned short i = 0; i<len-1; i++) frame.checksum -= inputArray[i];
+   frame.checksum = frame.checksum % 256;
+   frame.checksumR = inputArray[(len-1)];
+  
+   if (frame.checksum != frame.checksumR){						//If the checksums do not match, the data will not be saved.
+     return false;
+   }
+
+   frame.PM1_0 = inputArray[0]*256 + inputArray[1];					//Data is saved
+   frame.PM2_5 = inputArray[2]*256 + inputArray[3];
+   frame.PM4_0 = inputArray[4]*256 + inputArray[5];
+   frame.PM10_0 = inputArray[6]*256 + inputArray[7];
+   if (!checkFrame(&frame.PM1_0, 8, hpmQuality(frame))) return false;	//The four PM values. A stale frame is not published.
+   frame.sampleTime = sampleTime = arrival;
+   localData.publish();
+   sampleEvent();
+   return true;
+  }	
+}	
+
+#endif
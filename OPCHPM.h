@@ -0,0 +1,58 @@
+//Optical Particle Counter Library
+
+//University of Minnesota - Candler MURI
+
+/*This is the header file for the Honeywell HPM.
+The HPM runs the read data function with the log update function, and can
+record new data every 1 seconds.
+*/
+
+
+#ifndef OPCHPM_h
+#define OPCHPM_h
+
+#include "OPCSensor.h"
+
+
+class HPM: public OPC{
+	private:
+	bool autoSend;														//Auto send data state
+	bool command(byte cmd, byte chk);									//Command base
+	void sendCommand(byte cmd, byte chk);								//Send a command, without waiting for the response
+	bool update();														//Read the data and update the log quality
+	void dataText(OPCText &text, bool fresh);							//Data columns of the CSV line
+	
+	public:	
+	struct HPMdata{
+		uint16_t PM1_0, PM2_5, PM4_0, PM10_0, checksum, checksumR;		//Data structure
+		uint64_t sampleTime;											//Time the response finished arriving (us)
+	};
+	OPCSample<HPMdata> localData;
+	
+	HPM(Stream* ser);												
+	void powerOn();														//Power on will start the measurement system
+	void powerOff();													//Power off will stop measurements
+	void autoSendOn();													//Will automatically send data
+	void autoSendOff();													//Will wait for data requests (recommended)
+	void initOPC();														//Initialize the system
+	void beginInit();													//Non-blocking initialization
+	uint8_t pollInit();
+	uint16_t CSVHeader(char *buf, uint16_t len);						//CSV header, written into the buffer
+	uint16_t logLine(char *buf, uint16_t len);							//Log update, written into the buffer. Returns the length, or 0 if it does not fit
+#if OPC_USE_READOUT
+	uint16_t logReadout(const char *name, char *buf, uint16_t len);	//Log line, and a readout for the serial monitor
+#endif
+#ifndef OPC_STATIC_RAM
+	String CSVHeader();													//Header in CSV format
+	String logUpdate();													//Update data in CSV string
+#if OPC_USE_READOUT
+	String logReadout(String name);										//Log update, but with a readout for the serial monitor
+#endif
+#endif
+	uint16_t logBinary(uint8_t *buf, uint16_t len);						//Update data in a binary record
+	uint8_t getData(float *data, uint8_t len);							//Mass concentrations
+	uint8_t getBins();
+	bool readData();													//Read incoming data
+};
+
+#endif
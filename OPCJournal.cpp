@@ -0,0 +1,169 @@
+//Optical Particle Counter Library
+
+//University of Minnesota - Candler MURI
+
+/*This is the definitions file for the crash-safe journal.
+Entries are built in one buffer and handed to the logger in a single write, so
+a failed write never leaves half an entry queued. See OPCJournal.h for the
+entry layout.*/
+
+#include "OPCJournal.h"
+
+#ifndef ARDUINO
+#include <time.h>
+
+static unsigned long millis(){											//Host stand-in for the millisecond clock
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (unsigned long)(now.tv_sec*1000UL + now.tv_nsec/1000000);
+}
+#endif
+
+static uint16_t getU16(const uint8_t *buf){ return buf[0] | ((uint16_t)buf[1] << 8); }
+
+static uint32_t getU32(const uint8_t *buf){
+	return buf[0] | ((uint32_t)buf[1] << 8) | ((uint32_t)buf[2] << 16) | ((uint32_t)buf[3] << 24);
+}
+
+
+
+//////////SCANNER//////////
+
+
+
+OPCJournalScanner::OPCJournalScanner(const uint8_t *data, uint64_t length){
+	image = data;
+	len = length;
+	at = 0;
+	skipped = 0;
+	found = 0;
+}
+
+bool OPCJournalScanner::next(OPCJournalEntry &entry){
+	while (at + OPC_JOURNAL_OVERHEAD <= len){
+		const uint8_t *start = (const uint8_t *)memchr(&image[at], OPC_JOURNAL_MAGIC & 0xFF, len - at);	//Jump to the next possible entry
+		if (!start) break;
+		uint64_t offset = start - image;
+		skipped += offset - at;
+		at = offset;
+		if (at + OPC_JOURNAL_OVERHEAD > len) break;
+
+		uint16_t length = getU16(&start[2]);
+		uint64_t total = (uint64_t)OPC_JOURNAL_OVERHEAD + length;
+		if (start[1] != (OPC_JOURNAL_MAGIC >> 8) || length > OPC_JOURNAL_MAX_PAYLOAD || at + total > len ||
+			getU16(&start[total - 2]) != opcCRC16(start, total - 2)){	//Not an entry, or a damaged one. Try the next byte.
+			at++;
+			skipped++;
+			continue;
+		}
+
+		entry.length = length;
+		entry.sequence = getU32(&start[4]);
+		entry.boot = getU16(&start[8]);
+		entry.kind = start[10];
+		entry.time = getU32(&start[12]);
+		entry.data = &start[OPC_JOURNAL_HEADER];
+		entry.offset = offset;
+		at += total;
+		found++;
+		return true;
+	}
+	skipped += len - at;												//The tail is too short to hold an entry
+	at = len;
+	return false;
+}
+
+uint64_t OPCJournalScanner::getSkipped(){ return skipped; }
+
+uint32_t OPCJournalScanner::getFound(){ return found; }
+
+
+
+//////////JOURNAL//////////
+
+
+
+OPCJournal::OPCJournal(OPCLogger &logger){
+	log = &logger;
+	boot = 0;
+	sequence = 0;
+	commitEntries = 64;
+	commitTime = 10000;
+	sinceCommit = 0;
+	lastCommit = 0;
+	commits = 0;
+	failures = 0;
+}
+
+void OPCJournal::setCommit(uint32_t entries, unsigned long ms){
+	commitEntries = entries;
+	commitTime = ms;
+}
+
+bool OPCJournal::begin(uint16_t bootNumber){
+	boot = bootNumber;
+	sequence = 0;
+	sinceCommit = 0;
+	lastCommit = millis();
+	return append(OPC_JOURNAL_BOOT, NULL, 0);
+}
+
+bool OPCJournal::append(uint8_t kind, const void *data, uint16_t len){
+	if (len > OPC_JOURNAL_MAX_PAYLOAD) return false;
+	uint8_t entry[OPC_JOURNAL_MAX_PAYLOAD + OPC_JOURNAL_OVERHEAD];
+	uint32_t now = millis();
+
+	entry[0] = OPC_JOURNAL_MAGIC & 0xFF;
+	entry[1] = OPC_JOURNAL_MAGIC >> 8;
+	entry[2] = len & 0xFF;
+	entry[3] = len >> 8;
+	for (uint8_t i = 0; i < 4; i++) entry[4 + i] = (sequence >> (8*i)) & 0xFF;
+	entry[8] = boot & 0xFF;
+	entry[9] = boot >> 8;
+	entry[10] = kind;
+	entry[11] = 0;
+	for (uint8_t i = 0; i < 4; i++) entry[12 + i] = (now >> (8*i)) & 0xFF;
+	if (len) memcpy(&entry[OPC_JOURNAL_HEADER], data, len);
+	uint16_t crc = opcCRC16(entry, OPC_JOURNAL_HEADER + len);
+	entry[OPC_JOURNAL_HEADER + len] = crc & 0xFF;
+	entry[OPC_JOURNAL_HEADER + len + 1] = crc >> 8;
+
+	sequence++;															//A failed entry keeps its number, so the gap shows in recovery
+	sinceCommit++;
+	if (log->write(entry, OPC_JOURNAL_OVERHEAD + len)) return true;
+	failures++;
+	return false;
+}
+
+bool OPCJournal::appendLine(const char *line){ return append(OPC_JOURNAL_TEXT, line, strlen(line)); }
+
+#ifdef ARDUINO
+bool OPCJournal::appendLine(const String &line){ return appendLine(line.c_str()); }
+#endif
+
+bool OPCJournal::appendRecord(const uint8_t *record, uint16_t len){ return append(OPC_JOURNAL_RECORD, record, len); }
+
+bool OPCJournal::commit(){
+	bool success = append(OPC_JOURNAL_COMMIT, NULL, 0);
+	if (!log->sync()) success = false;									//Pads out the block, writes it, and syncs the card
+	if (!success) failures++;
+	sinceCommit = 0;
+	lastCommit = millis();
+	commits++;
+	return success;
+}
+
+bool OPCJournal::service(){
+	bool success = log->service();
+	bool due = (commitEntries && sinceCommit >= commitEntries) || (commitTime && millis() - lastCommit >= commitTime);
+	if (due && sinceCommit) success = commit() && success;				//Nothing new, nothing to commit
+	return success;
+}
+
+uint16_t OPCJournal::getBoot(){ return boot; }
+
+uint32_t OPCJournal::getSequence(){ return sequence; }
+
+uint32_t OPCJournal::getCommits(){ return commits; }
+
+uint32_t OPCJournal::getFailures(){ return failures; }
@@ -0,0 +1,111 @@
+//Optical Particle Counter Library
+
+//University of Minnesota - Candler MURI
+
+/*This is the header file for the crash-safe journal.
+A brown-out in flight can cut the log off in the middle of a block, and plain
+CSV lines give no way to tell what was lost. The hit counts of the sensors do
+not help either, since .initOPC() starts them over, and they only count good
+logs. An OPCJournal object wraps each record in an entry with its own length,
+sequence number, boot number, and CRC, and writes it through an OPCLogger.
+
+Every so often (a number of entries, or a length of time) the journal is
+committed: a commit entry is added, and the logger pads out its block and
+syncs the card. Everything up to a commit is on the card even if the power
+goes out right after. Entries after the last commit may or may not be.
+
+Entry layout, little endian:
+ - magic (OPC_JOURNAL_MAGIC, 2 bytes), payload length (2), sequence (4),
+   boot (2), kind (OPC_JOURNAL_*), 0, time in ms (4)
+ - payload
+ - CRC-16/CCITT of the header and payload (2)
+
+The sequence starts at 0 on every boot, so the boot and sequence together
+always increase. The boot number must come from somewhere that survives a
+power cycle, such as the EEPROM.
+
+OPCJournalScanner finds the good entries in a damaged image, skipping any
+bytes that are not part of one (padding, torn writes, corrupted blocks). It
+has no Arduino dependencies, and extras/journal/opcrecover.cpp uses it to
+rebuild a clean log on a computer.
+*/
+
+
+#ifndef OPCJournal_h
+#define OPCJournal_h
+
+#include "OPCLogger.h"
+#include "OPCRecord.h"
+
+#define OPC_JOURNAL_MAGIC 0x4AEB										//First two bytes of every entry, EB 4A on the card
+#define OPC_JOURNAL_HEADER 16											//Bytes before the payload
+#define OPC_JOURNAL_OVERHEAD 18											//Header and CRC
+#define OPC_JOURNAL_MAX_PAYLOAD 512										//Longest payload, also the stack used by .append()
+
+#define OPC_JOURNAL_BOOT 0												//Entry kinds: first entry of a boot
+#define OPC_JOURNAL_COMMIT 1											//Everything before it is on the card
+#define OPC_JOURNAL_TEXT 2												//A CSV line, without the newline
+#define OPC_JOURNAL_RECORD 3											//A binary record (OPCRecordHeader and data)
+
+
+
+struct OPCJournalEntry{													//One entry found by the scanner
+	uint32_t sequence;
+	uint16_t boot;
+	uint8_t kind;
+	uint32_t time;														//millis() when it was written
+	uint16_t length;													//Payload bytes
+	const uint8_t *data;												//Payload, in the image
+	uint64_t offset;													//Where the entry starts in the image
+};
+
+class OPCJournalScanner
+{
+	private:
+	const uint8_t *image;
+	uint64_t len;
+	uint64_t at;														//Where the scan is
+	uint64_t skipped;													//Bytes that were not part of a good entry
+	uint32_t found;
+
+	public:
+	OPCJournalScanner(const uint8_t *data, uint64_t length);
+	bool next(OPCJournalEntry &entry);									//Find the next good entry. False at the end of the image.
+	uint64_t getSkipped();
+	uint32_t getFound();
+};
+
+
+
+class OPCJournal
+{
+	private:
+	OPCLogger *log;
+	uint16_t boot;
+	uint32_t sequence;													//Sequence of the next entry
+	uint32_t commitEntries;												//Entries between commits, 0 for no limit
+	unsigned long commitTime;											//Time between commits (ms), 0 for no limit
+	uint32_t sinceCommit;												//Entries since the last commit
+	unsigned long lastCommit;											//Time of the last commit
+	uint32_t commits;
+	uint32_t failures;													//Entries or commits that hit a card write error
+
+	public:
+	OPCJournal(OPCLogger &logger);
+	void setCommit(uint32_t entries, unsigned long ms);					//Commit after this many entries, or this much time (default 64 entries, 10 s)
+	bool begin(uint16_t bootNumber);									//Start the sequence over and write the boot entry
+	bool append(uint8_t kind, const void *data, uint16_t len);			//Add an entry. False if it is too long or the logger failed.
+	bool appendLine(const char *line);									//Add a CSV line
+#ifdef ARDUINO
+	bool appendLine(const String &line);								//Add a .logUpdate() string
+#endif
+	bool appendRecord(const uint8_t *record, uint16_t len);				//Add a record from .logBinary()
+	bool commit();														//Add a commit entry and sync the card
+	bool service();														//Write out the logger, and commit when due. Call from the loop.
+	uint16_t getBoot();
+	uint32_t getSequence();												//Sequence of the next entry
+	uint32_t getCommits();
+	uint32_t getFailures();
+};
+
+#endif
@@ -0,0 +1,174 @@
+//Optical Particle Counter Library
+
+//University of Minnesota - Candler MURI
+
+/*This is the definitions file for the OPC block logger.
+Records are copied into the filling block until it is full. The full block is
+then handed off and written whole by .service(), while new records go into the
+other block. See OPCLogger.h for the details.*/
+
+#include "OPCLogger.h"
+
+#ifndef ARDUINO
+#include <time.h>
+
+static uint32_t micros(){												//Host stand-in for the microsecond clock
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint32_t)(now.tv_sec*1000000UL + now.tv_nsec/1000);
+}
+#endif
+
+
+
+//////////BLOCK DEVICES//////////
+
+
+
+#ifdef ARDUINO
+OPCPrintDevice::OPCPrintDevice(Print *output){ out = output; }
+
+bool OPCPrintDevice::writeBlock(const uint8_t *block, uint16_t len){	//Hand the whole block to the card in one call
+	return (out->write(block, len) == len);
+}
+
+void OPCPrintDevice::sync(){ out->flush(); }							//An SD File commits its directory entry on flush
+#else
+OPCFileDevice::OPCFileDevice(const char *path){ out = fopen(path, "wb"); }
+
+OPCFileDevice::~OPCFileDevice(){
+	if (out) fclose(out);
+}
+
+bool OPCFileDevice::isOpen(){ return (out != NULL); }
+
+bool OPCFileDevice::writeBlock(const uint8_t *block, uint16_t len){
+	if (!out) return false;
+	return (fwrite(block, 1, len, out) == len);
+}
+
+void OPCFileDevice::sync(){
+	if (out) fflush(out);
+}
+#endif
+
+
+
+//////////LOGGER//////////
+
+
+
+OPCLogger::OPCLogger(OPCBlockDevice *device){
+	dev = device;
+	active = 0;
+	fill = 0;
+	pending = false;
+	padByte = '\n';														//Padding shows up as blank lines in a CSV log
+	resetMetrics();
+}
+
+void OPCLogger::setPadByte(uint8_t pad){ padByte = pad; }
+
+bool OPCLogger::write(const uint8_t *data, uint16_t len){				//Pack record bytes into the blocks
+	bool success = true;
+	bytesLogged += len;
+
+	while (len > 0){
+		uint16_t room = OPC_BLOCK_SIZE - fill;
+		uint16_t chunk = (len < room) ? len : room;
+
+		memcpy(&blocks[active][fill], data, chunk);						//Records may run across a block boundary
+		fill += chunk;
+		data += chunk;
+		len -= chunk;
+
+		if (fill == OPC_BLOCK_SIZE){									//The filling block is full, so it needs to be swapped out
+			if (pending){												//The other block has not been written yet. This is a stall.
+				uint32_t stallStart = micros();
+				if (!writePending()) success = false;
+				uint32_t stallLength = micros() - stallStart;
+				stalls++;
+				stallTime += stallLength;
+				if (stallLength > maxStallTime) maxStallTime = stallLength;
+			}
+			pending = true;												//Hand off the full block and start on the other
+			active ^= 1;
+			fill = 0;
+		}
+
+		uint16_t held = fill + (pending ? OPC_BLOCK_SIZE : 0);
+		if (held > highWater) highWater = held;
+	}
+	return success;
+}
+
+bool OPCLogger::writeLine(const char *record){							//Text records are written one per line
+	if (!write((const uint8_t *)record, strlen(record))) return false;
+	uint8_t newline = '\n';
+	return write(&newline, 1);
+}
+
+#ifdef ARDUINO
+bool OPCLogger::writeLine(const String &record){ return writeLine(record.c_str()); }
+#endif
+
+bool OPCLogger::writePending(){											//Write the full block that is not filling
+	uint32_t writeStart = micros();
+	bool success = dev->writeBlock(blocks[active ^ 1], OPC_BLOCK_SIZE);
+	uint32_t writeLength = micros() - writeStart;
+
+	if (writeLength > maxWriteTime) maxWriteTime = writeLength;
+	if (success) blocksWritten++;
+	else writeErrors++;													//The block is dropped either way, so the buffers can't jam
+	pending = false;
+	return success;
+}
+
+bool OPCLogger::service(){												//Called from the loop to write the full block in the background
+	if (!pending) return true;
+	return writePending();
+}
+
+bool OPCLogger::sync(){													//Square off the filling block and write everything out
+	bool success = service();
+
+	if (fill > 0){
+		memset(&blocks[active][fill], padByte, OPC_BLOCK_SIZE - fill);	//Padding keeps every later write on a block boundary
+		pending = true;
+		active ^= 1;
+		fill = 0;
+		if (!writePending()) success = false;
+	}
+
+	dev->sync();
+	return success;
+}
+
+uint16_t OPCLogger::buffered(){ return fill + (pending ? OPC_BLOCK_SIZE : 0); }
+
+uint32_t OPCLogger::getHighWater(){ return highWater; }
+
+uint32_t OPCLogger::getStalls(){ return stalls; }
+
+uint32_t OPCLogger::getStallTime(){ return stallTime; }
+
+uint32_t OPCLogger::getMaxStallTime(){ return maxStallTime; }
+
+uint32_t OPCLogger::getMaxWriteTime(){ return maxWriteTime; }
+
+uint32_t OPCLogger::getBlocksWritten(){ return blocksWritten; }
+
+uint32_t OPCLogger::getWriteErrors(){ return writeErrors; }
+
+uint32_t OPCLogger::getBytesLogged(){ return bytesLogged; }
+
+void OPCLogger::resetMetrics(){
+	highWater = buffered();
+	stalls = 0;
+	stallTime = 0;
+	maxStallTime = 0;
+	maxWriteTime = 0;
+	blocksWritten = 0;
+	writeErrors = 0;
+	bytesLogged = 0;
+}
@@ -0,0 +1,115 @@
+//Optical Particle Counter Library
+
+//University of Minnesota - Candler MURI
+
+/*This is the header file for the OPC block logger.
+The logger takes the records made by any of the OPC classes (the CSV strings
+from .logUpdate(), or raw bytes) and packs them back to back into 512 byte
+blocks. Two blocks are kept in a ping-pong arrangement: one block fills while
+the other waits to be written out, so the card only ever sees whole, block
+aligned writes and never has to do a read-modify-write of a partial sector.
+
+The full block is written by .service(), which should be called from the loop
+whenever there is slack time (after the sensors are read, for example). If the
+filling block runs out of room before the other block has been written, the
+logger has no choice but to write it right away. This is counted as a stall.
+
+On the microcontroller, the blocks are written to any Print object (an SD File).
+On a computer, the blocks are written to a plain file that stands in for the card.
+*/
+
+
+#ifndef OPCLogger_h
+#define OPCLogger_h
+
+#ifdef ARDUINO
+#include <arduino.h>
+#else
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#endif
+
+#define OPC_BLOCK_SIZE 512												//Size of a card sector
+
+
+class OPCBlockDevice													//Anything that can take a full block
+{
+	public:
+	virtual bool writeBlock(const uint8_t *block, uint16_t len) = 0;	//Write one block, true if all bytes were taken
+	virtual void sync() {}												//Push the written blocks to the card
+};
+
+#ifdef ARDUINO
+class OPCPrintDevice: public OPCBlockDevice								//Block device on a Print object, such as an SD File
+{
+	private:
+	Print *out;
+
+	public:
+	OPCPrintDevice(Print *output);
+	bool writeBlock(const uint8_t *block, uint16_t len);
+	void sync();
+};
+#else
+class OPCFileDevice: public OPCBlockDevice								//Block device on a plain file, for use on a computer
+{
+	private:
+	FILE *out;
+
+	public:
+	OPCFileDevice(const char *path);
+	~OPCFileDevice();
+	bool isOpen();
+	bool writeBlock(const uint8_t *block, uint16_t len);
+	void sync();
+};
+#endif
+
+
+
+class OPCLogger
+{
+	private:
+	OPCBlockDevice *dev;												//Where the blocks go
+	uint8_t blocks[2][OPC_BLOCK_SIZE];									//Ping-pong buffers
+	uint8_t active;														//Index of the block that is filling
+	uint16_t fill;														//Bytes in the filling block
+	bool pending;														//The other block is full and waiting to be written
+	uint8_t padByte;													//Byte used to square off a partial block on sync
+
+	uint32_t highWater;													//Most bytes ever held in the buffers
+	uint32_t stalls;													//Number of times a write had to wait on the card
+	uint32_t stallTime;													//Total time spent waiting on the card (us)
+	uint32_t maxStallTime;												//Longest single wait on the card (us)
+	uint32_t maxWriteTime;												//Longest single block write (us)
+	uint32_t blocksWritten;												//Number of blocks sent to the device
+	uint32_t writeErrors;												//Number of blocks the device did not take
+	uint32_t bytesLogged;												//Number of record bytes accepted
+
+	bool writePending();												//Write the waiting block out
+
+	public:
+	OPCLogger(OPCBlockDevice *device);
+	void setPadByte(uint8_t pad);										//Byte used to fill out the last block on sync (default newline)
+	bool write(const uint8_t *data, uint16_t len);						//Add raw record bytes
+	bool writeLine(const char *record);									//Add a record as a line of text
+#ifdef ARDUINO
+	bool writeLine(const String &record);								//Add a .logUpdate() string as a line
+#endif
+	bool service();														//Write the waiting block, if there is one. Call from the loop.
+	bool sync();														//Pad out and write everything, then sync the device
+
+	uint16_t buffered();												//Bytes currently held in the buffers
+	uint32_t getHighWater();											//Logger metrics
+	uint32_t getStalls();
+	uint32_t getStallTime();
+	uint32_t getMaxStallTime();
+	uint32_t getMaxWriteTime();
+	uint32_t getBlocksWritten();
+	uint32_t getWriteErrors();
+	uint32_t getBytesLogged();
+	void resetMetrics();
+};
+
+#endif
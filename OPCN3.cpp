@@ -0,0 +1,466 @@
+//Optical Particle Counter Library
+
+//University of Minnesota - Candler MURI
+
+/*This is the definitions file for the Alphasense N3.
+The Alphasense N3 runs the read data function with the log update function,
+and can record new data every 1 seconds. The N3 runs on SPI.*/
+
+#include "OPCSensor.h"
+
+#if OPC_USE_N3
+
+#ifdef OPC_STATIC_RAM
+static_assert(sizeof(N3) <= OPC_RAM_N3, "N3 is over its RAM budget");	//RAM budget from OPCConfig.h
+#endif
+
+
+
+//////////N3///////////
+
+
+
+N3::N3(uint8_t slave) : OPC() { 										//Constructor
+	CS = slave; 														//Set up SPI slave pin
+	pinMode(CS,OUTPUT);
+	pumpMode = false;
+	commandOpen = false;
+	lastByte = 0;
+	readMode = ALPHA_READ_HISTOGRAM;
+	histogramPeriod = 10000;
+	lastHistogram = 0;
+	histogram = false;
+	retry.setAttempts(20);												//The N3 can take a long time to answer its first commands
+	retry.setBackoff(500, 3000);
+	retry.setDeadline(30000);
+	retry.setSequenceDeadline(30000);									//A power on or off is two commands, and a reset is four
+	setStaleLimit(N3_STALE_LIMIT);
+}	
+
+bool N3::initCommand(byte command){										//starting command system. This is the internal guts as a condensed version of the 
+  byte byte1 = 0;														//R1 protocol. This system takes a long period of time, under the theory that once
+  byte byte2 = 0; 														//the command connection is established, the system will be able to successfully connect
+  unsigned short bail = 0;												//regularly. The retry policy bounds the attempts and the total time.
+  bool success = false;
+  
+  if (!claimSPI()) return false;										//Another sensor is in the middle of a polled handshake
+  retry.begin();
+  digitalWrite(CS,LOW);													//Open data translation
+  SPI.beginTransaction(SPISettings(N3_SPEED, MSBFIRST, SPI_MODE1));
+  delay(10);
+  
+  while (!success && !retry.isExhausted()){								//Check for success or bail circumstances
+	  delay(1);
+	  byte1 = byte2;
+	  byte2 = SPI.transfer(0x03);
+	  delay(10);
+	  bail++;
+	  success = ((byte1 == 0x31)&&(byte2 == 0xF3));
+	  if ((byte1 != 0x31)&&(byte2 !=0x31)&&(bail > 10)){
+		bail = 0;
+		digitalWrite(CS, HIGH); 		
+		SPI.endTransaction(); 
+		if (retry.backoff()) retry.wait();								//Give the N3 time to recover, unless no attempts remain
+		digitalWrite(CS,LOW);											//Open data translation
+		SPI.beginTransaction(SPISettings(N3_SPEED, MSBFIRST, SPI_MODE1));
+		delay(10);
+	}
+  }
+  
+  if (success) {														//If the system is able to connect, indicate success
+	  	byte2 = SPI.transfer(command);
+		SPI.endTransaction(); 
+		digitalWrite(CS, HIGH); 
+		releaseSPI();
+		retry.succeed();
+		return true;
+  } else {
+	  SPI.endTransaction(); 
+	  digitalWrite(CS, HIGH); 
+	  releaseSPI();
+	  return retry.giveUp();
+  }
+}
+
+
+void N3::laserOn(){														//laser on
+	initCommand(0x07);													//The retry policy makes the redundant attempts for each general command.
+}
+
+void N3::laserOff(){													//laser off
+	initCommand(0x06);
+}
+
+void N3::fanOn(){														//fan on
+	initCommand(0x03);
+}
+
+void N3::fanOff(){														//fan off
+	initCommand(0x02);
+}
+
+void N3::powerOn(){														//This pulls fan and laser commands together to mirror other systems.
+	retry.beginSequence();												//Both commands and the waits share one deadline.
+	retry.pause(1000);
+	fanOn();
+	retry.pause(500);
+	laserOn();
+	retry.pause(1000);
+	retry.endSequence();
+}
+
+void N3::powerOnPump(){													//This system only turns on the laser for pump use
+	retry.beginSequence();
+	retry.pause(1000);
+	fanOff();
+	retry.pause(50);
+	laserOn();
+	retry.pause(1000);
+	retry.endSequence();
+}
+
+void N3::powerOff(){
+	retry.beginSequence();
+	fanOff();
+	retry.pause(50);
+	laserOff();
+	retry.pause(50);
+	retry.endSequence();
+}
+
+void N3::initOPC(char t){
+	OPC::initOPC();														//Calls original init
+
+	SPI.begin();        											 	//Intialize SPI in Arduino
+	digitalWrite(CS,HIGH);												//Pull the pin up so there is no data leakage
+	delay(2500);
+	if (t == 'p') powerOnPump();										//if the correct trigger is passed, the system will init in pump mode
+	else powerOn();												
+}
+
+uint8_t N3::pollCommand(byte command){									//Non-blocking version of the command system. Each poll sends one byte
+	if (!retry.ready()) return OPC_INIT_BUSY;							//of the handshake in its own SPI transaction. Slave select stays low
+	if ((millis() - initTime) < 10) return OPC_INIT_BUSY;				//between polls, with the bus claimed, and after 10 misses it is
+																		//raised while the retry policy backs off.
+	
+	if (retry.isExhausted()){											//Out of time, even if the N3 is still busy
+		closeCommand();
+		retry.giveUp();
+		return OPC_INIT_FAILED;
+	}
+	
+	if (!commandOpen && !claimSPI()) return OPC_INIT_BUSY;				//Wait for the other sensor to finish its handshake
+	SPI.beginTransaction(SPISettings(N3_SPEED, MSBFIRST, SPI_MODE1));
+	if (!commandOpen){
+		digitalWrite(CS,LOW);											//Open data translation
+		commandOpen = true;
+		lastByte = 0;
+		initTries = 0;
+	}
+	
+	byte response = SPI.transfer(0x03);
+	initTime = millis();
+	initTries++;
+	bool success = ((lastByte == 0x31)&&(response == 0xF3));
+	bool busy = ((lastByte == 0x31)||(response == 0x31));
+	lastByte = response;
+	if (success) SPI.transfer(command);									//If the system is able to connect, send the command
+	SPI.endTransaction();
+	
+	if (success){
+		closeCommand();
+		retry.succeed();
+		return OPC_INIT_READY;
+	}
+	
+	if ((!busy && (initTries > 10)) || (initTries >= 20)){				//Close the connection and back off. A busy N3 also gets
+		closeCommand();													//at most 20 polls, so the other sensors get their turn.
+		if (!retry.backoff()){
+			retry.giveUp();
+			return OPC_INIT_FAILED;
+		}
+	}
+	return OPC_INIT_BUSY;
+}
+
+void N3::closeCommand(){												//Raise slave select, and let the other sensors use the bus
+	if (!commandOpen) return;
+	digitalWrite(CS, HIGH);
+	commandOpen = false;
+	releaseSPI();
+}
+
+void N3::beginInit(){													//Non-blocking version of the initialization
+	OPC::initOPC();
+	
+	SPI.begin();        											 	//Intialize SPI in Arduino
+	digitalWrite(CS,HIGH);												//Pull the pin up so there is no data leakage
+	commandOpen = false;
+	initState = OPC_INIT_BUSY;
+	initStep = 0;
+	initTime = millis();
+	retry.begin();
+}
+
+void N3::beginInit(char t){
+	pumpMode = (t == 'p');												//if the correct trigger is passed, the system will init in pump mode
+	beginInit();
+}
+
+uint8_t N3::pollInit(){													//The fan command is sent, then the laser command. Each is polled until the
+	if (initState != OPC_INIT_BUSY) return initState;					//N3 answers, rather than waiting out fixed delays.
+	
+	bool laser = (initStep & 0x80);										//The top bit of the step marks the laser command
+	uint8_t result = pollCommand(laser ? 0x07 : (pumpMode ? 0x02 : 0x03));
+	
+	if (result == OPC_INIT_FAILED) initState = OPC_INIT_FAILED;
+	else if (result == OPC_INIT_READY){
+		if (laser) initState = OPC_INIT_READY;
+		else {
+			initStep = 0x80;
+			retry.begin();												//The laser command gets its own attempts
+		}
+	}
+	return initState;
+}
+
+void N3::abortInit(){													//Called when the startup gives up, even in the middle of a handshake
+	closeCommand();
+	OPC::abortInit();
+}
+
+static const char n3Header[] PROGMEM = ",Bin0,Bin1,Bin2,Bin3,Bin4,Bin5,Bin6,Bin7,Bin8,Bin9,"
+	"Bin10,Bin11,Bin12,Bin13,Bin14,Bin15,Bin16,Bin17,Bin18,Bin19,"
+	"Bin20,Bin21,Bin22,Bin23,Bin1 Time,Bin3 Time,Bin5 Time,Bin7 Time,"
+	"Sampling Period,Flow Rate,Temp,Humidity,PM1,PM2_5,PM10";
+
+uint16_t N3::CSVHeader(char *buf, uint16_t len){ return headerText(n3Header, buf, len); }	//Header for log update
+
+bool N3::update(){														//Reads the data and updates the log quality for the log functions
+	if (sleeping()) return false;										//A sleeping sensor is not read
+	
+	if (takeSample()){
+	   setQuality(true);
+       goodLogAge = millis();
+       badLog = 0;
+       if (warmingUp()) return false;									//Samples during the warm-up are thrown out
+       nTot++;
+       return true;
+	}
+	
+	badLog ++;
+	if (badLog >= 5) setQuality(false);									//Good log situation the same as in the Plantower code
+#if OPC_USE_RESET
+	if ((millis()-goodLogAge)>=resetTime) {								//If the age of the last good log exceeds the automatic reset trigger,
+		fire(OPC_EVENT_RESET_START, 0, millis() - goodLogAge);
+		retry.beginSequence();											//The whole reset shares one deadline
+		powerOff();														//the system will cycle and clean the dust bin.
+		retry.pause(2000);												//The system now has a function checksum
+		powerOn();
+		retry.pause(100);
+		retry.endSequence();
+		goodLogAge = millis();
+		fire(OPC_EVENT_RESET_END, 0, 0);
+	}
+#endif
+	return false;
+}
+
+void N3::setReadMode(uint8_t mode, unsigned long period){			//In PM mode, the histogram keeps counting between histogram reads,
+	readMode = mode;													//so each histogram covers the whole period.
+	histogramPeriod = period;
+	lastHistogram = millis() - period;									//The first read is a histogram
+}
+
+uint8_t N3::getReadMode(){ return readMode; }
+
+bool N3::isHistogram(){ return histogram; }
+
+int16_t N3::getTemperature(){ return opcCentiDegrees(localData->tempRaw); }
+
+uint16_t N3::getHumidity(){ return opcPerMille(localData->humidRaw); }
+
+void N3::dataText(OPCText &text, bool fresh){							//Bins, bin times, period, flow, temperature, humidity, and PM values
+	if (!fresh){
+		missingText(text, 35);
+		return;
+	}
+	
+	if (histogram){														//If the histogram is read, shift the data from the struct into the CSV.
+		for (unsigned short i = 0; i < 24; i++){
+			text.add(',');
+			text.add((unsigned long)localData->bins[i]);
+		}
+		const uint16_t columns[6] = {localData->bin1time, localData->bin2time, localData->bin3time, localData->bin4time,
+			localData->samplePeriod, localData->sampleFlowRate};
+		for (unsigned short i = 0; i < 6; i++){
+			text.add(',');
+			text.add((unsigned long)columns[i]);
+		}
+		text.add(',');
+		text.addFixed(getTemperature(), 2);								//Degrees C and percent RH, from the raw words
+		text.add(',');
+		text.addFixed(getHumidity(), 1);
+	} else missingText(text, 32);										//A PM-only read has no histogram
+	
+	text.add(',');
+	text.add(pmData->pm1, 2);
+	text.add(',');
+	text.add(pmData->pm2_5, 2);
+	text.add(',');
+	text.add(pmData->pm10, 2);
+}
+
+uint16_t N3::logLine(char *buf, uint16_t len){							//CSV creator and system updator
+	unsigned int hits = nTot;
+	bool fresh = update();
+	return lineText(hits, fresh, buf, len);
+}
+
+uint16_t N3::logBinary(uint8_t *buf, uint16_t len){						//Same as log update, but packed into a binary record
+	unsigned int hits = nTot;
+	bool fresh = update();
+	if (fresh && !histogram) return packRecord(OPC_TYPE_N3_PM, hits, fresh, &pmData.latest(), sizeof(OPCPMdata), buf, len);
+	return packRecord(OPC_TYPE_N3, hits, fresh, &localData.latest(), sizeof(N3data), buf, len);
+}
+
+uint8_t N3::getData(float *data, uint8_t len){							//Bin counts, 24 bins
+	if (!histogram) return 0;											//A PM-only read has no bins
+	if (len > 24) len = 24;
+	for (uint8_t i = 0; i < len; i++) data[i] = localData->bins[i];
+	return len;
+}
+
+uint8_t N3::getBins(){ return 24; }
+
+#if OPC_USE_READOUT
+uint16_t N3::logReadout(const char *name, char *buf, uint16_t len){		//Same as log update, but with a readout for the serial monitor
+	unsigned int hits = nTot;
+	bool fresh = update();
+	OPCReadout readout;
+	readoutStart(readout, PSTR("N3"), name, getSampleAge());
+	
+	if (fresh){
+		if (histogram){													//A PM-only read has no bins
+			for (unsigned short i = 0; i < 24; i++){
+				readout.addFlash(PSTR("Bin "));
+				readout.add((unsigned long)i);
+				readout.line(PSTR(": "), (unsigned long)localData->bins[i]);
+			}
+		}
+		readout.line(PSTR("PM1: "), pmData->pm1, 2);
+		readout.line(PSTR("PM2.5: "), pmData->pm2_5, 2);
+		readout.line(PSTR("PM10: "), pmData->pm10, 2);
+	} else readout.line(PSTR("Bad log"));
+	
+	readoutSend(readout);
+	return lineText(hits, fresh, buf, len);
+}
+#endif
+
+#ifndef OPC_STATIC_RAM
+String N3::CSVHeader(){
+	char line[OPC_LINE_SIZE];
+	CSVHeader(line, sizeof(line));
+	return String(line);
+}
+
+String N3::logUpdate(){
+	char line[OPC_LINE_SIZE];
+	logLine(line, sizeof(line));
+	return String(line);
+}
+
+#if OPC_USE_READOUT
+String N3::logReadout(String name){
+	char line[OPC_LINE_SIZE];
+	logReadout(name.c_str(), line, sizeof(line));
+	return String(line);
+}
+#endif
+#endif
+
+float N3::getSampleVolume(){											//The N3 sends the flow (ml/s) and the period (s), each times 100
+	if (!histogram) return 0;
+	return (float)localData->sampleFlowRate*localData->samplePeriod*0.0001;
+}
+
+float N3::getSamplePeriod(){											//Centiseconds since the last histogram read
+	if (!histogram) return 0;
+	return localData->samplePeriod*0.01;
+}
+
+bool N3::readData(){ 													//Internal data reading function. In PM mode, the histogram is only read once a period.
+	if ((readMode == ALPHA_READ_PM) && ((millis() - lastHistogram) < histogramPeriod)) return readPM();
+	return readHistogram();
+}
+
+bool N3::readHistogram(){
+	byte transmitData[86] = {0};
+	uint64_t arrival = 0;
+	
+	if (!alphaRead(CS, N3_SPEED, 0x30, transmitData, 86, arrival)) return false;	//If the system does not succeed, return a failure
+	
+	N3data &frame = localData.scratch();								//Decode into the scratch copies, so a bad transfer is never seen
+	OPCPMdata &pm = pmData.scratch();
+	memcpy(&frame, &transmitData, 86);									//Copy the data to the struct
+
+	if (frame.checkSum != CalcCRC(transmitData, 84)) return false;	//return the checksum results
+	
+	uint32_t quality = alphaPMQuality(frame.pm1, frame.pm2_5, frame.pm10);	//Plausibility of the diagnostics, as quality bits
+	if ((frame.sampleFlowRate < N3_FLOW_MIN) || (frame.sampleFlowRate > N3_FLOW_MAX)) quality |= OPC_FLAG_FLOW;
+	if (frame.laserStatus < N3_LASER_MIN) quality |= OPC_FLAG_LASER;
+	if (!pumpMode && (frame.fanRevCount == 0)) quality |= OPC_FLAG_FAN;	//There is no fan with an outside pump
+	if (frame.rejectCountGlitch > N3_GLITCH_MAX) quality |= OPC_FLAG_GLITCH;
+	if (!checkFrame(transmitData, 84, quality)) return false;			//A stale histogram is not published
+	
+	pm.pm1 = frame.pm1;
+	pm.pm2_5 = frame.pm2_5;
+	pm.pm10 = frame.pm10;
+	pm.sampleTime = frame.sampleTime = sampleTime = arrival;	//Only a good transfer updates the sample time
+	localData.publish();
+	pmData.publish();
+	lastHistogram = millis();
+	histogram = true;
+	sampleEvent();
+	return true;
+}
+
+bool N3::readPM(){														//PM values only: 12 bytes of floats and a checksum
+	byte transmitData[14] = {0};
+	uint64_t arrival = 0;
+	
+	if (!alphaRead(CS, N3_SPEED, 0x32, transmitData, 14, arrival)) return false;
+	if (bytes2int(transmitData[12],transmitData[13]) != CalcCRC(transmitData, 12)) return false;
+	
+	OPCPMdata &pm = pmData.scratch();
+	memcpy(&pm, transmitData, 12);
+	if (!alphaCheckPM(alphaPMQuality(pm.pm1, pm.pm2_5, pm.pm10))) return false;
+	pm.sampleTime = sampleTime = arrival;
+	pmData.publish();
+	histogram = false;
+	sampleEvent();
+	return true;
+}
+	
+unsigned int N3::CalcCRC(unsigned char data[], unsigned char nbrOfBytes){
+    #define POLYNOMIAL 0xA001 											//Generator polynomial for CRC
+    #define InitCRCval 0xFFFF 											//Initial CRC value
+    unsigned char _bit; 												//Bit mask
+    unsigned int crc = InitCRCval; 										//Initialise calculated checksum 
+    unsigned char byteCtr; 												//Byte counter
+																		//Calculates 16-Bit checksum with given polynomial  
+    for(byteCtr = 0; byteCtr < nbrOfBytes; byteCtr++) {
+      crc ^= (unsigned int)data[byteCtr]; 
+      for(_bit = 0; _bit < 8; _bit++) {
+        if (crc & 1) 													//If bit0 of crc is 1
+        {
+            crc >>= 1;
+            crc ^= POLYNOMIAL; 
+        } else crc >>= 1;
+      }
+    }
+    return crc; 
+}
+
+#endif
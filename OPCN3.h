@@ -0,0 +1,96 @@
+//Optical Particle Counter Library
+
+//University of Minnesota - Candler MURI
+
+/*This is the header file for the Alphasense N3.
+The Alphasense N3 runs the read data function with the log update function,
+and can record new data every 1 seconds. The N3 runs on SPI.
+*/
+
+
+#ifndef OPCN3_h
+#define OPCN3_h
+
+#include <SPI.h>
+#include "OPCSensor.h"
+#include "OPCClimate.h"
+#define N3_SPEED 300000
+#define N3_FLOW_MIN 100													//Plausible sample flow (hundredths of ml/s)
+#define N3_FLOW_MAX 1000
+#define N3_LASER_MIN 100												//Lowest laser status of a working laser
+#define N3_GLITCH_MAX 1000												//Most glitch rejects in a plausible histogram
+#define N3_STALE_LIMIT 3												//Each histogram has its own period, climate, and fan words, so repeats are rare
+
+
+
+class N3: public OPC {													//The R1 runs on SPI Communication
+	private:
+	uint8_t CS;															//Slave Select pin for specification. The code will only run on the default SPI pins.
+	bool initCommand(byte command);
+	uint8_t pollCommand(byte command);									//One non-blocking attempt at a command, returns the OPC_INIT_* state
+	void closeCommand();												//Close the command connection if it is open
+	bool pumpMode;														//Initialize for use with an external pump
+	bool commandOpen;													//The command connection is open between polls
+	byte lastByte;														//Last byte returned during a command poll
+	bool update();														//Read the data and update the log quality
+	unsigned int CalcCRC(unsigned char data[], unsigned char nbrOfBytes);//Checksum calculator
+	uint8_t readMode;													//ALPHA_READ_* mode
+	unsigned long histogramPeriod;										//Time between histogram reads in PM mode (ms)
+	unsigned long lastHistogram;										//Time of the last good histogram read
+	bool histogram;														//The last sample was a full histogram
+	bool readHistogram();												//Command 0x30, which also resets the histogram
+	bool readPM();														//Command 0x32, PM values only
+	void dataText(OPCText &text, bool fresh);							//Data columns of the CSV line
+	
+	public:
+	OPCSample<OPCPMdata> pmData;										//PM values of the last sample, from either read
+	void setReadMode(uint8_t mode, unsigned long period = 10000);		//ALPHA_READ_* mode, and the histogram period (ms) for PM mode
+	uint8_t getReadMode();
+	bool isHistogram();													//True if the last sample has the histogram
+	int16_t getTemperature();											//Temperature of the last histogram (centi-degrees C)
+	uint16_t getHumidity();												//Humidity of the last histogram (per-mille RH)
+	struct N3data{														//N3 Public data struct
+		uint16_t bins[24];
+		uint8_t bin1time, bin2time, bin3time, bin4time;
+		uint16_t samplePeriod, sampleFlowRate;
+		uint16_t tempRaw, humidRaw;										//Raw sensor words, see OPCClimate.h
+		float pm1, pm2_5, pm10;
+		uint16_t rejectCountGlitch, rejectCountLong, rejectCountRatio, rejectCountRange, fanRevCount, laserStatus, checkSum;
+		uint64_t sampleTime;											//Time the transfer finished (us)
+	};
+	OPCSample<N3data> localData;
+	
+	N3(uint8_t slave);													//Alphasense constructor
+	void laserOn();														//Laser on command
+	void fanOn();														//Fan on command
+	void laserOff();													//Laser off command
+	void fanOff();														//fan off command
+	void powerOn();														//Power on will activate the fan, laser, and data communication
+	void powerOnPump();													//Power on for use with an external pump
+	void powerOff();													//Power off will deactivate these same things
+	void initOPC(char t);												//Initializes the OPC
+	void beginInit();													//Non-blocking initialization
+	void beginInit(char t);												//Non-blocking initialization, 'p' for pump mode
+	uint8_t pollInit();
+	void abortInit();
+	uint16_t CSVHeader(char *buf, uint16_t len);						//CSV header, written into the buffer
+	uint16_t logLine(char *buf, uint16_t len);							//Log update, written into the buffer. Returns the length, or 0 if it does not fit
+#if OPC_USE_READOUT
+	uint16_t logReadout(const char *name, char *buf, uint16_t len);	//Log line, and a readout for the serial monitor
+#endif
+#ifndef OPC_STATIC_RAM
+	String CSVHeader();													//Overrrides the OPC data functions
+	String logUpdate();	
+#if OPC_USE_READOUT
+	String logReadout(String name);												
+#endif
+#endif
+	uint16_t logBinary(uint8_t *buf, uint16_t len);
+	uint8_t getData(float *data, uint8_t len);							//Bin counts
+	uint8_t getBins();
+	float getSampleVolume();											//Sample flow rate times the sample period
+	float getSamplePeriod();
+	bool readData();												
+};
+
+#endif
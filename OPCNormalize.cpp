@@ -0,0 +1,152 @@
+//Optical Particle Counter Library
+
+//University of Minnesota - Candler MURI
+
+/*This is the definitions file for the flow and pressure normalization.
+See OPCNormalize.h for the units and the conditions.*/
+
+#include "OPCNormalize.h"
+#include <string.h>
+
+#define KELVIN 273.15
+
+
+
+//////////NORMALIZE//////////
+
+
+
+OPCNormalize::OPCNormalize(const OPCBinLayout &binLayout){
+	layout = &binLayout;
+	counts = (layout->type == OPC_TYPE_R1) || (layout->type == OPC_TYPE_N3);
+	flowScale = 1;
+	pressure = 0;
+	temperature = 0;
+	stdPressure = OPC_STP_PRESSURE;
+	stdTemperature = OPC_STP_TEMPERATURE;
+	stpRatio = 0;
+	lastSample = 0;
+	valid = false;
+	sampleVolume = 0;
+
+	float reported = 1;													//Counts, or particles per cm^3 (SPS)
+	if (layout->type == OPC_TYPE_PLANTOWER) reported = 0.01;			//Particles per 0.1 L
+	for (uint8_t i = 0; i < layout->nBins; i++){
+		unit[i] = reported;
+		binFactor[i] = reported;
+		ambient[i] = 0;
+		stp[i] = 0;
+	}
+}
+
+void OPCNormalize::setRatio(){											//Standard over ambient density of the air: (Pstd/P)*(T/Tstd)
+	if ((pressure <= 0) || (temperature + KELVIN <= 0)){
+		stpRatio = 0;
+		return;
+	}
+	stpRatio = (stdPressure/pressure)*((temperature + KELVIN)/(stdTemperature + KELVIN));
+}
+
+void OPCNormalize::setAmbient(float ambientPressure, float ambientTemperature){
+	pressure = ambientPressure;
+	temperature = ambientTemperature;
+	setRatio();
+}
+
+void OPCNormalize::setStandard(float standardPressure, float standardTemperature){
+	stdPressure = standardPressure;
+	stdTemperature = standardTemperature;
+	setRatio();
+}
+
+void OPCNormalize::setFlowScale(float scale){
+	if (scale > 0) flowScale = scale;
+}
+
+void OPCNormalize::setBinFactor(uint8_t bin, float factor){
+	if (bin < layout->nBins) binFactor[bin] = unit[bin]*factor;
+}
+
+uint8_t OPCNormalize::getBins(){ return layout->nBins; }
+
+bool OPCNormalize::hasStandard(){ return stpRatio > 0; }
+
+bool OPCNormalize::apply(const float *bins, float volume){				//One sample, with one divide for the whole sample
+	float scale;
+	if (counts){
+		if (!(volume > 0)){												//No flow or period, such as a PM-only read
+			valid = false;
+			return false;
+		}
+		scale = 1.0/volume;
+		sampleVolume = volume;
+	} else {
+		scale = 1.0/flowScale;											//Less flow than at the ground means fewer particles were counted
+		sampleVolume = 0;
+	}
+
+	for (uint8_t i = 0; i < layout->nBins; i++){						//This loop has no branches, so it can be vectorized
+		ambient[i] = bins[i]*binFactor[i]*scale;
+		stp[i] = ambient[i]*stpRatio;
+	}
+	valid = true;
+	return true;
+}
+
+
+
+#ifdef ARDUINO
+bool OPCNormalize::update(OPC &sensor){									//Only a new sample from the sensor is normalized
+	float bins[OPC_MAX_BINS];
+	if (!sensor.getNewData(bins, layout->nBins, lastSample)){
+		valid = false;
+		return false;
+	}
+	return apply(bins, sensor.getSampleVolume());
+}
+
+String OPCNormalize::CSVHeader(){										//Ambient columns, standard columns, then the sampled volume
+	String header = "";
+	for (uint8_t i = 0; i < layout->nBins; i++){
+		if (i > 0) header += ",";
+		header += "Amb" + String(i);
+	}
+	for (uint8_t i = 0; i < layout->nBins; i++) header += ",STP" + String(i);
+	header += ",Sample Vol";
+	return header;
+}
+
+String OPCNormalize::logUpdate(){
+	String dataLogLocal = "";
+	bool standard = valid && hasStandard();								//The standard columns also need the ambient conditions
+
+	for (uint8_t i = 0; i < layout->nBins; i++){
+		if (i > 0) dataLogLocal += ",";
+		if (valid) dataLogLocal += String(ambient[i], 4);
+		else dataLogLocal += "-";										//If there is no new sample, the string is populated with failure symbols.
+	}
+	for (uint8_t i = 0; i < layout->nBins; i++){
+		if (standard) dataLogLocal += "," + String(stp[i], 4);
+		else dataLogLocal += ",-";
+	}
+	dataLogLocal += valid ? ("," + String(sampleVolume, 4)) : String(",-");
+	return dataLogLocal;
+}
+
+uint16_t OPCNormalize::logBinary(uint8_t *buf, uint16_t len){			//The data is a byte with the number of bins, the sampled volume, the standard
+																		//ratio (0 without the ambient conditions), then the ambient and standard arrays.
+	uint16_t dataLen = valid ? (1 + 2*sizeof(float) + 2*layout->nBins*sizeof(float)) : 0;
+	uint16_t at = OPC::packHeader(OPC_TYPE_NORMAL | layout->type, 0, valid ? OPC_FLAG_GOOD : 0, dataLen, buf, len);
+	if (!at || !valid) return at;
+
+	buf[at++] = layout->nBins;
+	memcpy(buf + at, &sampleVolume, sizeof(float));
+	at += sizeof(float);
+	memcpy(buf + at, &stpRatio, sizeof(float));
+	at += sizeof(float);
+	memcpy(buf + at, ambient, layout->nBins*sizeof(float));
+	at += layout->nBins*sizeof(float);
+	memcpy(buf + at, stp, layout->nBins*sizeof(float));
+	return at + layout->nBins*sizeof(float);
+}
+#endif
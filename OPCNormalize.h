@@ -0,0 +1,79 @@
+//Optical Particle Counter Library
+
+//University of Minnesota - Candler MURI
+
+/*This is the header file for the flow and pressure normalization.
+At altitude a cubic centimeter of air holds far fewer molecules than at the
+ground, so a concentration only compares across a flight once it is put at
+standard conditions. An OPCNormalize object is built for one bin layout (see
+OPCBins.h) and turns each sample into particles per cubic centimeter, both
+at the ambient conditions and at standard temperature and pressure.
+
+The R1 and N3 report raw counts along with their sample flow rate and
+period, so their counts are divided by the volume of air they sampled
+(.getSampleVolume()). The Plantower and SPS 30 report concentrations for
+the flow they draw at the ground. A measured share of that flow at altitude
+can be given with .setFlowScale().
+
+The pressure and temperature come from an outside sensor through
+.setAmbient(). The unit of each bin and any per-bin correction (such as a
+counting efficiency) are put together once into a factor for each bin, and
+the ambient and standard ratios are only worked out when they change, so
+each sample is one divide and a multiply or two for each bin.
+
+The bins keep the form the sensor reports them in. The factors and .apply()
+have no Arduino dependencies, so the same code can normalize logged data on
+a computer.
+*/
+
+
+#ifndef OPCNormalize_h
+#define OPCNormalize_h
+
+#include "OPCBins.h"
+#ifdef ARDUINO
+#include "OPCSensor.h"
+#endif
+
+#define OPC_STP_PRESSURE 1013.25										//Standard pressure (hPa)
+#define OPC_STP_TEMPERATURE 0.0											//Standard temperature (C)
+
+
+
+class OPCNormalize
+{
+	private:
+	const OPCBinLayout *layout;
+	bool counts;														//The layout is raw counts, which need the sampled volume
+	float unit[OPC_MAX_BINS];											//Reported unit of each bin in particles per cm^3 (or per count)
+	float binFactor[OPC_MAX_BINS];										//The unit times the per-bin correction
+	float flowScale;													//Share of its ground flow a concentration sensor draws
+	float pressure, temperature;										//Ambient conditions (hPa, C), 0 hPa if not given
+	float stdPressure, stdTemperature;									//Standard conditions (hPa, C)
+	float stpRatio;														//Standard concentration over ambient, 0 if the ambient is not given
+	uint64_t lastSample;												//Sample time of the last sample used
+	bool valid;															//The arrays hold a fresh sample
+	void setRatio();
+
+	public:
+	float ambient[OPC_MAX_BINS];										//Particles per cm^3 at the ambient conditions
+	float stp[OPC_MAX_BINS];											//Particles per cm^3 at standard conditions
+	float sampleVolume;													//Air behind the last sample (cm^3), 0 for a concentration sensor
+
+	OPCNormalize(const OPCBinLayout &binLayout);
+	void setAmbient(float ambientPressure, float ambientTemperature);	//Outside pressure (hPa) and temperature (C), from another sensor
+	void setStandard(float standardPressure, float standardTemperature);	//Standard conditions (default 1013.25 hPa and 0 C)
+	void setFlowScale(float scale);										//Share of the ground flow a Plantower or SPS draws (default 1)
+	void setBinFactor(uint8_t bin, float factor);						//Extra correction for one bin, such as 1/counting efficiency (default 1)
+	uint8_t getBins();
+	bool hasStandard();													//The ambient conditions were given, so .stp is filled
+	bool apply(const float *bins, float volume);						//Normalize the reported bins of one sample. The volume (cm^3) is only used for counts.
+#ifdef ARDUINO
+	bool update(OPC &sensor);											//Normalize the sensor if it has a new sample
+	String CSVHeader();													//Header for the ambient and standard columns
+	String logUpdate();													//Ambient and standard concentrations in CSV format
+	uint16_t logBinary(uint8_t *buf, uint16_t len);						//Ambient and standard concentrations in a binary record
+#endif
+};
+
+#endif
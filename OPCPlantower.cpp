@@ -0,0 +1,302 @@
+//Optical Particle Counter Library
+
+//University of Minnesota - Candler MURI
+
+/*This is the definitions file for the Plantower PMS 5003.
+The PMS 5003 runs the read data function as fast as possible, and can
+record new data every 2.3 seconds.*/
+
+#include "OPCSensor.h"
+
+#if OPC_USE_PLANTOWER
+
+#ifdef OPC_STATIC_RAM
+static_assert(sizeof(Plantower) <= OPC_RAM_PLANTOWER, "Plantower is over its RAM budget");	//RAM budget from OPCConfig.h
+#endif
+
+
+
+//////////PLANTOWER//////////
+
+
+
+void Plantower::command(byte CMD, byte Mode){							//Command system, that allows for base commands to be easily sent
+	uint16_t verify = 0x42 + 0x4d + CMD + 0x00 + Mode;					//Checksum calculation
+	uint8_t LRCH, LRCL;
+	
+	LRCL = (verify & 0xff);												//Split checksum into a most significant and least significant byte
+	LRCH = (verify >> 8);
+	
+	s->write(0x42);														//Send data
+	s->write(0x4d);
+	s->write(CMD);
+	s->write((byte)0x00);
+	s->write(Mode);
+	s->write((byte)LRCH);
+	s->write((byte)LRCL);	
+}
+
+Plantower::Plantower(Stream* ser, unsigned int planLog) : OPC(ser){ 	//Plantower constructor- contains the log rate and the plantower stream
+	logRate = planLog;
+	passive = false;
+	loggedSequence = 0;
+	retry.setAttempts(3);												//A frame should arrive within a few seconds of power on
+	retry.setBackoff(5000, 10000);
+	retry.setDeadline(20000);
+	setStaleLimit(OPC_STALE_LIMIT_WHOLE);								//Whole ug/m^3 and counts per 0.1 L
+}
+	
+	
+void Plantower::powerOn(){												//Power on
+	command(0xe4,0x01);
+	
+	delay(20);
+	for (unsigned short i=0; i<8; i++) s->read();						//Clear buffer
+}
+
+void Plantower::powerOff(){												//Power off
+	command(0xe4,0x00);
+	
+	delay(20);
+	for (unsigned short i=0; i<8; i++) s->read();
+}
+
+void Plantower::passiveMode(){											//Passive mode
+	command(0xe1,0x00);
+	passive = true;
+
+	delay(20);
+	for (unsigned short i=0; i<8; i++) s->read();
+}
+
+void Plantower::activeMode(){											//Active mode
+	command(0xe1, 0x01);
+	passive = false;
+	
+	delay(20);
+	for (unsigned short i=0; i<8; i++) s->read();
+}
+
+void Plantower::initOPC(){												//System initalization
+	OPC::initOPC();
+	
+	powerOn();
+	delay(100);
+	activeMode();
+}
+	
+void Plantower::beginInit(){											//Non-blocking version of the initialization
+	OPC::initOPC();
+	initState = OPC_INIT_BUSY;
+	initStep = 0;
+	initTime = millis();
+	retry.begin();
+	command(0xe4,0x01);													//Power on
+	retry.backoff();													//Time to wait for the first frame
+}
+
+uint8_t Plantower::pollInit(){											//The Plantower is ready once it sends a good frame
+	if (initState != OPC_INIT_BUSY) return initState;
+	
+	if (initStep == 0){
+		if ((millis() - initTime) < 20) return initState;				//Give the power on response time to arrive
+		while (s->available()) s->read();								//Clear buffer
+		command(0xe1, 0x01);											//Active mode
+		passive = false;
+		initStep = 1;
+	} else if (readData()){												//Frames start streaming in active mode
+		retry.succeed();
+		initState = OPC_INIT_READY;
+	} else if (retry.ready()){											//No frames, so the commands are sent again
+		if (retry.isExhausted()){
+			retry.giveUp();
+			initState = OPC_INIT_FAILED;
+		} else {
+			command(0xe4,0x01);
+			retry.backoff();
+			initStep = 0;
+			initTime = millis();
+		}
+	}
+	return initState;
+}
+
+static const char plantowerHeader[] PROGMEM = ",MC1um,MC2.5um,MC10um,AMC1um,AMC2.5um,AMC10um,"
+	"NC03um,NC05um,NC10um,NC25um,NC50um,NC100um";
+
+uint16_t Plantower::CSVHeader(char *buf, uint16_t len){ return headerText(plantowerHeader, buf, len); }	//Writes a data header in CSV format
+
+bool Plantower::update(){												//Counts the hits and checks the reset timer for the log functions
+	if (sleeping()) return false;										//A sleeping sensor is not logged
+	
+	if (PMSdata.sequence() != loggedSequence){							//If a new frame came in since the last log, it will be logged.
+		loggedSequence = PMSdata.sequence();							//A frame is only logged once, so a sensor that stops sending is a bad log.
+		if (warmingUp()) return false;									//Samples during the warm-up are thrown out
+		nTot ++;                                                   		//Total samples
+		return true;
+	}
+	
+	badLog++;                                                       	//If there are five consecutive bad logs, the data string will print a warning
+	if (badLog >= 5){
+		setQuality(false);
+	}
+
+#if OPC_USE_RESET
+	if ((millis()-goodLogAge)>=resetTime){								//System reset if the reset time is tripped
+		fire(OPC_EVENT_RESET_START, 0, millis() - goodLogAge);
+		powerOff();
+		delay(20000);
+		powerOn();
+		goodLogAge = millis();
+		fire(OPC_EVENT_RESET_END, 0, 0);
+	}
+#endif
+	return false;
+}
+
+void Plantower::dataText(OPCText &text, bool fresh){					//Mass concentrations and particle counts
+	if (!fresh){
+		missingText(text, 12);
+		return;
+	}
+	
+	const uint16_t columns[12] = {PMSdata->pm10_standard, PMSdata->pm25_standard, PMSdata->pm100_standard,
+		PMSdata->pm10_env, PMSdata->pm25_env, PMSdata->pm100_env,
+		PMSdata->particles_03um, PMSdata->particles_05um, PMSdata->particles_10um,
+		PMSdata->particles_25um, PMSdata->particles_50um, PMSdata->particles_100um};
+	for (uint8_t i = 0; i < 12; i++){
+		text.add(',');
+		text.add((unsigned long)columns[i]);
+	}
+}
+
+uint16_t Plantower::logLine(char *buf, uint16_t len){
+	unsigned int hits = nTot;
+	bool fresh = update();
+	return lineText(hits, fresh, buf, len);								//Log sample number, in flight time
+}
+
+#if OPC_USE_READOUT
+uint16_t Plantower::logReadout(const char *name, char *buf, uint16_t len){	//Same as log update, but with a readout for the serial monitor
+	unsigned int hits = nTot;
+	bool fresh = update();
+	OPCReadout readout;
+	readoutStart(readout, PSTR("Plantower"), name, getSampleAge());
+	
+	if (fresh){
+		readout.line(PSTR(".3 microns and greater: "), (unsigned long)PMSdata->particles_03um);
+		readout.line(PSTR(".5 microns and greater: "), (unsigned long)PMSdata->particles_05um);
+		readout.line(PSTR("1 microns and greater: "), (unsigned long)PMSdata->particles_10um);
+		readout.line(PSTR("2.5 microns and greater: "), (unsigned long)PMSdata->particles_25um);
+		readout.line(PSTR("5 microns and greater: "), (unsigned long)PMSdata->particles_50um);
+		readout.line(PSTR("10 microns and greater: "), (unsigned long)PMSdata->particles_100um);
+	} else readout.line(PSTR("Bad log"));
+	
+	readoutSend(readout);
+	return lineText(hits, fresh, buf, len);
+}
+#endif
+
+#ifndef OPC_STATIC_RAM
+String Plantower::CSVHeader(){											//String versions, on top of the buffer versions
+	char line[OPC_LINE_SIZE];
+	CSVHeader(line, sizeof(line));
+	return String(line);
+}
+
+String Plantower::logUpdate(){
+	char line[OPC_LINE_SIZE];
+	logLine(line, sizeof(line));
+	return String(line);
+}
+
+#if OPC_USE_READOUT
+String Plantower::logReadout(String name){
+	char line[OPC_LINE_SIZE];
+	logReadout(name.c_str(), line, sizeof(line));
+	return String(line);
+}
+#endif
+#endif
+
+uint16_t Plantower::logBinary(uint8_t *buf, uint16_t len){				//Same as log update, but packed into a binary record
+	unsigned int hits = nTot;
+	bool fresh = update();
+	return packRecord(OPC_TYPE_PLANTOWER, hits, fresh, &PMSdata.latest(), sizeof(PMS5003data), buf, len);
+}
+
+uint8_t Plantower::getData(float *data, uint8_t len){					//Particle counts for .3, .5, 1, 2.5, 5, and 10 microns and greater
+	uint16_t counts[6] = {PMSdata->particles_03um, PMSdata->particles_05um, PMSdata->particles_10um,
+						  PMSdata->particles_25um, PMSdata->particles_50um, PMSdata->particles_100um};
+	if (len > 6) len = 6;
+	for (uint8_t i = 0; i < len; i++) data[i] = counts[i];
+	return len;
+}
+
+uint8_t Plantower::getBins(){ return 6; }
+
+bool Plantower::readData(){												//Command that calls bytes from the plantower
+  if (! s->available()){
+    return false;
+  }
+  
+  if (s->peek() != 0x42){ 												//Read a byte at a time until we get to the special '0x42' start-byte
+    s->read();
+    return false;
+  }
+ 
+  if (s->available() < 32){  											//Now read all 32 bytes
+    return false;
+  }
+    
+  uint8_t buffer[32];    
+  uint16_t sum = 0;
+  s->readBytes(buffer, 32);
+  uint64_t arrival = opcMicros();										//The frame is complete once the last byte is read
+ 
+  for (uint8_t i=0; i<30; i++){  										//Get checksum ready
+    sum += buffer[i];
+  }
+
+  uint16_t buffer_u16[15];												//Making bins exclusive for each particulate size
+  for (uint8_t i=0; i<15; i++){										
+    buffer_u16[i] = buffer[2 + i*2 + 1];
+    buffer_u16[i] += (buffer[2 + i*2] << 8);
+  }
+ 
+  PMS5003data &frame = PMSdata.scratch();								//Decode into the scratch copy, so a bad frame is never seen
+  memcpy((void *)&frame, (void *)buffer_u16, 30);						//Put it into a nice struct :)
+ 
+  if (sum != frame.checksum){									    	//if the checksum fails, return false
+    setQuality(false);
+    return false;
+  }
+  
+  uint32_t quality = 0;													//Each size holds the sizes above it, so none can be over a smaller one
+  if ((frame.pm10_standard > frame.pm25_standard) || (frame.pm25_standard > frame.pm100_standard) ||
+      (frame.pm10_env > frame.pm25_env) || (frame.pm25_env > frame.pm100_env) ||
+      (frame.particles_05um > frame.particles_03um) || (frame.particles_10um > frame.particles_05um) ||
+      (frame.particles_25um > frame.particles_10um) || (frame.particles_50um > frame.particles_25um) ||
+      (frame.particles_100um > frame.particles_50um)) quality |= OPC_FLAG_RANGE;
+  if (!checkFrame(&buffer[4], 24, quality)) return false;				//The concentrations and counts, without the length and checksum
+
+	frame.sampleTime = sampleTime = arrival;							//Only a good frame updates the sample time
+	PMSdata.publish();
+	setQuality(true);													//goodLog is set to true of every good log
+	goodLogAge = millis();
+	badLog = 0;															//The badLog counter and the goodLogAge are both reset.
+	sampleEvent();
+  return true;
+}
+
+void Plantower::requestData(){											//In active mode the frames come on their own
+	if (passive) command(0xe2, 0x00);
+}
+
+uint8_t Plantower::collectData(){										//.readData() takes a frame once it is all there, and sets the log quality
+	bool whole = (s->available() >= 32) && (s->peek() == 0x42);			//A frame .readData() will take, good or bad
+	if (readData()) return OPC_COLLECT_GOOD;
+	return whole ? OPC_COLLECT_FAILED : OPC_COLLECT_WAITING;
+}
+
+#endif
@@ -0,0 +1,68 @@
+//Optical Particle Counter Library
+
+//University of Minnesota - Candler MURI
+
+/*This is the header file for the Plantower PMS 5003.
+The PMS 5003 runs the read data function as fast as possible, and can
+record new data every 2.3 seconds.
+*/
+
+
+#ifndef OPCPlantower_h
+#define OPCPlantower_h
+
+#include "OPCSensor.h"
+
+
+
+class Plantower: public OPC
+{                              
+	private:
+	unsigned int logRate;												//System log rate
+	bool passive;														//Frames are sent on request, not streamed
+	uint32_t loggedSequence;											//Sequence number of the last frame that was logged
+	void command(uint8_t CMD, uint8_t MODE);							//Command base
+	bool update();														//Update the log quality for a log function
+	void dataText(OPCText &text, bool fresh);							//Data columns of the CSV line
+	
+	public:
+	struct PMS5003data {												//Struct that holds Plantower data
+		uint16_t framelen;
+		uint16_t pm10_standard, pm25_standard, pm100_standard;
+		uint16_t pm10_env, pm25_env, pm100_env;
+		uint16_t particles_03um, particles_05um, particles_10um, particles_25um, particles_50um, particles_100um;
+		uint16_t unused;
+		uint16_t checksum;
+		uint64_t sampleTime;											//Time the frame finished arriving (us)
+	};
+	OPCSample<PMS5003data> PMSdata;
+	
+	Plantower(Stream* ser, unsigned int logRate);						//Plantower constructor
+	void powerOn();
+	void powerOff();
+	void passiveMode();
+	void activeMode();
+	void initOPC();
+	void beginInit();													//Non-blocking initialization
+	uint8_t pollInit();
+	uint16_t CSVHeader(char *buf, uint16_t len);						//CSV header, written into the buffer
+	uint16_t logLine(char *buf, uint16_t len);							//Log update, written into the buffer. Returns the length, or 0 if it does not fit
+#if OPC_USE_READOUT
+	uint16_t logReadout(const char *name, char *buf, uint16_t len);	//Log line, and a readout for the serial monitor
+#endif
+#ifndef OPC_STATIC_RAM
+	String CSVHeader();													//Overrides of OPC data functions
+	String logUpdate();
+#if OPC_USE_READOUT
+	String logReadout(String name);
+#endif
+#endif
+	uint16_t logBinary(uint8_t *buf, uint16_t len);						//Binary version of log update
+	uint8_t getData(float *data, uint8_t len);							//Particle counts, .3um and up
+	uint8_t getBins();
+	bool readData();
+	void requestData();													//Fleet read: ask for a frame in passive mode,
+	uint8_t collectData();												//and take it once all 32 bytes have arrived
+};
+
+#endif
@@ -0,0 +1,396 @@
+//Optical Particle Counter Library
+
+//University of Minnesota - Candler MURI
+
+/*This is the definitions file for the Alphasense R1.
+The Alphasense R1 runs the read data function with the log update function,
+and can record new data every 1 seconds. The R1 runs on SPI.*/
+
+#include "OPCSensor.h"
+
+#if OPC_USE_R1
+
+#ifdef OPC_STATIC_RAM
+static_assert(sizeof(R1) <= OPC_RAM_R1, "R1 is over its RAM budget");	//RAM budget from OPCConfig.h
+#endif
+
+
+
+//////////R1//////////
+
+
+
+R1::R1(uint8_t slave) : OPC() { 										//Constructor
+	CS = slave; 														//Set up SPI slave pin
+	pinMode(CS,OUTPUT);
+	readMode = ALPHA_READ_HISTOGRAM;
+	histogramPeriod = 10000;
+	lastHistogram = 0;
+	histogram = false;
+	commandOpen = false;
+	retry.setAttempts(6);												//Each attempt is a burst of 20 power signal bytes
+	retry.setBackoff(500, 2000);
+	retry.setDeadline(15000);
+	retry.setSequenceDeadline(15000);									//A reset is two commands, but a dead R1 only holds it up for one
+	setStaleLimit(R1_STALE_LIMIT);
+	}						
+
+bool R1::command(byte control){											//Power command system, will return true if command successful. The power
+  byte inData = 0;														//signal byte is sent until the R1 is ready, then the control byte is sent.
+  
+  if (!claimSPI()) return false;										//Another sensor is in the middle of a polled handshake
+  retry.begin();
+  digitalWrite(CS,LOW);													//Open data translation
+  SPI.beginTransaction(SPISettings(R1_SPEED, MSBFIRST, SPI_MODE1));
+  
+  while (true){
+	for (unsigned short loopy = 0; (loopy < 20) && (inData != 0xF3); loopy++){	//Cycle to attempt power on
+	  inData = SPI.transfer(0x03);										//Power signal byte
+	  delay(10);
+	}
+	if (inData == 0xF3) break;
+	
+	digitalWrite(CS, HIGH);                                         	//If 20 attempts to communicate fail, then turn off and back on
+	SPI.endTransaction();												//The power on and off for this system takes extra time, due to the sensitivity of SPI. 
+	if (!retry.backoff()){												//With these commands, it is critical to connect. Later, when reading data, missing a hit
+		releaseSPI();													//can be recovered later.
+		return retry.giveUp();
+	}
+	retry.wait();
+	SPI.beginTransaction(SPISettings(R1_SPEED, MSBFIRST, SPI_MODE1));
+	digitalWrite(CS,LOW);
+  }
+
+  SPI.transfer(control);												//Control bytes
+
+  digitalWrite(CS, HIGH);                                          
+  SPI.endTransaction();
+  releaseSPI();
+  retry.succeed();
+  return true;
+}
+
+void R1::powerOn(){														//system activation
+  command(0x03);
+}
+
+void R1::powerOff(){													//This is the power down sequence
+  command(0x00);
+}
+
+void R1::initOPC(){
+	OPC::initOPC();														//Calls original init
+
+	SPI.begin();        											 	//Intialize SPI in Arduino
+	digitalWrite(CS,HIGH);												//Pull the pin up so there is no data leakage
+	delay(1000);
+	powerOn();														
+}
+
+void R1::beginInit(){													//Non-blocking version of the initialization
+	OPC::initOPC();
+	
+	SPI.begin();        											 	//Intialize SPI in Arduino
+	digitalWrite(CS,HIGH);												//Pull the pin up so there is no data leakage
+	commandOpen = false;
+	initState = OPC_INIT_BUSY;
+	initTries = 0;
+	initTime = millis();
+	retry.begin();
+}
+
+uint8_t R1::pollInit(){													//Each poll makes one attempt at the power on command, instead of waiting
+	if (initState != OPC_INIT_BUSY) return initState;					//a fixed time for the R1 to boot. Each attempt is its own SPI transaction.
+	if (!retry.ready()) return initState;								//As in .command(), slave select is held low for the whole burst, with the
+	if ((millis() - initTime) < 10) return initState;					//bus claimed, so the busy and ready bytes can follow.
+	
+	if (!commandOpen && !claimSPI()) return initState;					//Wait for the other sensor to finish its handshake
+	SPI.beginTransaction(SPISettings(R1_SPEED, MSBFIRST, SPI_MODE1));
+	if (!commandOpen){
+		digitalWrite(CS,LOW);
+		commandOpen = true;
+	}
+	byte response = SPI.transfer(0x03);									//Power signal byte
+	if (response == 0xF3) SPI.transfer(0x03);							//Control bytes
+	SPI.endTransaction();
+	initTime = millis();
+	
+	if ((response == 0xF3) || (++initTries >= 20)) closeCommand();		//The burst is over
+	
+	if (response == 0xF3){
+		retry.succeed();
+		initState = OPC_INIT_READY;
+	} else if (initTries >= 20){										//After 20 attempts, the R1 is given time to recover
+		initTries = 0;
+		if (!retry.backoff()){
+			retry.giveUp();												//give up :(
+			initState = OPC_INIT_FAILED;
+		}
+	}
+	return initState;
+}
+
+void R1::closeCommand(){												//Raise slave select, and let the other sensors use the bus
+	if (!commandOpen) return;
+	digitalWrite(CS, HIGH);
+	commandOpen = false;
+	releaseSPI();
+}
+
+void R1::abortInit(){													//Called when the startup gives up, even in the middle of a burst
+	closeCommand();
+	OPC::abortInit();
+}
+
+static const char r1Header[] PROGMEM = ",Bin0,Bin1,Bin2,Bin3,Bin4,Bin5,Bin6,Bin7,Bin8,Bin9,"
+	"Bin10,Bin11,Bin12,Bin13,Bin14,Bin15,Bin1 Time,Bin3 Time,"
+	"Bin5 Time,Bin7 Time,Flow Rate,Temp,Humidity,Sample Period,"
+	"PMA,PMB,PMC";
+
+uint16_t R1::CSVHeader(char *buf, uint16_t len){ return headerText(r1Header, buf, len); }	//Writes a data header in CSV format
+
+bool R1::update(){														//Reads the data and updates the log quality for the log functions
+	if (sleeping()) return false;										//A sleeping sensor is not read
+	
+	if (takeSample()){
+	   setQuality(true);
+       goodLogAge = millis();
+       badLog = 0;
+       if (warmingUp()) return false;									//Samples during the warm-up are thrown out
+       nTot++;
+       return true;
+	}
+	
+	badLog ++;
+	if (badLog >= 5) setQuality(false);									//Good log situation the same as in the Plantower code
+#if OPC_USE_RESET
+	if ((millis()-goodLogAge)>=resetTime) {								//If the age of the last good log exceeds the automatic reset trigger,
+		fire(OPC_EVENT_RESET_START, 0, millis() - goodLogAge);
+		retry.beginSequence();											//The whole reset shares one deadline
+		powerOff();														//the system will cycle and clean the dust bin.
+		retry.pause(2000);												//The system now has a function checksum
+		powerOn();
+		retry.pause(100);
+		retry.endSequence();
+		goodLogAge = millis();
+		fire(OPC_EVENT_RESET_END, 0, 0);
+	}
+#endif
+	return false;
+}
+
+void R1::setReadMode(uint8_t mode, unsigned long period){			//In PM mode, the histogram keeps counting between histogram reads,
+	readMode = mode;													//so each histogram covers the whole period.
+	histogramPeriod = period;
+	lastHistogram = millis() - period;									//The first read is a histogram
+}
+
+uint8_t R1::getReadMode(){ return readMode; }
+
+bool R1::isHistogram(){ return histogram; }
+
+int16_t R1::getTemperature(){ return opcCentiDegrees(localData->tempRaw); }
+
+uint16_t R1::getHumidity(){ return opcPerMille(localData->humidRaw); }
+
+void R1::dataText(OPCText &text, bool fresh){							//Bins, bin times, flow, temperature, humidity, period, and PM values
+	if (!fresh){														//If there is bad data, the columns are populated with failure symbols.
+		missingText(text, 27);
+		return;
+	}
+	
+	if (histogram){														//If the histogram is read, write its columns
+		for (unsigned short i = 0; i < 16; i++){
+			text.add(',');
+			text.add((unsigned long)localData->bins[i]);
+		}
+		
+		const uint8_t times[4] = {localData->bin1time, localData->bin2time, localData->bin3time, localData->bin4time};
+		for (unsigned short i = 0; i < 4; i++){
+			text.add(',');
+			text.add((unsigned long)times[i]);
+		}
+		
+		text.add(',');
+		text.add(localData->sampleFlowRate, 2);
+		text.add(',');
+		text.addFixed(getTemperature(), 2);								//Degrees C and percent RH, from the raw words
+		text.add(',');
+		text.addFixed(getHumidity(), 1);
+		text.add(',');
+		text.add(localData->samplePeriod, 2);
+	} else missingText(text, 24);										//A PM-only read has no histogram
+	
+	text.add(',');
+	text.add(pmData->pm1, 2);
+	text.add(',');
+	text.add(pmData->pm2_5, 2);
+	text.add(',');
+	text.add(pmData->pm10, 2);
+}
+
+uint16_t R1::logLine(char *buf, uint16_t len){							//If the log is successful, each bin will be logged.
+	unsigned int hits = nTot;
+	bool fresh = update();
+	return lineText(hits, fresh, buf, len);
+}
+ 
+#if OPC_USE_READOUT
+uint16_t R1::logReadout(const char *name, char *buf, uint16_t len){		//Same as log update, but with a readout for the serial monitor
+	unsigned int hits = nTot;
+	bool fresh = update();
+	OPCReadout readout;
+	readoutStart(readout, PSTR("R1"), name, getSampleAge());
+	
+	if (fresh && histogram){
+		for (unsigned short i = 0; i < 16; i++){
+			readout.addFlash(PSTR("Bin "));
+			readout.add((unsigned long)i);
+			readout.line(PSTR(": "), (unsigned long)localData->bins[i]);
+		}
+	} else if (fresh){													//A PM-only read
+		readout.line(PSTR("PM1: "), pmData->pm1, 2);
+		readout.line(PSTR("PM2.5: "), pmData->pm2_5, 2);
+		readout.line(PSTR("PM10: "), pmData->pm10, 2);
+	} else readout.line(PSTR("Bad log"));
+	
+	readoutSend(readout);
+	return lineText(hits, fresh, buf, len);
+}
+#endif
+
+#ifndef OPC_STATIC_RAM
+String R1::CSVHeader(){
+	char line[OPC_LINE_SIZE];
+	CSVHeader(line, sizeof(line));
+	return String(line);
+}
+
+String R1::logUpdate(){
+	char line[OPC_LINE_SIZE];
+	logLine(line, sizeof(line));
+	return String(line);
+}
+
+#if OPC_USE_READOUT
+String R1::logReadout(String name){
+	char line[OPC_LINE_SIZE];
+	logReadout(name.c_str(), line, sizeof(line));
+	return String(line);
+}
+#endif
+#endif
+
+uint16_t R1::logBinary(uint8_t *buf, uint16_t len){						//Same as log update, but packed into a binary record
+	unsigned int hits = nTot;
+	bool fresh = update();
+	if (fresh && !histogram) return packRecord(OPC_TYPE_R1_PM, hits, fresh, &pmData.latest(), sizeof(OPCPMdata), buf, len);
+	return packRecord(OPC_TYPE_R1, hits, fresh, &localData.latest(), sizeof(R1data), buf, len);
+}
+
+uint8_t R1::getData(float *data, uint8_t len){							//Bin counts, 16 bins
+	if (!histogram) return 0;											//A PM-only read has no bins
+	if (len > 16) len = 16;
+	for (uint8_t i = 0; i < len; i++) data[i] = localData->bins[i];
+	return len;
+}
+
+uint8_t R1::getBins(){ return 16; }
+
+float R1::getSampleVolume(){											//ml/s times s, and a ml is a cm^3
+	if (!histogram) return 0;
+	return localData->sampleFlowRate*localData->samplePeriod;
+}
+
+float R1::getSamplePeriod(){											//Seconds since the last histogram read
+	if (!histogram) return 0;
+	return localData->samplePeriod;
+}
+
+bool R1::readData(){													//Data reading system. In PM mode, the histogram is only read once a period.
+	if ((readMode == ALPHA_READ_PM) && ((millis() - lastHistogram) < histogramPeriod)) return readPM();
+	return readHistogram();
+}
+
+bool R1::readHistogram(){
+	byte transmitData[64] = {0};
+	uint64_t arrival = 0;
+	
+	if (!alphaRead(CS, R1_SPEED, 0x30, transmitData, 64, arrival)) return false;	//If connection fails, return a read failure.
+
+	R1data &frame = localData.scratch();								//Decode into the scratch copies, so a bad transfer is never seen
+	OPCPMdata &pm = pmData.scratch();
+	memcpy(&frame, &transmitData, 50);									//Memcpy didn't like the last chunk of bytes for some reason
+
+	union pmBytes{														//The last bytes would not copy, so this cludge makes the system work.
+		byte inputs[4];
+		float outputs;
+	}pmInfo[3];
+	
+	for (unsigned short i = 0; i < 3; i++){
+		for (unsigned short j = 0; j < 4; j++){
+			pmInfo[i].inputs[j] = transmitData[50 + i*4 + j];
+		}
+	}
+	frame.pm1 = pmInfo[0].outputs;
+	frame.pm2_5 = pmInfo[1].outputs;
+	frame.pm10 = pmInfo[2].outputs;
+	 
+	frame.checksum = bytes2int(transmitData[62],transmitData[63]);
+	if (frame.checksum != CalcCRC(transmitData, 62)) return false;	//Return the checksum result
+	
+	uint32_t quality = alphaPMQuality(frame.pm1, frame.pm2_5, frame.pm10);	//Plausibility of the diagnostics, as quality bits
+	if (!((frame.sampleFlowRate >= R1_FLOW_MIN) && (frame.sampleFlowRate <= R1_FLOW_MAX))) quality |= OPC_FLAG_FLOW;
+	if (frame.rejectCountGlitch > R1_GLITCH_MAX) quality |= OPC_FLAG_GLITCH;
+	if (!checkFrame(transmitData, 62, quality)) return false;			//A stale histogram is not published
+	
+	pm.pm1 = frame.pm1;
+	pm.pm2_5 = frame.pm2_5;
+	pm.pm10 = frame.pm10;
+	pm.sampleTime = frame.sampleTime = sampleTime = arrival;	//Only a good transfer updates the sample time
+	localData.publish();
+	pmData.publish();
+	lastHistogram = millis();
+	histogram = true;
+	sampleEvent();
+	return true;
+}
+
+bool R1::readPM(){														//PM values only: 12 bytes of floats and a checksum
+	byte transmitData[14] = {0};
+	uint64_t arrival = 0;
+	
+	if (!alphaRead(CS, R1_SPEED, 0x32, transmitData, 14, arrival)) return false;
+	if (bytes2int(transmitData[12],transmitData[13]) != CalcCRC(transmitData, 12)) return false;
+	
+	OPCPMdata &pm = pmData.scratch();
+	memcpy(&pm, transmitData, 12);
+	if (!alphaCheckPM(alphaPMQuality(pm.pm1, pm.pm2_5, pm.pm10))) return false;
+	pm.sampleTime = sampleTime = arrival;
+	pmData.publish();
+	histogram = false;
+	sampleEvent();
+	return true;
+}
+
+unsigned int R1::CalcCRC(unsigned char data[], unsigned char nbrOfBytes) {
+    #define POLYNOMIAL 0xA001 											//Generator polynomial for CRC
+    #define InitCRCval 0xFFFF 											//Initial CRC value
+    unsigned char _bit; 												//Bit mask
+    unsigned int crc = InitCRCval; 										//Initialise calculated checksum 
+    unsigned char byteCtr; 												//Byte counter
+																		//Calculates 16-Bit checksum with given polynomial  
+    for(byteCtr = 0; byteCtr < nbrOfBytes; byteCtr++) {
+      crc ^= (unsigned int)data[byteCtr]; 
+      for(_bit = 0; _bit < 8; _bit++) {
+        if (crc & 1) 													//If bit0 of crc is 1
+        {
+            crc >>= 1;
+            crc ^= POLYNOMIAL; 
+        } else crc >>= 1;
+      }
+    }
+    return crc; 
+}
+
+#endif
@@ -0,0 +1,89 @@
+//Optical Particle Counter Library
+
+//University of Minnesota - Candler MURI
+
+/*This is the header file for the Alphasense R1.
+The Alphasense R1 runs the read data function with the log update function,
+and can record new data every 1 seconds. The R1 runs on SPI.
+*/
+
+
+#ifndef OPCR1_h
+#define OPCR1_h
+
+#include <SPI.h>
+#include "OPCSensor.h"
+#include "OPCClimate.h"
+#define R1_SPEED 300000
+#define R1_FLOW_MIN 1.0													//Plausible sample flow (ml/s)
+#define R1_FLOW_MAX 10.0
+#define R1_GLITCH_MAX 100												//Most glitch rejects in a plausible histogram
+#define R1_STALE_LIMIT 3												//Each histogram has its own period and climate words, so repeats are rare
+
+
+
+class R1: public OPC {													//The R1 runs on SPI Communication
+	private:
+	uint8_t CS;															//Slave Select pin for specification. The code will only run on the default SPI pins.
+	uint16_t data[25];													//Data arrays
+	unsigned int CalcCRC(unsigned char data[], unsigned char nbrOfBytes);//Checksum calculator
+	bool update();														//Read the data and update the log quality
+	bool command(byte control);											//Power command, sent until the R1 answers
+	bool commandOpen;													//The power command burst is open between polls
+	void closeCommand();												//Close the power command burst if it is open
+	uint8_t readMode;													//ALPHA_READ_* mode
+	unsigned long histogramPeriod;										//Time between histogram reads in PM mode (ms)
+	unsigned long lastHistogram;										//Time of the last good histogram read
+	bool histogram;														//The last sample was a full histogram
+	bool readHistogram();												//Command 0x30, which also resets the histogram
+	bool readPM();														//Command 0x32, PM values only
+	void dataText(OPCText &text, bool fresh);							//Data columns of the CSV line
+	
+	struct R1data{														//R1 data struct
+		uint16_t bins[16];
+		uint8_t bin1time, bin2time, bin3time, bin4time;
+		float sampleFlowRate; 
+		uint16_t tempRaw, humidRaw;										//Raw sensor words, see OPCClimate.h
+		float samplePeriod;
+		uint8_t rejectCountGlitch, rejectCountLong;
+		float pm1, pm2_5, pm10;
+		unsigned int checksum;
+		uint64_t sampleTime;											//Time the transfer finished (us)
+	};
+	OPCSample<R1data> localData;
+	
+	public:
+	OPCSample<OPCPMdata> pmData;										//PM values of the last sample, from either read
+	void setReadMode(uint8_t mode, unsigned long period = 10000);		//ALPHA_READ_* mode, and the histogram period (ms) for PM mode
+	uint8_t getReadMode();
+	bool isHistogram();													//True if the last sample has the histogram
+	int16_t getTemperature();											//Temperature of the last histogram (centi-degrees C)
+	uint16_t getHumidity();												//Humidity of the last histogram (per-mille RH)
+	R1(uint8_t slave);													//Alphasense constructor
+	void powerOn();														//Power on will activate the fan, laser, and data communication
+	void powerOff();													//Power off will deactivate these same things
+	void initOPC();														//Initializes the OPC
+	void beginInit();													//Non-blocking initialization
+	uint8_t pollInit();
+	void abortInit();
+	uint16_t CSVHeader(char *buf, uint16_t len);						//CSV header, written into the buffer
+	uint16_t logLine(char *buf, uint16_t len);							//Log update, written into the buffer. Returns the length, or 0 if it does not fit
+#if OPC_USE_READOUT
+	uint16_t logReadout(const char *name, char *buf, uint16_t len);	//Log line, and a readout for the serial monitor
+#endif
+#ifndef OPC_STATIC_RAM
+	String CSVHeader();													//Overrrides the OPC data functions
+	String logUpdate();
+#if OPC_USE_READOUT
+	String logReadout(String name);
+#endif
+#endif
+	uint16_t logBinary(uint8_t *buf, uint16_t len);
+	uint8_t getData(float *data, uint8_t len);							//Bin counts
+	uint8_t getBins();
+	float getSampleVolume();											//Sample flow rate times the sample period
+	float getSamplePeriod();
+	bool readData();												
+};
+
+#endif
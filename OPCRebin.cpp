@@ -0,0 +1,107 @@
+//Optical Particle Counter Library
+
+//University of Minnesota - Candler MURI
+
+/*This is the definitions file for the common bin rebinning engine.
+See OPCRebin.h for how the overlaps are shared out.*/
+
+#include "OPCRebin.h"
+#include <math.h>
+#include <string.h>
+
+const float OPC_GRID_PM[OPC_GRID_PM_BINS + 1] = {0.3, 0.5, 1.0, 2.5, 4.0, 10.0};
+
+
+
+//////////REBIN//////////
+
+
+
+OPCRebin::OPCRebin(const OPCBinLayout &source, const float *gridEdges, uint8_t nGrid){
+	layout = &source;
+	grid = gridEdges;
+	gridBins = (nGrid > OPC_MAX_GRID_BINS) ? OPC_MAX_GRID_BINS : nGrid;
+	nWeights = 0;
+	lastSample = 0;
+	valid = false;
+
+	for (uint8_t g = 0; g < gridBins; g++){
+		coverage[g] = 0;
+		counts[g] = 0;
+	}
+
+	for (uint8_t i = 0; i < layout->nBins; i++){						//Find the overlap of every sensor bin with every grid bin
+		float lower = log(layout->edges[i]);
+		float upper = log(layout->edges[i + 1]);
+
+		for (uint8_t g = 0; g < gridBins; g++){
+			float gridLower = log(grid[g]);
+			float gridUpper = log(grid[g + 1]);
+			float overlap = ((upper < gridUpper) ? upper : gridUpper) - ((lower > gridLower) ? lower : gridLower);
+
+			if ((overlap <= 0) || (nWeights >= OPC_MAX_WEIGHTS)) continue;	//Only the overlaps are kept
+			weightSrc[nWeights] = i;
+			weightDst[nWeights] = g;
+			weight[nWeights] = overlap/(upper - lower);
+			nWeights++;
+			coverage[g] += overlap/(gridUpper - gridLower);
+		}
+	}
+}
+
+uint8_t OPCRebin::getGridBins(){ return gridBins; }
+
+float OPCRebin::getCoverage(uint8_t bin){
+	if (bin >= gridBins) return 0;
+	return coverage[bin];
+}
+
+void OPCRebin::apply(const float *bins){								//Share the counts of each sensor bin out to the grid
+	float binCounts[OPC_MAX_BINS];
+	opcDifferential(*layout, bins, binCounts);
+
+	for (uint8_t g = 0; g < gridBins; g++) counts[g] = 0;
+	for (uint8_t k = 0; k < nWeights; k++) counts[weightDst[k]] += weight[k]*binCounts[weightSrc[k]];
+	valid = true;
+}
+
+#ifdef ARDUINO
+bool OPCRebin::update(OPC &sensor){										//Only a new sample from the sensor is rebinned
+	float bins[OPC_MAX_BINS];
+	if (!sensor.getNewData(bins, layout->nBins, lastSample)){
+		valid = false;
+		return false;
+	}
+	apply(bins);
+	return true;
+}
+
+String OPCRebin::CSVHeader(){											//Each column is named for its grid bin, such as Grid0.30-0.50
+	String header = "";
+	for (uint8_t g = 0; g < gridBins; g++){
+		if (g > 0) header += ",";
+		header += "Grid" + String(grid[g], 2) + "-" + String(grid[g + 1], 2);
+	}
+	return header;
+}
+
+String OPCRebin::logUpdate(){
+	String dataLogLocal = "";
+	for (uint8_t g = 0; g < gridBins; g++){
+		if (g > 0) dataLogLocal += ",";
+		if (valid) dataLogLocal += String(counts[g], 4);
+		else dataLogLocal += "-";										//If there is no new sample, the string is populated with failure symbols.
+	}
+	return dataLogLocal;
+}
+
+uint16_t OPCRebin::logBinary(uint8_t *buf, uint16_t len){				//The data is a byte with the number of grid bins, then the grid counts
+	uint16_t dataLen = valid ? (1 + gridBins*sizeof(float)) : 0;
+	uint16_t at = OPC::packHeader(OPC_TYPE_REBIN | layout->type, 0, valid ? OPC_FLAG_GOOD : 0, dataLen, buf, len);
+	if (!at || !valid) return at;
+
+	buf[at] = gridBins;
+	memcpy(buf + at + 1, counts, gridBins*sizeof(float));
+	return at + dataLen;
+}
+#endif
@@ -0,0 +1,67 @@
+//Optical Particle Counter Library
+
+//University of Minnesota - Candler MURI
+
+/*This is the header file for the common bin rebinning engine.
+The sensors do not share size bins, so comparing them takes some work. An
+OPCRebin object maps the bins of one sensor layout onto a common grid of
+diameters. The particles in a bin are taken to be spread evenly in log(Dp), so
+each sensor bin gives a fixed share of its counts to every grid bin it overlaps.
+These shares are worked out once in the constructor, and only the non-zero
+ones are kept. Each sample then takes the same short loop, no matter what.
+
+Grid bins that reach past the sizes a sensor can see will only hold part of
+their particles. .getCoverage() gives the share of each grid bin (in log(Dp))
+that the sensor covers, so those bins can be flagged or scaled.
+
+The weights and .apply() have no Arduino dependencies, so the same code can
+rebin logged data on a computer.
+*/
+
+
+#ifndef OPCRebin_h
+#define OPCRebin_h
+
+#include "OPCBins.h"
+#ifdef ARDUINO
+#include "OPCSensor.h"
+#endif
+
+#define OPC_MAX_GRID_BINS 24											//Most bins in a common grid
+#define OPC_MAX_WEIGHTS (OPC_MAX_BINS + OPC_MAX_GRID_BINS)				//Most overlaps between two sets of bins
+
+#define OPC_GRID_PM_BINS 5												//A common grid on the PM size cuts
+extern const float OPC_GRID_PM[OPC_GRID_PM_BINS + 1];
+
+
+
+class OPCRebin
+{
+	private:
+	const OPCBinLayout *layout;											//Sensor bins
+	const float *grid;													//Common grid edges, gridBins + 1 of them
+	uint8_t gridBins;
+	uint8_t nWeights;													//Non-zero overlaps
+	uint8_t weightSrc[OPC_MAX_WEIGHTS];									//Sensor bin of each overlap
+	uint8_t weightDst[OPC_MAX_WEIGHTS];									//Grid bin of each overlap
+	float weight[OPC_MAX_WEIGHTS];										//Share of the sensor bin that goes to the grid bin
+	float coverage[OPC_MAX_GRID_BINS];									//Share of each grid bin that the sensor covers
+	uint64_t lastSample;												//Sample time of the last sample used
+	bool valid;															//The grid holds a fresh sample
+
+	public:
+	float counts[OPC_MAX_GRID_BINS];									//Counts in each grid bin
+
+	OPCRebin(const OPCBinLayout &source, const float *gridEdges, uint8_t nGrid);
+	uint8_t getGridBins();
+	float getCoverage(uint8_t bin);										//Share of a grid bin the sensor covers (0 to 1)
+	void apply(const float *bins);										//Rebin the reported bins of one sample
+#ifdef ARDUINO
+	bool update(OPC &sensor);											//Rebin the sensor if it has a new sample
+	String CSVHeader();													//Header with the grid edges
+	String logUpdate();													//Grid counts in CSV format
+	uint16_t logBinary(uint8_t *buf, uint16_t len);						//Grid counts in a binary record
+#endif
+};
+
+#endif
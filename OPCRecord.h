@@ -0,0 +1,71 @@
+//Optical Particle Counter Library
+
+//University of Minnesota - Candler MURI
+
+/*This is the header file for the binary record format.
+It has no Arduino dependencies, so the same definitions can be used by
+programs on a computer that read the binary logs.
+
+Each record is an OPCRecordHeader, followed by length bytes of data. For a
+sensor record, the data is the data struct of the sensor. A bad log is only
+the header.
+
+The data struct is copied as it sits in memory, so its padding depends on the
+board. The top byte of the flags says which layout it has. OPC_PACKING_SCHEMA
+(0) is the layout of the schema tables (OPCSchema.h), which the Teensy and
+64 bit computers share, and is also what records from before the layout byte
+carry. Other boards, such as AVR (64 bit values on any byte) or 32 bit x86
+(on 4 byte boundaries), write OPC_PACKING_OTHER plus the alignment of a 64 bit
+value, so a decoder can tell their records apart.
+*/
+
+
+#ifndef OPCRecord_h
+#define OPCRecord_h
+
+#include <stdint.h>
+
+#define OPC_RECORD_SYNC 0xA5											//First byte of every binary record
+
+#define OPC_TYPE_PLANTOWER 1											//Sensor types for binary records
+#define OPC_TYPE_SPS 2
+#define OPC_TYPE_R1 3
+#define OPC_TYPE_HPM 4
+#define OPC_TYPE_N3 5
+#define OPC_TYPE_SPS_INT 6												//SPS in the unsigned integer output format
+#define OPC_TYPE_R1_PM 7												//R1 PM-only read
+#define OPC_TYPE_N3_PM 8												//N3 PM-only read
+#define OPC_TYPE_DERIVED 0x80											//Added to the sensor type of a derived record
+#define OPC_TYPE_REBIN 0x40												//Added to the sensor type of a rebinned record
+#define OPC_TYPE_FUSION 0x20											//Merged record from several sensors
+#define OPC_TYPE_NORMAL 0x10											//Added to the sensor type of a flow and pressure normalized record
+
+#define OPC_FLAG_GOOD 0x0001											//The record carries a fresh sample
+#define OPC_FLAG_WARMUP 0x0002											//The sensor is still warming up, so the sample was thrown out
+#define OPC_FLAG_ASLEEP 0x0004											//The sensor is powered down by a duty cycle
+#define OPC_FLAG_STALE 0x0008											//The last frame repeated the one before too many times, so it was thrown out
+#define OPC_FLAG_FLOW 0x0010											//Quality bits of the sample: the sample flow is out of range,
+#define OPC_FLAG_LASER 0x0020											//the laser status is too low,
+#define OPC_FLAG_FAN 0x0040												//the fan is not turning,
+#define OPC_FLAG_GLITCH 0x0080											//too many particles were thrown out as glitches,
+#define OPC_FLAG_RANGE 0x0100											//or the sizes do not add up, such as PM1 over PM2.5
+#define OPC_FLAG_SUSPECT 0x01F0											//Any of the quality bits
+#define OPC_FLAG_PACKING 0xFF000000										//Struct layout of the board that made the record (OPC_PACKING_*)
+#define OPC_PACKING_SHIFT 24
+
+#define OPC_PACKING_SCHEMA 0x00											//64 bit values on 8 byte boundaries and floats on 4, as in the schema tables
+#define OPC_PACKING_OTHER 0x80											//Any other layout, plus the alignment of a 64 bit value
+#define OPC_PACKING ((alignof(uint64_t) == 8 && alignof(float) == 4) ? OPC_PACKING_SCHEMA : (OPC_PACKING_OTHER | alignof(uint64_t)))	//Layout of this build
+
+uint16_t opcCRC16(const uint8_t *data, uint32_t len);					//CRC-16/CCITT (0x1021 from 0xFFFF), shared by the packet and journal formats
+
+struct OPCRecordHeader{													//Header at the start of every binary record
+	uint8_t sync;														//Always OPC_RECORD_SYNC
+	uint8_t type;														//Sensor type (OPC_TYPE_*)
+	uint16_t length;													//Bytes of sample data after the header, 0 for a bad log
+	uint32_t hits;														//Number of good hits when the record was made
+	uint32_t logTime;													//millis() when the record was made
+	uint32_t flags;														//OPC_FLAG_* bits
+};
+
+#endif
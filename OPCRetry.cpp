@@ -0,0 +1,129 @@
+//Optical Particle Counter Library
+
+//University of Minnesota - Candler MURI
+
+/*This is the definitions file for the command retry policy.
+See OPCRetry.h for the details.*/
+
+#include "OPCRetry.h"
+
+
+
+//////////RETRY//////////
+
+
+
+OPCRetry::OPCRetry(uint16_t budget, unsigned long first, unsigned long longest, unsigned long limit){
+	attempts = budget;
+	base = first;
+	maxBackoff = longest;
+	factor = 2;
+	jitter = 25;
+	deadline = limit;
+	sequenceLimit = 0;
+	sequenceStart = 0;
+	sequenceDepth = 0;
+	tries = 0;
+	startTime = 0;
+	nextTime = 0;
+	seed = 0;
+	giveUps = 0;
+	maxTime = 0;
+}
+
+void OPCRetry::setAttempts(uint16_t budget){ attempts = budget; }
+
+void OPCRetry::setBackoff(unsigned long first, unsigned long longest, uint8_t growth){
+	base = first;
+	maxBackoff = longest;
+	factor = growth;
+}
+
+void OPCRetry::setJitter(uint8_t percent){ jitter = (percent > 100) ? 100 : percent; }
+
+void OPCRetry::setDeadline(unsigned long limit){ deadline = limit; }
+
+void OPCRetry::setSequenceDeadline(unsigned long limit){ sequenceLimit = limit; }
+
+uint32_t OPCRetry::random32(){											//xorshift, seeded from the clock the first time it is needed
+	if (seed == 0) seed = micros() | 1;
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+	return seed;
+}
+
+void OPCRetry::begin(){
+	tries = 0;
+	startTime = millis();
+	nextTime = startTime;												//The first attempt can be made right away
+}
+
+bool OPCRetry::ready(){ return ((long)(millis() - nextTime) >= 0); }
+
+bool OPCRetry::backoff(){												//The wait is base*factor^(tries-1), capped, then jittered
+	tries++;
+
+	unsigned long pause = base;
+	for (uint16_t i = 1; (i < tries) && (pause < maxBackoff); i++) pause *= factor;
+	if (pause > maxBackoff) pause = maxBackoff;
+
+	unsigned long spread = (pause*jitter)/100;
+	if (spread > 0) pause = pause - spread + (random32() % (2*spread + 1));
+
+	unsigned long now = millis();
+	nextTime = now + pause;
+	if (deadline && ((long)(nextTime - (startTime + deadline)) > 0)) nextTime = startTime + deadline;	//Never wait past the deadline
+	if (sequenceLeft() < pause) nextTime = now + sequenceLeft();		//or the end of the sequence
+	return !isExhausted();
+}
+
+void OPCRetry::wait(){
+	while (!ready()) delay(1);
+}
+
+void OPCRetry::finish(){												//Both outcomes count toward the longest command
+	unsigned long elapsed = getElapsed();
+	if (elapsed > maxTime) maxTime = elapsed;
+}
+
+void OPCRetry::succeed(){ finish(); }
+
+bool OPCRetry::giveUp(){
+	giveUps++;
+	finish();
+	return false;
+}
+
+bool OPCRetry::isExhausted(){
+	if (tries >= attempts) return true;
+	if (sequenceLeft() == 0) return true;
+	return (deadline && (getElapsed() >= deadline));
+}
+
+void OPCRetry::beginSequence(){											//Only the outermost sequence starts the clock, so a reset that
+	if (sequenceDepth++ == 0) sequenceStart = millis();					//calls .powerOff() and .powerOn() is one sequence
+}
+
+void OPCRetry::endSequence(){
+	if (sequenceDepth > 0) sequenceDepth--;
+}
+
+unsigned long OPCRetry::sequenceLeft(){
+	if ((sequenceDepth == 0) || (sequenceLimit == 0)) return 0xFFFFFFFF;
+	unsigned long elapsed = millis() - sequenceStart;
+	return (elapsed >= sequenceLimit) ? 0 : (sequenceLimit - elapsed);
+}
+
+void OPCRetry::pause(unsigned long ms){
+	if (ms > sequenceLeft()) ms = sequenceLeft();
+	delay(ms);
+}
+
+uint16_t OPCRetry::getTries(){ return tries; }
+
+unsigned long OPCRetry::getElapsed(){ return millis() - startTime; }
+
+uint32_t OPCRetry::getGiveUps(){ return giveUps; }
+
+unsigned long OPCRetry::getMaxTime(){ return maxTime; }
@@ -0,0 +1,85 @@
+//Optical Particle Counter Library
+
+//University of Minnesota - Candler MURI
+
+/*This is the header file for the command retry policy.
+Every command that has to be repeated until the sensor answers (power on,
+power off, fan and laser commands) follows the same pattern: make an
+attempt, and if it fails, wait and try again. An OPCRetry object holds the
+rules for that pattern:
+ - an attempt budget, the most attempts for one command
+ - an exponential backoff, the wait after each failed attempt grows by a
+   factor from the base up to a maximum
+ - jitter, a random share of each wait added or taken away, so sensors that
+   fail together do not retry together
+ - a deadline, the most time one command may take from its first attempt
+ - a sequence deadline, the most time a run of commands may take together,
+   such as the fan and laser commands of a power on, or the power off, wait,
+   and power on of a reset
+
+The policy itself never waits. .ready() says when the next attempt may be
+made, so it can be used from a loop. The blocking command functions call
+.wait() instead, which is bounded by the deadline. Inside a sequence, every
+command and .pause() also stops at the end of the sequence, so a dead sensor
+holds up the loop for one sequence deadline at most.
+*/
+
+
+#ifndef OPCRetry_h
+#define OPCRetry_h
+
+#include <arduino.h>
+
+
+
+class OPCRetry
+{
+	private:
+	uint16_t attempts;													//Attempt budget for one command
+	unsigned long base;													//Wait after the first failed attempt (ms)
+	unsigned long maxBackoff;											//Longest wait between attempts (ms)
+	uint8_t factor;														//Growth of the wait after each failure
+	uint8_t jitter;														//Share of each wait that is random (percent)
+	uint8_t sequenceDepth;												//Sequences begun and not ended, as they can nest
+	unsigned long deadline;												//Most time for one command, 0 for none (ms)
+	unsigned long sequenceLimit;										//Most time for a sequence of commands, 0 for none (ms)
+
+	uint16_t tries;														//Attempts made on the current command
+	unsigned long startTime;											//Time of the first attempt
+	unsigned long nextTime;												//Time the next attempt may be made
+	uint32_t seed;														//State of the jitter generator
+	unsigned long sequenceStart;										//Time the outermost sequence began
+
+	uint32_t giveUps;													//Commands that ran out of attempts or time
+	unsigned long maxTime;												//Longest time any command took (ms)
+
+	uint32_t random32();												//Small generator for the jitter
+	void finish();														//Update the longest command time
+	unsigned long sequenceLeft();										//Time left in the sequence (ms), or 0xFFFFFFFF outside of one
+
+	public:
+	OPCRetry(uint16_t budget = 10, unsigned long first = 10, unsigned long longest = 2000, unsigned long limit = 10000);
+	void setAttempts(uint16_t budget);									//Most attempts for one command
+	void setBackoff(unsigned long first, unsigned long longest, uint8_t growth = 2);	//First wait, longest wait (ms), and growth factor
+	void setJitter(uint8_t percent);									//Random share of each wait (default 25 percent)
+	void setDeadline(unsigned long limit);								//Most time for one command (ms), 0 for none
+	void setSequenceDeadline(unsigned long limit);						//Most time for a sequence of commands (ms), 0 for none
+
+	void begin();														//Start a new command
+	bool ready();														//True if the next attempt may be made
+	bool backoff();														//Record a failed attempt and schedule the next. False if no attempts or time remain.
+	void wait();														//Wait until the next attempt may be made (blocking)
+	void succeed();														//Record that the command worked
+	bool giveUp();														//Record that the command failed, always false
+	bool isExhausted();													//True if no attempts or time remain
+	void beginSequence();												//Start a run of commands that share the sequence deadline
+	void endSequence();
+	void pause(unsigned long ms);										//Wait for the sensor (blocking), cut short at the end of the sequence
+
+	uint16_t getTries();												//Attempts made on the current command
+	unsigned long getElapsed();											//Time since the first attempt (ms)
+	uint32_t getGiveUps();												//Commands that ran out of attempts or time
+	unsigned long getMaxTime();											//Longest time any command took (ms)
+};
+
+#endif
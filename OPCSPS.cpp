@@ -0,0 +1,496 @@
+//Optical Particle Counter Library
+
+//University of Minnesota - Candler MURI
+
+/*This is the definitions file for the Sensirion SPS 30.
+The SPS 30 runs the read data function with the log update function, and
+can record new data every 1 seconds. It runs on a serial port, or on I2C
+with OPC_USE_SPS_I2C.*/
+
+#include "OPCSensor.h"
+
+#if OPC_USE_SPS
+
+#ifdef OPC_STATIC_RAM
+static_assert(sizeof(SPS) <= OPC_RAM_SPS, "SPS is over its RAM budget");	//RAM budget from OPCConfig.h
+#endif
+
+
+
+//////////SPS//////////
+
+
+
+
+SPS::SPS(Stream* ser) : OPC(ser) {										//Initialize stream using base OPC constructor
+	retry.setAttempts(8);
+	retry.setBackoff(250, 2000);
+	retry.setDeadline(10000);
+}
+
+void SPS::setFormat(uint8_t outputFormat){								//The integer format is whole ug/m^3 and #/cm^3, so it gets the
+	format = (outputFormat == SPS_FORMAT_UINT16) ? SPS_FORMAT_UINT16 : SPS_FORMAT_FLOAT;	//stale limit for whole numbers
+	setStaleLimit((format == SPS_FORMAT_UINT16) ? OPC_STALE_LIMIT_WHOLE : OPC_STALE_LIMIT);
+}
+
+uint8_t SPS::getFormat(){ return format; }
+
+void SPS::sendStart(){													//Start measurement command. The response is not read here.
+	if (!iicSystem){													//If the system is running serial...
+		s->write(0x7E);                                                 //Send startup frame
+		s->write((byte)0x00);
+		s->write((byte)0x00);                                           //This is the actual command
+		s->write(0x02);
+		s->write(0x01);
+		s->write(format);												//Output format
+		s->write((byte)~(0x03 + format));								//Checksum, 0xF9 for float and 0xF7 for integer
+		s->write(0x7E);
+	}
+#if OPC_USE_SPS_I2C
+	else wireStart();													//If the system is running I2C...
+#endif
+}
+
+void SPS::sendClean(){													//Fan clean command. The response is not read here.
+	if(!iicSystem){														//If the system is running serial...
+		s->write(0x7E);                                                 //Send clean frame
+		s->write((byte)0x00);
+		s->write(0x56);                                                 //This is the actual command
+		s->write((byte)0x00);
+		s->write(0xA9);
+		s->write(0x7E);
+	}
+#if OPC_USE_SPS_I2C
+	else wireCommand(0x5607);											//If the system is running I2C...
+#endif
+}
+
+void SPS::sendRead(){													//Read measurement command. The response is not read here.
+	s->write(0x7E);
+	s->write((byte)0x00);
+	s->write(0x03);                                                 	//This is the actual command
+	s->write((byte)0x00);
+	s->write(0xFC);
+	s->write(0x7E);
+}
+
+void SPS::powerOn()                                			            //SPS Power on command. This sends and recieves the power on frame
+{
+	sendStart();
+	if (!iicSystem){
+		delay (100);
+		for (unsigned int q = 0; q<7; q++) s->read();                   //Read the response bytes
+	}
+}
+
+void SPS::powerOff()                              		                //SPS Power off command. This sends and recieves the power off frame
+{
+	if(!iicSystem){														//If the system is running serial...	
+		s->write(0x7E);                                                 //Send shutdown frame
+		s->write((byte)0x00);
+		s->write(0x01);                                                 //This is the actual command
+		s->write((byte)0x00);
+		s->write(0xFE);
+		s->write(0x7E);
+
+		delay(100);
+		for (unsigned int q = 0; q<7; q++) s->read();                   //Read the response bytes
+	}
+#if OPC_USE_SPS_I2C
+	else wireCommand(0x0104);											//If the system is running I2C...
+#endif
+}
+
+void SPS::clean()                                		                //SPS clean command. This sends and recieves the clean frame
+{
+	sendClean();
+	if(!iicSystem){
+		delay(100); 
+		for (unsigned int q = 0; q<7; q++) s->read();                   //Read the response bytes
+	}
+}
+
+void SPS::setCleanAltitude(float altitude){								//Setting the altitude arms the clean again
+	cleanAltitude = altitude;
+	altCleaned = false;
+}
+
+void SPS::trigger(uint8_t source, float value){							//The altitude comes from the flight computer. The dust picked up
+	OPC::trigger(source, value);										//near the ground is blown out once, when the altitude is reached.
+	if ((source != OPC_TRIGGER_ALTITUDE) || (cleanAltitude <= 0) || altCleaned || asleep) return;
+	if (value < cleanAltitude) return;
+	
+	altCleaned = true;
+	clean();
+	fire(OPC_EVENT_CLEAN, source, value);
+}
+
+void SPS::initOPC()                            			  		        //SPS initialization code. Requires input of SPS serial stream.
+{
+	OPC::initOPC();														//Calls original init
+	
+#if OPC_USE_SPS_I2C
+	if(iicSystem) wireBegin();											//Begin the wire if I2C with required specifications
+#endif
+	
+	powerOn();                                       	            	//Sends SPS active measurement command
+	delay(100);
+	clean();															//clean to start. This does nothing if attached to the pump
+	
+	
+}
+
+void SPS::beginInit(){													//Non-blocking version of the initialization
+	OPC::initOPC();
+#if OPC_USE_SPS_I2C
+	if(iicSystem) wireBegin();											//Begin the wire if I2C with required specifications
+#endif
+	
+	initState = OPC_INIT_BUSY;
+	initStep = 0;
+	retry.begin();
+	sendStart();
+	if (iicSystem) sendClean();											//There is no response frame over I2C, so the clean goes right away
+	retry.backoff();													//Time to wait for the response
+}
+
+uint8_t SPS::pollInit(){												//Serial: the start and clean responses are waited on in turn.
+	if (initState != OPC_INIT_BUSY) return initState;					//I2C: the SPS is ready once it has data.
+	
+#if OPC_USE_SPS_I2C
+	if (iicSystem){
+		if (!retry.ready()) return initState;
+		if (dataReady()){
+			retry.succeed();
+			initState = OPC_INIT_READY;
+		} else if (!retry.backoff()){
+			retry.giveUp();
+			initState = OPC_INIT_FAILED;
+		}
+		return initState;
+	}
+#endif
+	
+	if (s->available() >= 7){											//A full response frame has arrived
+		for (unsigned int q = 0; q<7; q++) s->read();
+		retry.succeed();
+		if (initStep == 0){
+			initStep = 1;
+			retry.begin();
+			sendClean();												//clean to start. This does nothing if attached to the pump
+			retry.backoff();
+		} else initState = OPC_INIT_READY;
+	} else if (retry.ready()){											//No response, so the command is sent again
+		if (retry.isExhausted()){
+			retry.giveUp();
+			initState = OPC_INIT_FAILED;
+		} else {
+			while (s->available()) s->read();
+			if (initStep == 0) sendStart();
+			else sendClean();
+			retry.backoff();
+		}
+	}
+	return initState;
+}
+
+static const char spsHeader[] PROGMEM = ",MC-1um,MC-2.5um,MC-4.0um,MC-10um,NC-0.5um,NC-1um,NC-2.5um,NC-4.0um,NC-10um,Avg. PM";
+static const char spsIntHeader[] PROGMEM = ",MC-1um,MC-2.5um,MC-4.0um,MC-10um,NC-0.5um,NC-1um,NC-2.5um,NC-4.0um,NC-10um,Avg. PM nm";
+
+uint16_t SPS::CSVHeader(char *buf, uint16_t len){						//Writes the .logLine() data header in CSV format
+	if (format == SPS_FORMAT_UINT16) return headerText(spsIntHeader, buf, len);	//The integer format gives the size in nanometers
+	return headerText(spsHeader, buf, len);
+}
+
+bool SPS::update(){														//Reads the data and updates the log quality for the log functions
+	if (sleeping()) return false;										//A sleeping sensor is not read
+	
+    if (takeSample()){                                                  //Read the data and determine the read success.
+       setQuality(true);                                                //This will establish the good log inidicators.
+       goodLogAge = millis();
+       badLog = 0;
+       if (warmingUp()) return false;									//Samples during the warm-up are thrown out
+       nTot++;
+       return true;
+	}
+	
+	badLog ++;
+	if (badLog >= 5) setQuality(false);									//Good log situation the same as in the Plantower code
+#if OPC_USE_RESET
+	if ((millis()-goodLogAge)>=resetTime) {								//If the age of the last good log exceeds the automatic reset trigger,
+		fire(OPC_EVENT_RESET_START, 0, millis() - goodLogAge);
+		powerOff();														//the system will cycle and clean the dust bin.
+		delay (2000);
+		powerOn();
+		delay (100);
+		clean();
+		delay(2000);
+		goodLogAge = millis();
+		fire(OPC_EVENT_RESET_END, 0, 0);
+	}
+#endif
+	return false;
+}
+
+void SPS::dataText(OPCText &text, bool fresh){							//Mass concentrations, number concentrations, and average particle size
+	if (!fresh){														//If there is bad data, the columns are populated with failure symbols.
+		missingText(text, 10);
+		return;
+	}
+	
+	if (format == SPS_FORMAT_UINT16){									//Integers need no float formatting
+		for (unsigned short k = 0; k<4; k++){
+			text.add(',');
+			text.add((unsigned long)SPSintData->mas[k]);
+		}
+		for (unsigned short k = 0; k<5; k++){
+			text.add(',');
+			text.add((unsigned long)SPSintData->nums[k]);
+		}
+		text.add(',');
+		text.add((unsigned long)SPSintData->aver);
+		return;
+	}
+	
+	for (unsigned short k = 0; k<4; k++){								//Mass concentrations
+		text.add(',');
+		text.add(SPSdata->mas[k], 6);
+	}
+	for (unsigned short k = 0; k<5; k++){								//Number concentrations
+		text.add(',');
+		text.add(SPSdata->nums[k], 6);
+	}
+	text.add(',');
+	text.add(SPSdata->aver, 6);											//The average particle size ends the line
+}
+
+uint16_t SPS::logLine(char *buf, uint16_t len){							//This function will parse the data and form a loggable line.
+	unsigned int hits = nTot;
+	bool fresh = update();
+	return lineText(hits, fresh, buf, len);
+}
+  
+#if OPC_USE_READOUT
+uint16_t SPS::logReadout(const char *name, char *buf, uint16_t len){	//Same as log update, but with a readout for the serial monitor
+	unsigned int hits = nTot;
+	bool fresh = update();
+	OPCReadout readout;
+	readoutStart(readout, PSTR("SPS"), name, getSampleAge());
+	
+	if (fresh){
+		float nums[5];
+		getData(nums, 5);
+		readout.line(PSTR(".3 to .5 microns per cubic cm: "), nums[0], 6);
+		readout.line(PSTR(".3 to 1 microns per cubic cm: "), nums[1], 6);
+		readout.line(PSTR(".3 to 2.5 microns per cubic cm: "), nums[2], 6);
+		readout.line(PSTR(".3 to 4 microns per cubic cm: "), nums[3], 6);
+		readout.line(PSTR(".3 to 10 microns per cubic cm: "), nums[4], 6);
+	} else readout.line(PSTR("Bad log"));
+	
+	readoutSend(readout);
+	return lineText(hits, fresh, buf, len);
+}
+#endif
+
+#ifndef OPC_STATIC_RAM
+String SPS::CSVHeader(){
+	char line[OPC_LINE_SIZE];
+	CSVHeader(line, sizeof(line));
+	return String(line);
+}
+
+String SPS::logUpdate(){
+	char line[OPC_LINE_SIZE];
+	logLine(line, sizeof(line));
+	return String(line);
+}
+
+#if OPC_USE_READOUT
+String SPS::logReadout(String name){
+	char line[OPC_LINE_SIZE];
+	logReadout(name.c_str(), line, sizeof(line));
+	return String(line);
+}
+#endif
+#endif
+
+uint16_t SPS::logBinary(uint8_t *buf, uint16_t len){					//Same as log update, but packed into a binary record
+	unsigned int hits = nTot;
+	bool fresh = update();
+	if (format == SPS_FORMAT_UINT16) return packRecord(OPC_TYPE_SPS_INT, hits, fresh, &SPSintData.latest(), sizeof(SPS30intData), buf, len);
+	return packRecord(OPC_TYPE_SPS, hits, fresh, &SPSdata.latest(), sizeof(SPS30data), buf, len);
+}
+
+uint8_t SPS::getData(float *data, uint8_t len){						//Number concentrations from .3 to .5, 1, 2.5, 4, and 10 microns
+	if (len > 5) len = 5;
+	for (uint8_t i = 0; i < len; i++) data[i] = (format == SPS_FORMAT_UINT16) ? SPSintData->nums[i] : SPSdata->nums[i];
+	return len;
+}
+
+uint8_t SPS::getBins(){ return 5; }
+
+bool SPS::readData(){
+	byte raw[40] = {0};													//Reading buffer, in the order the SPS sends it (MSB first)
+	uint8_t dataLen = (format == SPS_FORMAT_UINT16) ? 20 : 40;			//Ten values of 2 or 4 bytes
+	uint64_t arrival = 0;												//Time the response finished arriving
+
+	if(!iicSystem){														//If the SPS is configured in serial mode
+		byte systemInfo[5] = {0};
+		byte data = 0;
+		byte checksum = 0;
+		byte SPSChecksum = 0;
+
+
+		sendRead();                                                 	//The read data function will return true if the data request is successful.
+
+		if (! s->available()) return false;                             //If the given serial connection is not available, the data request will fail.
+
+		if (s->peek() != 0x7E){                                         //If the sent start byte is not as expected, the data request will fail.
+		 for (unsigned short j = 0; j<60; j++) data = s->read();        //The data buffer will be wiped to ensure the next data pull isn't corrupt.
+		 return false;
+		}
+
+		if (s->available() < (7 + dataLen)){                            //If there are not enough data bytes available, the data request will fail. This
+		return false;                                                   //will not clear the data buffer, because the system is still trying to fill it.
+		}
+
+		for(unsigned short j = 0; j<5; j++){                            //This will populate the system information array with the data returned by the                  
+			systemInfo[j] = s->read();                                  //by the system about the request. This is not the actual data, but will provide
+			if (j != 0) checksum += systemInfo[j];                      //information about the data. The information is also added to the checksum.
+		}
+
+		if ((systemInfo[3] != (byte)0x00)||(systemInfo[4] != dataLen)){	//If the system indicates a malfunction of any kind, or the data is not in the
+		 for (unsigned short j = 0; j<60; j++) data = s->read();        //requested format, the data request will fail. Any data that populates the
+		 return false;													//main array will be thrown out to prevent future corruption.
+		}
+
+		byte stuffByte = 0;
+		for(unsigned short j = 0; j < dataLen; j++){      				//This loop will read the data bytes
+			raw[j] = s->read();
+			
+			if (raw[j] == 0x7D) {                               		//This hex indicates that byte stuffing has occurred. The
+				stuffByte = s->read();                              	//series of if statements will determine the original value
+				if (stuffByte == 0x5E) raw[j] = 0x7E;					//based on the following hex and replace the data.
+				if (stuffByte == 0x5D) raw[j] = 0x7D;
+				if (stuffByte == 0x31) raw[j] = 0x11;
+				if (stuffByte == 0x33) raw[j] = 0x13;
+			}
+			checksum += raw[j];                                 		//The data is added to the checksum.
+		}
+
+		SPSChecksum = s->read();                                        //The provided checksum byte is read.
+		data = s->read();                                               //The end byte of the data is read.
+		arrival = opcMicros();											//The frame is complete once the end byte is read
+
+		if (data != 0x7E){                                              //If the end byte is bad, the data request will fail.
+		   for (unsigned short j = 0; j<60; j++) data = s->read();      //At this point, there likely isn't data to throw out. However,
+		   data = 0;                                                    //The removal is completed as a redundant measure to prevent corruption.
+		   return false;
+		}
+
+		checksum = checksum & 0xFF;                                     //The local checksum is calculated here. The LSB is taken by the first line.
+		checksum = ~checksum;                                           //The bit is inverted by the second line.
+
+		if (checksum != SPSChecksum){                                   //If the checksums are not equal, the data request will fail.  
+		  for (unsigned short j = 0; j<60; j++) data = s->read();       //Just to be certain, any remaining data is thrown out to prevent corruption.
+		  return false;
+		}
+  
+	}
+#if OPC_USE_SPS_I2C
+	else if (!wireRead(raw, dataLen, arrival)) return false;			//If the SPS is configured in I2C mode
+#endif
+	
+	return publishRaw(raw, arrival);									//False if the frame is stale
+}
+
+template <typename T> static uint32_t spsQuality(const T &frame){		//Each size holds the sizes below it, so no value can be under a smaller one
+	bool ordered = (frame.mas[0] <= frame.mas[1]) && (frame.mas[1] <= frame.mas[2]) && (frame.mas[2] <= frame.mas[3]) &&
+				   (frame.nums[0] <= frame.nums[1]) && (frame.nums[1] <= frame.nums[2]) && (frame.nums[2] <= frame.nums[3]) &&
+				   (frame.nums[3] <= frame.nums[4]);
+	return ordered ? 0 : OPC_FLAG_RANGE;
+}
+
+bool SPS::publishRaw(const byte *raw, uint64_t arrival){
+	byte buffers[40] = {0};												//The data, converted to LSB first
+	uint8_t word = (format == SPS_FORMAT_UINT16) ? 2 : 4;				//Size of each value
+	uint8_t dataLen = 10*word;											//Ten values in either format
+	
+	for (uint8_t j = 0; j < dataLen; j += word){						//Convert each value to LSB first
+		for (uint8_t i = 0; i < word; i++) buffers[j + i] = raw[j + word - 1 - i];
+	}
+	
+	if (format == SPS_FORMAT_UINT16){									//Copy the data to the struct for the format, and publish it
+		SPS30intData &frame = SPSintData.scratch();
+		memcpy((void *)&frame, (void *)buffers, dataLen);
+		if (!checkFrame(raw, dataLen, spsQuality(frame))) return false;	//A stale frame is not published
+		frame.sampleTime = sampleTime = arrival;
+		SPSintData.publish();
+	} else {
+		SPS30data &frame = SPSdata.scratch();
+		memcpy((void *)&frame, (void *)buffers, dataLen);
+		if (!checkFrame(raw, dataLen, spsQuality(frame))) return false;
+		frame.sampleTime = sampleTime = arrival;
+		SPSdata.publish();
+	}
+	sampleEvent();
+	return true;
+}
+
+void SPS::requestData(){												//Over I2C the read is quick, so it is all done in .collectData()
+	if (!iicSystem) sendRead();
+}
+
+uint8_t SPS::collectData(){												//Takes what has arrived, and keeps the partial frame for the next call
+#if OPC_USE_SPS_I2C
+	if (iicSystem) return OPC::collectData();
+#endif
+	
+	while (s->available()){
+		byte b = s->read();
+		
+		if (b == 0x7E){													//A start or end byte
+			if (rxOpen && (rxLen > 0)){									//End of a frame
+				rxOpen = false;
+				return rxCheck();
+			}
+			rxOpen = true;												//Start of a frame, or an end byte taken for one after a lost byte
+			rxLen = 0;
+			rxEscape = false;
+			continue;
+		}
+		if (!rxOpen) continue;											//Bytes outside a frame are thrown out
+		
+		if (b == 0x7D){													//Byte stuffing: the next byte is the original, with bit 5 flipped
+			rxEscape = true;
+			continue;
+		}
+		if (rxEscape) b ^= 0x20;
+		rxEscape = false;
+		
+		if (rxLen < sizeof(rxFrame)) rxFrame[rxLen++] = b;
+		else rxOpen = false;											//Too long for a response, so it is thrown out
+	}
+	return OPC_COLLECT_WAITING;
+}
+
+uint8_t SPS::rxCheck(){
+	uint64_t arrival = opcMicros();										//The frame is complete once the end byte is read
+	uint8_t dataLen = (format == SPS_FORMAT_UINT16) ? 20 : 40;
+	uint8_t len = rxLen;
+	rxLen = 0;
+	
+	if (len < 5) return OPC_COLLECT_FAILED;								//Address, command, state, length, and checksum at the least
+	byte checksum = 0;
+	for (uint8_t j = 0; j < len - 1; j++) checksum += rxFrame[j];
+	if ((byte)~checksum != rxFrame[len - 1]) return OPC_COLLECT_FAILED;
+	
+	if ((rxFrame[1] != 0x03)||(rxFrame[2] != 0x00)) return OPC_COLLECT_FAILED;	//Not a read response, or the SPS reports a malfunction
+	if ((rxFrame[3] != dataLen)||(len != 5 + dataLen)) return OPC_COLLECT_FAILED;	//No new data (an empty frame), or the wrong format
+	
+	if (!publishRaw(&rxFrame[4], arrival)) return OPC_COLLECT_FAILED;
+	collected = true;
+	return OPC_COLLECT_GOOD;
+}
+
+#endif
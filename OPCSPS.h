@@ -0,0 +1,107 @@
+//Optical Particle Counter Library
+
+//University of Minnesota - Candler MURI
+
+/*This is the header file for the Sensirion SPS 30.
+The SPS 30 runs the read data function with the log update function, and
+can record new data every 1 seconds. It runs on a serial port, or on I2C
+with OPC_USE_SPS_I2C.
+*/
+
+
+#ifndef OPCSPS_h
+#define OPCSPS_h
+
+#include "OPCSensor.h"
+#if OPC_USE_SPS_I2C
+#include <i2c_t3.h>
+#endif
+#define SPS_ADDRESS 0x69												//SPS30 I2C address
+#define SPS_FORMAT_FLOAT 0x03											//SPS30 output formats: big-endian IEEE float,
+#define SPS_FORMAT_UINT16 0x05											//or big-endian unsigned 16 bit integer
+
+
+
+class SPS: public OPC
+{
+	private:
+	bool altCleaned = false;											//The boolean for altitude based fan clean operation
+	float cleanAltitude = 0;											//Altitude trigger for the fan clean, 0 for none
+	bool iicSystem = false;												//Indication of i2c or serial system 
+	uint8_t format = SPS_FORMAT_FLOAT;									//Output format requested at power on
+	byte rxFrame[45];													//Response being collected for a fleet read, unstuffed: address,
+	uint8_t rxLen = 0;													//command, state, length, up to 40 data bytes, and checksum
+	bool rxOpen = false;												//Inside a frame
+	bool rxEscape = false;												//The last byte was a stuffing escape
+	bool update();														//Read the data and update the log quality
+	void sendStart();													//Start measurement command, without waiting for the response
+	void sendClean();													//Fan clean command, without waiting for the response
+	void sendRead();													//Read measurement command, without waiting for the response
+	uint8_t rxCheck();													//Check a collected response, and publish it if it is good
+	bool publishRaw(const byte *raw, uint64_t arrival);					//Convert a response (MSB first) for the format, and publish it unless it is stale
+#if OPC_USE_SPS_I2C
+	i2c_t3 *SPSWire;													//Local wire bus
+	i2c_pins SPSpins;													//Local wire pins
+	uint8_t	CalcCrc(uint8_t data[2]);									//SPS wire checksum calculation
+	bool dataReady();													//data indicator
+	void setPointer(uint16_t pointer);									//Start an I2C transmission with a register pointer
+	void wireBegin();													//I2C transport, in OPCSPSWire.cpp
+	void wireStart();
+	void wireCommand(uint16_t pointer);
+	bool wireRead(byte *raw, uint8_t dataLen, uint64_t &arrival);
+#endif
+	void dataText(OPCText &text, bool fresh);							//Data columns of the CSV line
+	
+	
+	public:
+	struct SPS30data {													//struct for SPS30 data
+		float mas[4];
+		float nums[5];
+		float aver;
+		uint64_t sampleTime;											//Time the response finished arriving (us)
+	};
+	OPCSample<SPS30data> SPSdata;
+	
+	struct SPS30intData {												//struct for SPS30 data in the integer format
+		uint16_t mas[4];												//ug/m^3
+		uint16_t nums[5];												//#/cm^3
+		uint16_t aver;													//Typical particle size in nm
+		uint64_t sampleTime;
+	};
+	OPCSample<SPS30intData> SPSintData;
+
+#if OPC_USE_SPS_I2C
+	SPS(i2c_t3 wireBus, i2c_pins pins);									//I2C Constructor
+#endif
+	SPS(Stream* ser);													//Serial Constructor
+	void setFormat(uint8_t outputFormat);								//SPS_FORMAT_FLOAT or SPS_FORMAT_UINT16, before power on
+	uint8_t getFormat();
+	void powerOn();														//System commands for SPS
+	void powerOff();
+	void clean();
+	void setCleanAltitude(float altitude);								//Fan clean once when an altitude trigger reaches this, 0 to turn it off
+	void trigger(uint8_t source, float value);							//Outside trigger, OPC_TRIGGER_ALTITUDE for the fan clean
+	void initOPC();														//Overrides of OPC data functions and initialization
+	void beginInit();													//Non-blocking initialization
+	uint8_t pollInit();
+	uint16_t CSVHeader(char *buf, uint16_t len);						//CSV header, written into the buffer
+	uint16_t logLine(char *buf, uint16_t len);							//Log update, written into the buffer. Returns the length, or 0 if it does not fit
+#if OPC_USE_READOUT
+	uint16_t logReadout(const char *name, char *buf, uint16_t len);	//Log line, and a readout for the serial monitor
+#endif
+#ifndef OPC_STATIC_RAM
+	String CSVHeader();													//Returns a CSV header for log update
+	String logUpdate();													//Returns the CSV string of SPS data
+#if OPC_USE_READOUT
+	String logReadout(String name);										//Log update, but with a nice serial print
+#endif
+#endif
+	uint16_t logBinary(uint8_t *buf, uint16_t len);						//Log update, but as a binary record
+	uint8_t getData(float *data, uint8_t len);							//Number concentrations, .5um and up
+	uint8_t getBins();
+	bool readData();													//data reader- generally controlled internally
+	void requestData();													//Fleet read: send the read command,
+	uint8_t collectData();												//and take the response a byte at a time as it arrives
+};
+
+#endif
@@ -0,0 +1,113 @@
+//Optical Particle Counter Library
+
+//University of Minnesota - Candler MURI
+
+/*This is the definitions file for the I2C transport of the SPS 30.
+It is the only part of the library that needs i2c_t3, so a payload that
+runs every SPS on a serial port can leave it out with OPC_USE_SPS_I2C.*/
+
+#include "OPCSensor.h"
+
+#if OPC_USE_SPS && OPC_USE_SPS_I2C
+
+
+
+//////////SPS I2C//////////
+
+
+
+SPS::SPS(i2c_t3 wireBus, i2c_pins pins) : OPC()							//I2C constructor for SPS object
+{
+	SPSWire = &wireBus;
+	SPSpins = pins;
+	iicSystem = true;
+	retry.setAttempts(8);												//The SPS answers within a second
+	retry.setBackoff(250, 2000);
+	retry.setDeadline(10000);
+}
+
+void SPS::wireBegin(){ SPSWire->begin(I2C_MASTER,0x69,SPSpins,I2C_PULLUP_EXT,I2C_RATE_100); }	//Begin the wire with required specifications
+
+void SPS::setPointer(uint16_t pointer){									//The SPS registers take a two byte pointer, MSB first
+	SPSWire->beginTransmission(SPS_ADDRESS);
+	SPSWire->write((uint8_t)(pointer >> 8));
+	SPSWire->write((uint8_t)(pointer & 0xFF));
+}
+
+void SPS::wireStart(){													//Start measurement command
+	byte data[2] = {format,0x00};										//Data to write to set proper mode
+	setPointer(0x0010);													//Set Pointer
+	SPSWire->write(data[0]);											//Write power on Data
+	SPSWire->write(data[1]);
+	SPSWire->write(CalcCrc(data));										//Every two bytes requires a checksum
+	SPSWire->endTransmission();
+}
+
+void SPS::wireCommand(uint16_t pointer){								//Commands with no data, such as clean and power off
+	setPointer(pointer);
+	SPSWire->endTransmission();
+}
+
+bool SPS::wireRead(byte *raw, uint8_t dataLen, uint64_t &arrival){		//Read the measurement, most significant byte first
+	if (!dataReady()) return false;										//If the data is not available to pull, the data read failed.
+	
+	uint8_t count = dataLen/2*3;										//Every two bytes are followed by a checksum
+	setPointer(0x0300);													//Set Pointer
+	SPSWire->endTransmission(I2C_NOSTOP);								//request read
+	SPSWire->sendRequest(SPS_ADDRESS,count,I2C_STOP);					//Fill the buffer
+	SPSWire->finish();													//Wait for the buffer to fill
+	arrival = opcMicros();
+	
+	if(SPSWire->available() != count) return false;						//If the buffer does not fill, the data read failed.
+	
+	unsigned short i = 0;
+	
+	while(SPSWire->available()){										//Clear the buffer
+		uint8_t data[3];
+		
+		for (uint8_t j = 0; j < 3; j++){								//read three bytes
+			data[j] = SPSWire->readByte();
+		}
+		
+		if (CalcCrc(data) != data[2]) return false;						//if the bytes fail the checksum, the data read failed.
+		raw[i++] = data[0];												//Otherwise, add the data to the buffer
+		raw[i++] = data[1];
+	}
+	return true;
+}
+
+bool SPS::dataReady(){													//Check if the SPS is ready to send measurement data
+	setPointer(0x0202);													//Set Pointer
+	SPSWire->endTransmission(I2C_NOSTOP);								//request read
+	SPSWire->sendRequest(SPS_ADDRESS,3,I2C_STOP);
+	SPSWire->finish();													//Wait to finish
+	
+	uint8_t data[3];
+	uint8_t i = 0;
+	
+	while (SPSWire->available()){										//read data
+		if (i < 3) data[i++] = SPSWire->readByte();
+		else return false;
+	}
+	
+	if((CalcCrc(data) == data[2])&&(data[0] == 0)&&(data[1] == 1)) return true;	//if the data is correctly transmitted and indicates data is ready, return true
+	
+	return false;
+}
+
+uint8_t SPS::CalcCrc(uint8_t data[2]) {									//Calculate the two byte checksum for I2C
+	uint8_t crc = 0xFF;
+	for(int i = 0; i < 2; i++) {
+		crc ^= data[i];
+		for(uint8_t bit = 8; bit > 0; --bit) {
+			if(crc & 0x80) {
+				crc = (crc << 1) ^ 0x31u;
+			} else {
+				crc = (crc << 1);
+			}
+		}
+	}
+	return crc;
+}
+
+#endif
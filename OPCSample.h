@@ -0,0 +1,69 @@
+//Optical Particle Counter Library
+
+//University of Minnesota - Candler MURI
+
+/*This is the header file for double-buffered sample publication.
+An OPCSample holds two copies of a sensor data struct. The sensor decodes
+each new frame into the scratch copy, and only once the checksum passes does
+it publish that copy. Publishing flips which copy is the latest and bumps a
+sequence number, so a reader never sees a half-written or failed frame.
+
+Readers in the same loop as the sensor can use the latest copy in place
+(sensor.PMSdata->pm25_standard), with no copy and no lock. A reader that can
+be interrupted by a publish (for example, a sensor read from an interrupt)
+should take a .snapshot(), which copies the latest sample and tries again if
+a publish happened during the copy. An interrupt that reads while the main
+loop is decoding is always safe, because decoding only touches the scratch copy.
+
+It has no Arduino dependencies, so it can also be used on a computer.
+*/
+
+
+#ifndef OPCSample_h
+#define OPCSample_h
+
+#include <stdint.h>
+
+#define OPC_SAMPLE_BARRIER() __sync_synchronize()						//Keeps the sequence number in order with the data
+
+
+
+template <typename T>
+class OPCSample
+{
+	private:
+	T slots[2];															//Latest sample and scratch copy
+	volatile uint32_t seq;												//Number of samples published. The low bit picks the latest copy.
+
+	public:
+	OPCSample() : seq(0) {
+		slots[0] = T();
+		slots[1] = T();
+	}
+
+	T &scratch(){ return slots[(seq + 1) & 1]; }						//Copy to decode a new frame into
+
+	void publish(){														//Make the scratch copy the latest sample
+		OPC_SAMPLE_BARRIER();
+		seq = seq + 1;
+		OPC_SAMPLE_BARRIER();
+	}
+
+	const T &latest() const { return slots[seq & 1]; }					//Latest sample, in place
+	const T *operator->() const { return &slots[seq & 1]; }
+	uint32_t sequence() const { return seq; }							//Changes every time a sample is published
+
+	uint32_t snapshot(T &out) const {									//Copy of the latest sample that no publish could have torn.
+		uint32_t before, after;											//Returns the sequence number of the copy.
+		do {
+			before = seq;
+			OPC_SAMPLE_BARRIER();
+			out = slots[before & 1];
+			OPC_SAMPLE_BARRIER();
+			after = seq;
+		} while (before != after);
+		return before;
+	}
+};
+
+#endif
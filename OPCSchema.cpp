@@ -0,0 +1,182 @@
+//Optical Particle Counter Library
+
+//University of Minnesota - Candler MURI
+
+/*This is the definitions file for the record schemas.
+The tables follow the data structs in OPCSensor.h field for field, padding
+left out. A change to one of those structs has to be made here as well.*/
+
+#include "OPCSchema.h"
+#include <string.h>
+
+#ifdef ARDUINO
+#include <stddef.h>
+#include "OPCSensor.h"
+																		//The public structs are checked here. R1data is private to R1,
+																		//so its layout is only written down in the table. Boards with
+																		//another layout (OPCRecord.h) skip the checks, and mark their
+																		//records so they are not decoded with these offsets.
+#define OPC_SCHEMA_CHECK(check) (OPC_PACKING != OPC_PACKING_SCHEMA || (check))
+#if OPC_USE_PLANTOWER
+static_assert(OPC_SCHEMA_CHECK(sizeof(Plantower::PMS5003data) == 40 && offsetof(Plantower::PMS5003data, sampleTime) == 32), "PMS5003data schema is out of date");
+#endif
+#if OPC_USE_SPS
+static_assert(OPC_SCHEMA_CHECK(sizeof(SPS::SPS30data) == 48 && offsetof(SPS::SPS30data, sampleTime) == 40), "SPS30data schema is out of date");
+static_assert(OPC_SCHEMA_CHECK(sizeof(SPS::SPS30intData) == 32 && offsetof(SPS::SPS30intData, sampleTime) == 24), "SPS30intData schema is out of date");
+#endif
+#if OPC_USE_HPM
+static_assert(OPC_SCHEMA_CHECK(sizeof(HPM::HPMdata) == 24 && offsetof(HPM::HPMdata, sampleTime) == 16), "HPMdata schema is out of date");
+#endif
+#if OPC_USE_N3
+static_assert(OPC_SCHEMA_CHECK(sizeof(N3::N3data) == 96 && offsetof(N3::N3data, pm1) == 60 && offsetof(N3::N3data, sampleTime) == 88), "N3data schema is out of date");
+#endif
+static_assert(OPC_SCHEMA_CHECK(sizeof(OPCPMdata) == 24 && offsetof(OPCPMdata, sampleTime) == 16), "OPCPMdata schema is out of date");
+#endif
+
+
+
+//////////TABLES//////////
+
+
+
+static const OPCSchemaField plantowerFields[] = {						//Plantower::PMS5003data
+	{"framelen", OPC_SCHEMA_U16, 0, 1},
+	{"pm10_standard", OPC_SCHEMA_U16, 2, 1},
+	{"pm25_standard", OPC_SCHEMA_U16, 4, 1},
+	{"pm100_standard", OPC_SCHEMA_U16, 6, 1},
+	{"pm10_env", OPC_SCHEMA_U16, 8, 1},
+	{"pm25_env", OPC_SCHEMA_U16, 10, 1},
+	{"pm100_env", OPC_SCHEMA_U16, 12, 1},
+	{"particles_03um", OPC_SCHEMA_U16, 14, 1},
+	{"particles_05um", OPC_SCHEMA_U16, 16, 1},
+	{"particles_10um", OPC_SCHEMA_U16, 18, 1},
+	{"particles_25um", OPC_SCHEMA_U16, 20, 1},
+	{"particles_50um", OPC_SCHEMA_U16, 22, 1},
+	{"particles_100um", OPC_SCHEMA_U16, 24, 1},
+	{"unused", OPC_SCHEMA_U16, 26, 1},
+	{"checksum", OPC_SCHEMA_U16, 28, 1},
+	{"sampleTime", OPC_SCHEMA_U64, 32, 1}};
+
+static const OPCSchemaField spsFields[] = {								//SPS::SPS30data
+	{"mas", OPC_SCHEMA_F32, 0, 4},
+	{"nums", OPC_SCHEMA_F32, 16, 5},
+	{"aver", OPC_SCHEMA_F32, 36, 1},
+	{"sampleTime", OPC_SCHEMA_U64, 40, 1}};
+
+static const OPCSchemaField spsIntFields[] = {							//SPS::SPS30intData
+	{"mas", OPC_SCHEMA_U16, 0, 4},
+	{"nums", OPC_SCHEMA_U16, 8, 5},
+	{"aver", OPC_SCHEMA_U16, 18, 1},
+	{"sampleTime", OPC_SCHEMA_U64, 24, 1}};
+
+static const OPCSchemaField r1Fields[] = {								//R1::R1data
+	{"bins", OPC_SCHEMA_U16, 0, 16},
+	{"bin1time", OPC_SCHEMA_U8, 32, 1},
+	{"bin2time", OPC_SCHEMA_U8, 33, 1},
+	{"bin3time", OPC_SCHEMA_U8, 34, 1},
+	{"bin4time", OPC_SCHEMA_U8, 35, 1},
+	{"sampleFlowRate", OPC_SCHEMA_F32, 36, 1},
+	{"tempRaw", OPC_SCHEMA_U16, 40, 1},
+	{"humidRaw", OPC_SCHEMA_U16, 42, 1},
+	{"samplePeriod", OPC_SCHEMA_F32, 44, 1},
+	{"rejectCountGlitch", OPC_SCHEMA_U8, 48, 1},
+	{"rejectCountLong", OPC_SCHEMA_U8, 49, 1},
+	{"pm1", OPC_SCHEMA_F32, 52, 1},
+	{"pm2_5", OPC_SCHEMA_F32, 56, 1},
+	{"pm10", OPC_SCHEMA_F32, 60, 1},
+	{"checksum", OPC_SCHEMA_U32, 64, 1},
+	{"sampleTime", OPC_SCHEMA_U64, 72, 1}};
+
+static const OPCSchemaField hpmFields[] = {								//HPM::HPMdata
+	{"PM1_0", OPC_SCHEMA_U16, 0, 1},
+	{"PM2_5", OPC_SCHEMA_U16, 2, 1},
+	{"PM4_0", OPC_SCHEMA_U16, 4, 1},
+	{"PM10_0", OPC_SCHEMA_U16, 6, 1},
+	{"checksum", OPC_SCHEMA_U16, 8, 1},
+	{"checksumR", OPC_SCHEMA_U16, 10, 1},
+	{"sampleTime", OPC_SCHEMA_U64, 16, 1}};
+
+static const OPCSchemaField n3Fields[] = {								//N3::N3data
+	{"bins", OPC_SCHEMA_U16, 0, 24},
+	{"bin1time", OPC_SCHEMA_U8, 48, 1},
+	{"bin2time", OPC_SCHEMA_U8, 49, 1},
+	{"bin3time", OPC_SCHEMA_U8, 50, 1},
+	{"bin4time", OPC_SCHEMA_U8, 51, 1},
+	{"samplePeriod", OPC_SCHEMA_U16, 52, 1},
+	{"sampleFlowRate", OPC_SCHEMA_U16, 54, 1},
+	{"tempRaw", OPC_SCHEMA_U16, 56, 1},
+	{"humidRaw", OPC_SCHEMA_U16, 58, 1},
+	{"pm1", OPC_SCHEMA_F32, 60, 1},
+	{"pm2_5", OPC_SCHEMA_F32, 64, 1},
+	{"pm10", OPC_SCHEMA_F32, 68, 1},
+	{"rejectCountGlitch", OPC_SCHEMA_U16, 72, 1},
+	{"rejectCountLong", OPC_SCHEMA_U16, 74, 1},
+	{"rejectCountRatio", OPC_SCHEMA_U16, 76, 1},
+	{"rejectCountRange", OPC_SCHEMA_U16, 78, 1},
+	{"fanRevCount", OPC_SCHEMA_U16, 80, 1},
+	{"laserStatus", OPC_SCHEMA_U16, 82, 1},
+	{"checkSum", OPC_SCHEMA_U16, 84, 1},
+	{"sampleTime", OPC_SCHEMA_U64, 88, 1}};
+
+static const OPCSchemaField pmFields[] = {								//OPCPMdata, the PM-only reads of the R1 and N3
+	{"pm1", OPC_SCHEMA_F32, 0, 1},
+	{"pm2_5", OPC_SCHEMA_F32, 4, 1},
+	{"pm10", OPC_SCHEMA_F32, 8, 1},
+	{"sampleTime", OPC_SCHEMA_U64, 16, 1}};
+
+#define OPC_FIELDS(list) (uint8_t)(sizeof(list)/sizeof(list[0])), list
+
+static const OPCSchema schemas[] = {
+	{OPC_TYPE_PLANTOWER, "Plantower", 40, OPC_FIELDS(plantowerFields)},
+	{OPC_TYPE_SPS, "SPS", 48, OPC_FIELDS(spsFields)},
+	{OPC_TYPE_R1, "R1", 80, OPC_FIELDS(r1Fields)},
+	{OPC_TYPE_HPM, "HPM", 24, OPC_FIELDS(hpmFields)},
+	{OPC_TYPE_N3, "N3", 96, OPC_FIELDS(n3Fields)},
+	{OPC_TYPE_SPS_INT, "SPS_INT", 32, OPC_FIELDS(spsIntFields)},
+	{OPC_TYPE_R1_PM, "R1_PM", 24, OPC_FIELDS(pmFields)},
+	{OPC_TYPE_N3_PM, "N3_PM", 24, OPC_FIELDS(pmFields)}};
+
+
+
+//////////LOOKUP//////////
+
+
+
+const OPCSchema *opcSchema(uint8_t type){
+	for (uint8_t i = 0; i < sizeof(schemas)/sizeof(schemas[0]); i++){
+		if (schemas[i].type == type) return &schemas[i];
+	}
+	return NULL;
+}
+
+uint8_t opcSchemaSize(uint8_t fieldType){
+	switch (fieldType){
+		case OPC_SCHEMA_U8: return 1;
+		case OPC_SCHEMA_U16: return 2;
+		case OPC_SCHEMA_U32: return 4;
+		case OPC_SCHEMA_F32: return 4;
+		case OPC_SCHEMA_U64: return 8;
+		case OPC_SCHEMA_F64: return 8;
+	}
+	return 0;
+}
+
+double opcSchemaValue(const uint8_t *data, const OPCSchemaField &field, uint8_t index){	//memcpy, since the record data is not aligned
+	const uint8_t *at = data + field.offset + index*opcSchemaSize(field.type);
+	uint8_t u8;
+	uint16_t u16;
+	uint32_t u32;
+	uint64_t u64;
+	float f32;
+	double f64;
+
+	switch (field.type){
+		case OPC_SCHEMA_U8: memcpy(&u8, at, 1); return u8;
+		case OPC_SCHEMA_U16: memcpy(&u16, at, 2); return u16;
+		case OPC_SCHEMA_U32: memcpy(&u32, at, 4); return u32;
+		case OPC_SCHEMA_U64: memcpy(&u64, at, 8); return (double)u64;
+		case OPC_SCHEMA_F32: memcpy(&f32, at, 4); return f32;
+		case OPC_SCHEMA_F64: memcpy(&f64, at, 8); return f64;
+	}
+	return 0;
+}
@@ -0,0 +1,58 @@
+//Optical Particle Counter Library
+
+//University of Minnesota - Candler MURI
+
+/*This is the header file for the record schemas.
+A binary record from .logBinary() carries the data struct of the sensor as
+it sits in memory. Each schema lists the fields of one of those structs: the
+name, the type, where it starts, and how many values it holds. Programs on a
+computer use them to read the records without the sensor classes, so the
+struct layouts only have to be written down once.
+
+The offsets are the ones on the Teensy (ARM), which match a 64 bit computer
+(OPC_PACKING_SCHEMA in OPCRecord.h). On a board with that layout,
+OPCSchema.cpp checks them against the structs when it is compiled. Boards
+with another layout, such as AVR, still build, and mark their records so the
+decoder does not read them with the wrong offsets.
+
+Only the sensor records have a fixed layout. Derived, rebinned, normalized,
+and fused records (OPC_TYPE_DERIVED, OPC_TYPE_REBIN, OPC_TYPE_NORMAL,
+OPC_TYPE_FUSION) change with their setup, so they have no schema.
+*/
+
+
+#ifndef OPCSchema_h
+#define OPCSchema_h
+
+#include <stdint.h>
+#include "OPCRecord.h"
+
+#define OPC_SCHEMA_U8 1													//Field types
+#define OPC_SCHEMA_U16 2
+#define OPC_SCHEMA_U32 3
+#define OPC_SCHEMA_U64 4
+#define OPC_SCHEMA_F32 5
+#define OPC_SCHEMA_F64 6
+
+
+
+struct OPCSchemaField{													//One field of a data struct
+	const char *name;
+	uint8_t type;														//OPC_SCHEMA_*
+	uint16_t offset;													//Bytes from the start of the struct
+	uint8_t count;														//Values in the field, more than 1 for an array
+};
+
+struct OPCSchema{														//Layout of the data in one type of binary record
+	uint8_t type;														//OPC_TYPE_*
+	const char *name;
+	uint16_t size;														//Length of a good record's data
+	uint8_t nFields;
+	const OPCSchemaField *fields;
+};
+
+const OPCSchema *opcSchema(uint8_t type);								//Schema of a record type, or NULL if it has no fixed layout
+uint8_t opcSchemaSize(uint8_t fieldType);								//Bytes in one value of a field type
+double opcSchemaValue(const uint8_t *data, const OPCSchemaField &field, uint8_t index);	//One value of a field, from the record data
+
+#endif
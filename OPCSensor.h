@@ -19,7 +19,11 @@ and can record new data every 1 seconds. The R1 runs on SPI.
 
 The HPM runs the read data function with the log update function, and can
 record new data every 1 seconds.
-  
+
+This file holds the parent OPC class, and includes the header of each
+sensor that is turned on in OPCConfig.h. A sensor that is turned off is not
+compiled, and neither is anything only it needs: SPI for the R1 and N3, and
+i2c_t3 for the SPS on I2C.
 */
 
 
@@ -27,11 +31,35 @@ record new data every 1 seconds.
 #define OPCSensor_h
 
 #include <arduino.h>
-#include <SPI.h>
-#include <i2c_t3.h>
 #include <Stream.h>
-#define R1_SPEED 300000
-#define N3_SPEED 300000
+#include "OPCConfig.h"
+#include "OPCConsole.h"
+#include "OPCEvent.h"
+#include "OPCRecord.h"
+#include "OPCRetry.h"
+#include "OPCSample.h"
+
+#define ALPHA_READ_HISTOGRAM 0											//Read modes for the R1 and N3: the full histogram every read,
+#define ALPHA_READ_PM 1													//or only the PM values, with the histogram on its own schedule
+
+#define OPC_INIT_BUSY 0													//States for non-blocking initialization
+#define OPC_INIT_READY 1
+#define OPC_INIT_FAILED 2
+
+#define OPC_COLLECT_WAITING 0											//States of a fleet read (OPCFleet.h): no answer yet,
+#define OPC_COLLECT_GOOD 1												//a good sample held for the next log,
+#define OPC_COLLECT_FAILED 2											//or an answer with no new or no good data
+
+#define OPC_STALE_LIMIT 30												//Default repeats of the same frame before it is stale
+#define OPC_STALE_LIMIT_WHOLE 600										//For sensors that send whole numbers, which can hold still for minutes in steady air
+
+uint64_t opcMicros();													//micros(), corrected for the 32 bit rollover
+
+struct OPCPMdata{														//PM values from an Alphasense PM-only read
+	float pm1, pm2_5, pm10;												//ug/m^3
+	uint64_t sampleTime;												//Time the transfer finished (us)
+};
+
 
 class OPC																//Parent OPC class
 {
@@ -42,167 +70,126 @@ class OPC																//Parent OPC class
 	Stream *s;															//Declares data IO stream
 	unsigned long goodLogAge;											//Age of the last good set of data
 	unsigned long resetTime;											//Age the last good log must reach to trigger a reset
+	uint64_t sampleTime;												//Time the last good frame finished arriving (us)
+	bool asleep;														//Powered down by .sleep()
+	unsigned long warmupStart;											//Time of the last .wake()
+	unsigned long warmupLength;											//Length of the warm-up after a .wake()
+	uint8_t initState;													//OPC_INIT_* state of a non-blocking initialization
+	uint8_t initStep;													//Step of the initialization, for each sensor
+	uint16_t initTries;													//Attempts made in the current step
+	unsigned long initTime;												//Time the current attempt began
+	OPCRetry retry;														//Retry policy shared by every command of the sensor
+	OPCConsole *console;												//Queue for .logReadout(), or NULL to write to Serial
+	bool collected;														//A good sample from .collectData() that has not been logged
+	OPCEventHandler handler;											//Called for the events in the mask, or NULL for none
+	void *handlerContext;												//Passed back to the handler
+	uint8_t eventMask;													//OPC_EVENT_* bits the handler is called for
+	uint8_t thresholdBin;												//Bin of .getData() watched for crossings, or OPC_THRESHOLD_OFF
+	bool overThreshold;													//The bin is at or above the level
+	float thresholdLevel, thresholdHysteresis;
+	uint32_t frameHash;													//Hash of the payload of the last good frame
+	uint16_t repeats;													//Frames in a row with the same payload
+	uint16_t staleLimit;												//Repeats before a frame is stale, 0 to never
+	uint32_t frameFlags;												//OPC_FLAG_STALE and the quality bits of the last good frame
+	uint32_t staleFrames;												//Frames thrown out as stale
+	uint32_t suspectFrames;												//Frames with any quality bit
 	uint16_t bytes2int(byte LSB, byte MSB);								//Convert given bytes to integers
+	bool sleeping();													//Check for sleep before a read, and hold off the reset timer
+	bool takeSample();													//The sample from .collectData() if there is one, or else a new read
+	void fire(uint8_t type, uint8_t detail, float value);				//Call the handler if it wants the event
+	void sampleEvent();													//A good frame was published: the sample event and the threshold
+	void setQuality(bool good);											//Set the log quality, with an event when it changes
+	bool checkFrame(const void *payload, uint16_t len, uint32_t quality);	//Hash a checksummed payload and keep its quality bits. False if it is stale.
+	uint32_t logFlags(bool fresh);										//OPC_FLAG_* bits for a log
+	void prefixText(OPCText &text, unsigned int hits, bool fresh);		//Hits, last log, sample time, and flags columns
+	void missingText(OPCText &text, uint8_t columns);					//Failure symbols for columns with no data
+	virtual void dataText(OPCText &text, bool fresh);					//Data columns of the CSV line, for each sensor
+	uint16_t lineText(unsigned int hits, bool fresh, char *buf, uint16_t len);	//Prefix and data columns. Returns the length, or 0 if they do not fit
+	uint16_t headerText(const char *columns, char *buf, uint16_t len);	//Prefix header, and the sensor's columns from program memory
+	uint16_t packRecord(uint8_t type, unsigned int hits, bool fresh, const void *data, uint16_t dataLen, uint8_t *buf, uint16_t len);
+	static OPC *spiOwner;												//Sensor holding its slave select low between polls, or NULL
+	bool claimSPI();													//Take the SPI bus for a handshake, false if another sensor has it
+	void releaseSPI();
+	bool alphaRead(uint8_t cs, uint32_t speed, byte command, byte *data, uint8_t len, uint64_t &arrival);	//SPI read shared by the Alphasense sensors
+	uint32_t alphaPMQuality(float pm1, float pm2_5, float pm10);		//OPC_FLAG_RANGE if the PM values of an Alphasense sensor are out of order
+	bool alphaCheckPM(uint32_t quality);								//Frame check of a PM-only read. False while the histograms are stale.
+#if OPC_USE_READOUT
+	void readoutStart(OPCReadout &readout, const char *sensor, const char *name, unsigned long lastLog);	//Banner, hits, and last log time
+	void readoutSend(OPCReadout &readout);								//Close the readout, and queue it on the console or write it to Serial
+#endif
 	
 	public:
 	OPC();
 	OPC(Stream* ser);													//Parent Constructor
 	int getTot();														//Parent quality checks
 	bool getLogQuality();												//get the quality of the log
+	uint64_t getSampleTime();											//get the arrival time of the last good frame (us)
+	unsigned long getSampleAge();										//get the age of the last good frame (ms)
 	void initOPC();														//Initialization
-	String CSVHeader();													//Placeholders
-	String logUpdate();
-	String logReadout(String name);													
-	bool readData();
-	void powerOn();
-	void powerOff();
-	void setReset(unsigned long resetTimer);							//Manually set the bad log reset timer
-};
-
-
-
-class Plantower: public OPC
-{                              
-	private:
-	unsigned int logRate;												//System log rate
-	void command(uint8_t CMD, uint8_t MODE);							//Command base
-	
-	public:
-	struct PMS5003data {												//Struct that holds Plantower data
-		uint16_t framelen;
-		uint16_t pm10_standard, pm25_standard, pm100_standard;
-		uint16_t pm10_env, pm25_env, pm100_env;
-		uint16_t particles_03um, particles_05um, particles_10um, particles_25um, particles_50um, particles_100um;
-		uint16_t unused;
-		uint16_t checksum;
-	} PMSdata;
-	
-	Plantower(Stream* ser, unsigned int logRate);						//Plantower constructor
-	void powerOn();
-	void powerOff();
-	void passiveMode();
-	void activeMode();
-	void initOPC();
-	String CSVHeader();													//Overrides of OPC data functions
-	String logUpdate();
-	String logReadout(String name);
-	bool readData();
-};
-
-
-
-class SPS: public OPC
-{
-	private:
-	bool altCleaned = false;											//The boolean for altitude based fan clean operation
-	bool iicSystem = false;												//Indication of i2c or serial system 
-	i2c_t3 *SPSWire;													//Local wire bus
-	i2c_pins SPSpins;													//Local wire pins
-	uint8_t	CalcCrc(uint8_t data[2]);									//SPS wire checksum calculation
-	bool dataReady();													//data indicator
-	
-	
-	public:
-	struct SPS30data {													//struct for SPS30 data
-		float mas[4];
-		float nums[5];
-		float aver;		
-	}SPSdata;
-
-	SPS(i2c_t3 wireBus, i2c_pins pins);									//I2C Constructor
-	SPS(Stream* ser);													//Serial Constructor
-	void powerOn();														//System commands for SPS
-	void powerOff();
-	void clean();
-	void initOPC();														//Overrides of OPC data functions and initialization
-	String CSVHeader();													//Returns a CSV header for log update
-	String logUpdate();													//Returns the CSV string of SPS data
-	String logReadout(String name);										//Log update, but with a nice serial print
-	bool readData();													//data reader- generally controlled internally
-};
-
-
-
-
-class R1: public OPC {													//The R1 runs on SPI Communication
-	private:
-	uint8_t CS;															//Slave Select pin for specification. The code will only run on the default SPI pins.
-	uint16_t data[25];													//Data arrays
-	unsigned int CalcCRC(unsigned char data[], unsigned char nbrOfBytes);//Checksum calculator
-	
-	struct R1data{														//R1 data struct
-		uint16_t bins[16];
-		uint8_t bin1time, bin2time, bin3time, bin4time;
-		float sampleFlowRate; 
-		uint16_t temp, humid;
-		float samplePeriod;
-		uint8_t rejectCountGlitch, rejectCountLong;
-		float pm1, pm2_5, pm10;
-		unsigned int checksum;
-	} localData;
-	
-	public:
-	R1(uint8_t slave);													//Alphasense constructor
-	void powerOn();														//Power on will activate the fan, laser, and data communication
-	void powerOff();													//Power off will deactivate these same things
-	void initOPC();														//Initializes the OPC
-	String CSVHeader();													//Overrrides the OPC data functions
+	virtual void beginInit();											//Start initialization without waiting
+	virtual uint8_t pollInit();											//Move initialization along, returns the OPC_INIT_* state
+	virtual void abortInit();											//Give up on the initialization and let go of the bus
+	uint8_t getInitState();
+	static bool spiBusy();												//An Alphasense handshake holds the SPI bus
+	OPCRetry &getRetry();												//Retry policy, to tune the attempts, backoff, and deadline
+#if OPC_USE_READOUT
+	void setConsole(OPCConsole &out);									//Send .logReadout() through a non-blocking console queue
+#endif
+	uint16_t CSVHeader(char *buf, uint16_t len);						//Placeholders
+	uint16_t logLine(char *buf, uint16_t len);
+#if OPC_USE_READOUT
+	uint16_t logReadout(const char *name, char *buf, uint16_t len);
+#endif
+	uint16_t logBinary(uint8_t *buf, uint16_t len);
+#ifndef OPC_STATIC_RAM
+	String CSVHeader();
 	String logUpdate();
+#if OPC_USE_READOUT
 	String logReadout(String name);
-	bool readData();												
+#endif
+#endif
+	virtual uint8_t getData(float *data, uint8_t len);					//Copies the size distribution into a float array
+	virtual uint8_t getBins();											//Values .getData() gives for a full sample
+	virtual float getSampleVolume();									//Air behind the counts of the last sample (cm^3), or 0 if the flow is not reported
+	virtual float getSamplePeriod();									//Time the last sample counted over (s), or 0 if it is not reported
+	bool getNewData(float *data, uint8_t len, uint64_t &lastSample);	//.getData() for a sample newer than lastSample from an awake, warm sensor with all len values
+	static uint16_t packHeader(uint8_t type, uint32_t hits, uint32_t flags, uint16_t dataLen, uint8_t *buf, uint16_t len);	//Record header for dataLen bytes. Returns its length, or 0 if the record does not fit
+	virtual bool readData();
+	virtual void requestData();											//Send a read request without waiting for the answer
+	virtual uint8_t collectData();										//Take the answer if it has arrived, returns the OPC_COLLECT_* state
+	virtual void powerOn();
+	virtual void powerOnPump();											//Power on for use with an external pump, same as power on by default
+	virtual void powerOff();
+	void setReset(unsigned long resetTimer);							//Manually set the bad log reset timer
+	void sleep();														//Power off and stop reading until .wake()
+	void wake(unsigned long warmup, bool pump = false);					//Power on, and flag samples until the warm-up (ms) is over
+	bool isAsleep();
+	bool warmingUp();													//True while samples are still in the warm-up
+	void setHandler(OPCEventHandler eventHandler, void *context = NULL, uint8_t mask = OPC_EVENT_ALL);	//Handler for the events of the sensor (OPCEvent.h)
+	void setThreshold(uint8_t bin, float level, float hysteresis = 0);	//Raise an event when a bin crosses the level, OPC_THRESHOLD_OFF to stop
+	virtual void trigger(uint8_t source, float value);					//An outside value, such as the altitude, for the sensor and the handler
+	void setStaleLimit(uint16_t limit);									//Repeats of the same frame before it is thrown out, 0 to keep every frame
+	uint32_t getFrameFlags();											//OPC_FLAG_STALE and the quality bits of the last frame
+	uint32_t getStaleFrames();											//Frames thrown out as stale
+	uint32_t getSuspectFrames();										//Frames with a quality bit, which were kept
 };
 
 
 
-class HPM: public OPC{
-	private:
-	bool autoSend;														//Auto send data state
-	bool command(byte cmd, byte chk);									//Command base
-	
-	public:	
-	struct HPMdata{
-		uint16_t PM1_0, PM2_5, PM4_0, PM10_0, checksum, checksumR;		//Data structure
-	}localData;
-	
-	HPM(Stream* ser);												
-	void powerOn();														//Power on will start the measurement system
-	void powerOff();													//Power off will stop measurements
-	void autoSendOn();													//Will automatically send data
-	void autoSendOff();													//Will wait for data requests (recommended)
-	void initOPC();														//Initialize the system
-	String CSVHeader();													//Header in CSV format
-	String logUpdate();													//Update data in CSV string
-	bool readData();													//Read incoming data
-};
-
-class N3: public OPC {													//The R1 runs on SPI Communication
-	private:
-	uint8_t CS;															//Slave Select pin for specification. The code will only run on the default SPI pins.
-	bool initCommand(byte command);
-	unsigned int CalcCRC(unsigned char data[], unsigned char nbrOfBytes);//Checksum calculator
-	
-	public:
-	struct N3data{														//N3 Public data struct
-		uint16_t bins[24];
-		uint8_t bin1time, bin2time, bin3time, bin4time;
-		uint16_t samplePeriod, sampleFlowRate, temp, humid;
-		float pm1, pm2_5, pm10;
-		uint16_t rejectCountGlitch, rejectCountLong, rejectCountRatio, rejectCountRange, fanRevCount, laserStatus, checkSum;
-	} localData;
-	
-	N3(uint8_t slave);													//Alphasense constructor
-	void laserOn();														//Laser on command
-	void fanOn();														//Fan on command
-	void laserOff();													//Laser off command
-	void fanOff();														//fan off command
-	void powerOn();														//Power on will activate the fan, laser, and data communication
-	void powerOnPump();													//Power on for use with an external pump
-	void powerOff();													//Power off will deactivate these same things
-	void initOPC(char t);												//Initializes the OPC
-	String CSVHeader();													//Overrrides the OPC data functions
-	String logUpdate();	
-	String logReadout(String name);												
-	bool readData();												
-};
+#if OPC_USE_PLANTOWER													//Sensors, as selected in OPCConfig.h
+#include "OPCPlantower.h"
+#endif
+#if OPC_USE_SPS
+#include "OPCSPS.h"
+#endif
+#if OPC_USE_R1
+#include "OPCR1.h"
+#endif
+#if OPC_USE_HPM
+#include "OPCHPM.h"
+#endif
+#if OPC_USE_N3
+#include "OPCN3.h"
+#endif
 
 #endif
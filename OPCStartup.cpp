@@ -0,0 +1,94 @@
+//Optical Particle Counter Library
+
+//University of Minnesota - Candler MURI
+
+/*This is the definitions file for the parallel startup manager.
+See OPCStartup.h for the details.*/
+
+#include "OPCStartup.h"
+
+
+
+//////////STARTUP//////////
+
+
+
+OPCStartup::OPCStartup(){
+	nSensors = 0;
+	startTime = 0;
+	startupTime = 0;
+	timeout = 30000;
+	done = true;
+}
+
+bool OPCStartup::addSensor(OPC &sensor){
+	if (nSensors >= OPC_STARTUP_MAX_SENSORS) return false;				//No room for another sensor
+
+	StartupSensor &entry = sensors[nSensors++];
+	entry.sensor = &sensor;
+	entry.state = OPC_INIT_BUSY;
+	entry.readyTime = 0;
+	return true;
+}
+
+void OPCStartup::begin(unsigned long limit){							//Each sensor only sends its first command here, so this returns right away
+	timeout = limit;
+	done = false;
+	startupTime = 0;
+	startTime = millis();
+	for (uint8_t i = 0; i < nSensors; i++){
+		sensors[i].sensor->beginInit();
+		sensors[i].state = sensors[i].sensor->getInitState();
+		sensors[i].readyTime = millis() - startTime;
+	}
+}
+
+bool OPCStartup::update(){
+	if (done) return true;
+
+	bool busy = false;
+	for (uint8_t i = 0; i < nSensors; i++){
+		StartupSensor &entry = sensors[i];
+		if (entry.state != OPC_INIT_BUSY) continue;
+
+		entry.state = entry.sensor->pollInit();
+		entry.readyTime = millis() - startTime;
+		if ((entry.state == OPC_INIT_BUSY) && (entry.readyTime >= timeout)){	//Took too long, so the sensor closes any handshake
+			entry.sensor->abortInit();									//it has open and lets go of the bus
+			entry.state = OPC_INIT_FAILED;
+		}
+		if (entry.state == OPC_INIT_BUSY) busy = true;
+	}
+
+	if (!busy){
+		done = true;
+		startupTime = millis() - startTime;
+	}
+	return done;
+}
+
+bool OPCStartup::run(unsigned long limit){								//Blocking version, for use in setup()
+	begin(limit);
+	while (!update()) {}
+	return (getReady() == nSensors);
+}
+
+uint8_t OPCStartup::getState(uint8_t index){
+	if (index >= nSensors) return OPC_INIT_FAILED;
+	return sensors[index].state;
+}
+
+unsigned long OPCStartup::getReadyTime(uint8_t index){
+	if (index >= nSensors) return 0;
+	return sensors[index].readyTime;
+}
+
+unsigned long OPCStartup::getStartupTime(){ return startupTime; }
+
+uint8_t OPCStartup::getReady(){
+	uint8_t ready = 0;
+	for (uint8_t i = 0; i < nSensors; i++){
+		if (sensors[i].state == OPC_INIT_READY) ready++;
+	}
+	return ready;
+}
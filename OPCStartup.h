@@ -0,0 +1,58 @@
+//Optical Particle Counter Library
+
+//University of Minnesota - Candler MURI
+
+/*This is the header file for the parallel startup manager.
+Each .initOPC() waits out fixed delays while the sensor boots, so bringing up
+several sensors one after another takes the sum of all those delays. An
+OPCStartup object starts every sensor with .beginInit(), then polls each one
+with .pollInit() until it answers. The sensors come up side by side, so the
+whole startup takes about as long as the slowest sensor.
+
+The R1 and N3 keep slave select low between polls of a handshake, so they
+take turns with the SPI bus: one waits while the other has it. A sensor that
+runs out of time is told to give up with .abortInit(), which closes its
+handshake and frees the bus.
+
+The time each sensor took to become ready is kept, so slow or failing
+sensors can be spotted in the logs.
+*/
+
+
+#ifndef OPCStartup_h
+#define OPCStartup_h
+
+#include "OPCSensor.h"
+
+#define OPC_STARTUP_MAX_SENSORS 8										//Most sensors in one startup
+
+
+
+class OPCStartup
+{
+	private:
+	struct StartupSensor{
+		OPC *sensor;
+		uint8_t state;													//OPC_INIT_* state
+		unsigned long readyTime;										//Time from the start to ready or failed (ms)
+	} sensors[OPC_STARTUP_MAX_SENSORS];
+
+	uint8_t nSensors;
+	unsigned long startTime;											//Time .begin() was called
+	unsigned long startupTime;											//Time from the start until every sensor was done (ms)
+	unsigned long timeout;
+	bool done;
+
+	public:
+	OPCStartup();
+	bool addSensor(OPC &sensor);
+	void begin(unsigned long limit = 30000);							//Start every sensor, giving up on any not ready within the limit (ms)
+	bool update();														//Poll the sensors, true once every sensor is ready or failed. Call from the loop.
+	bool run(unsigned long limit = 30000);								//Start and poll until done, true if every sensor is ready
+	uint8_t getState(uint8_t index);									//OPC_INIT_* state of a sensor
+	unsigned long getReadyTime(uint8_t index);							//Time the sensor took to become ready (ms)
+	unsigned long getStartupTime();										//Time until every sensor was done (ms)
+	uint8_t getReady();													//Number of sensors that are ready
+};
+
+#endif
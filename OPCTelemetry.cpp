@@ -0,0 +1,319 @@
+//Optical Particle Counter Library
+
+//University of Minnesota - Candler MURI
+
+/*This is the definitions file for the telemetry packer.
+The packet helpers and the unpacker come first, and build anywhere. The packer
+itself needs the sensors, so it is only built for Arduino. See OPCTelemetry.h
+for the packet layout.*/
+
+#include "OPCTelemetry.h"
+#include <math.h>
+#include <string.h>
+
+
+
+//////////PACKET FORMAT//////////
+
+
+
+static uint16_t getU16(const uint8_t *buf){ return buf[0] | ((uint16_t)buf[1] << 8); }
+
+static uint32_t getU32(const uint8_t *buf){
+	uint32_t value = 0;
+	for (uint8_t i = 0; i < 4; i++) value |= (uint32_t)buf[i] << (8*i);
+	return value;
+}
+
+uint16_t opcToHalf(float value){										//Rounds to nearest, and clamps to the largest half instead of infinity
+	uint16_t sign = 0;
+	if (value < 0){
+		sign = 0x8000;
+		value = -value;
+	}
+	if (value != value) return 0x7E00;									//NaN
+	if (value >= 65504) return sign | 0x7BFF;
+	if (value < 5.9604645e-8) return sign;								//Below the smallest half
+
+	int exponent;
+	float mantissa = frexp(value, &exponent);							//value = mantissa*2^exponent, mantissa in [.5, 1)
+	if (exponent < -13){												//Subnormal, in steps of 2^-24
+		return sign | (uint16_t)lround(ldexp(value, 24));
+	}
+	uint16_t bits = (uint16_t)lround(ldexp(mantissa, 11));				//11 bits, with the leading one
+	if (bits == 2048){													//Rounded up to the next power of two
+		bits = 1024;
+		exponent++;
+	}
+	return sign | ((uint16_t)(exponent + 14) << 10) | (bits - 1024);
+}
+
+float opcFromHalf(uint16_t half){
+	float sign = (half & 0x8000) ? -1 : 1;
+	int exponent = (half >> 10) & 0x1F;
+	int mantissa = half & 0x3FF;
+	if (exponent == 0) return sign*ldexp((float)mantissa, -24);
+	if (exponent == 31) return mantissa ? NAN : sign*INFINITY;
+	return sign*ldexp((float)(mantissa + 1024), exponent - 25);
+}
+
+bool opcUnpack(const uint8_t *buf, uint16_t len, OPCTelemetryPacket &packet){
+	if (len < OPC_TELEMETRY_MIN || len > OPC_TELEMETRY_MAX) return false;
+	if (buf[0] != OPC_TELEMETRY_SYNC || buf[1] != OPC_TELEMETRY_VERSION) return false;
+	if (getU16(&buf[len - 2]) != opcCRC16(buf, len - 2)) return false;
+
+	packet.sequence = getU16(&buf[2]);
+	packet.time = getU32(&buf[4]);
+	packet.nFields = buf[8];
+	packet.left = buf[9];
+	if (packet.nFields > OPC_TELEMETRY_MAX_FIELDS) return false;
+
+	uint16_t at = OPC_TELEMETRY_HEADER;
+	for (uint8_t i = 0; i < packet.nFields; i++){
+		if (at + OPC_FIELD_HEADER > len - 2) return false;
+		OPCTelemetryField &field = packet.fields[i];
+		memset(&field, 0, sizeof(field));
+		field.sensor = buf[at] >> 4;
+		field.kind = buf[at] & 0x0F;
+		field.type = buf[at + 1];
+		uint8_t payload = buf[at + 2];
+		const uint8_t *data = &buf[at + OPC_FIELD_HEADER];
+		at += OPC_FIELD_HEADER + payload;
+		if (at > len - 2) return false;									//Runs into the CRC
+
+		if (field.kind == OPC_FIELD_HEALTH){
+			if (payload != 10) return false;
+			field.hits = getU32(&data[0]);
+			field.giveUps = getU16(&data[4]);
+			field.sampleAge = getU16(&data[6]);
+			field.initState = data[8];
+			field.status = data[9];
+		} else if (field.kind == OPC_FIELD_SAMPLE || field.kind == OPC_FIELD_HISTOGRAM){
+			if (payload < 3 || (payload - 3) % 2 || (payload - 3)/2 > OPC_MAX_BINS) return false;
+			field.merge = data[0];
+			field.count = getU16(&data[1]);
+			field.nValues = (payload - 3)/2;
+			for (uint8_t j = 0; j < field.nValues; j++) field.values[j] = opcFromHalf(getU16(&data[3 + j*2]));
+		} else return false;											//Unknown kind
+	}
+	return true;
+}
+
+
+
+//////////PACKER//////////
+
+
+
+#ifdef ARDUINO
+static void putU16(uint8_t *buf, uint16_t value){
+	buf[0] = value & 0xFF;
+	buf[1] = value >> 8;
+}
+
+static void putU32(uint8_t *buf, uint32_t value){
+	for (uint8_t i = 0; i < 4; i++) buf[i] = (value >> (8*i)) & 0xFF;
+}
+
+OPCTelemetry::OPCTelemetry(uint16_t packetSize){
+	if (packetSize < OPC_TELEMETRY_MIN) packetSize = OPC_TELEMETRY_MIN;
+	if (packetSize > OPC_TELEMETRY_MAX) packetSize = OPC_TELEMETRY_MAX;
+	size = packetSize;
+	nSensors = 0;
+	nFields = 0;
+	sequence = 0;
+}
+
+int8_t OPCTelemetry::addSensor(OPC &sensor, uint8_t type){
+	if (nSensors >= OPC_TELEMETRY_MAX_SENSORS) return -1;				//No room for another sensor
+	sensors[nSensors].sensor = &sensor;
+	sensors[nSensors].type = type;
+	sensors[nSensors].lastSample = sensor.getSampleTime();				//Only samples from now on are averaged
+	return nSensors++;
+}
+
+bool OPCTelemetry::addField(uint8_t sensor, uint8_t kind, uint8_t priority, uint8_t rule, uint8_t maxValues, uint8_t minValues){
+	if (nFields >= OPC_TELEMETRY_MAX_FIELDS || sensor >= nSensors || kind > OPC_FIELD_HEALTH) return false;
+	if (maxValues > OPC_MAX_BINS) maxValues = OPC_MAX_BINS;
+	if (minValues < 1) minValues = 1;
+
+	TelemetryField &field = fields[nFields++];
+	field.sensor = sensor;
+	field.kind = kind;
+	field.priority = priority;
+	field.rule = (kind == OPC_FIELD_HEALTH) ? OPC_TRUNC_NONE : rule;	//The health counters are never cut
+	field.maxValues = maxValues;
+	field.minValues = minValues;
+	field.missed = 0;
+	field.count = 0;
+	field.nValues = 0;
+	memset(field.sums, 0, sizeof(field.sums));
+	field.sent = 0;
+	field.truncated = 0;
+	field.dropped = 0;
+	return true;
+}
+
+void OPCTelemetry::update(){
+	for (uint8_t i = 0; i < nSensors; i++){
+		TelemetrySensor &entry = sensors[i];
+		uint64_t sampleTime = entry.sensor->getSampleTime();
+		if (sampleTime == entry.lastSample) continue;					//No new sample
+		entry.lastSample = sampleTime;
+		if (entry.sensor->warmingUp()) continue;
+
+		float data[OPC_MAX_BINS];
+		uint8_t len = entry.sensor->getData(data, OPC_MAX_BINS);
+		if (!len) continue;												//PM-only reads have no bins
+		for (uint8_t j = 0; j < nFields; j++){
+			TelemetryField &field = fields[j];
+			if (field.sensor != i || field.kind != OPC_FIELD_HISTOGRAM || field.count == 0xFFFF) continue;
+			for (uint8_t k = 0; k < len; k++) field.sums[k] += data[k];
+			field.nValues = len;
+			field.count++;
+		}
+	}
+}
+
+uint8_t OPCTelemetry::fitValues(TelemetryField &field, uint8_t nValues, uint16_t space, uint8_t &merge){
+	merge = 0;
+	uint16_t fixed = OPC_FIELD_HEADER + 3;								//Field header, merge level, and count
+	if (space < fixed) return 0;
+	uint16_t room = (space - fixed)/2;									//Values that fit
+	if (nValues <= room) return nValues;
+	if (field.rule == OPC_TRUNC_TAIL && room >= field.minValues) return room;
+	if (field.rule == OPC_TRUNC_MERGE){
+		for (merge = 1; merge < 8; merge++){
+			uint8_t merged = (nValues + (1 << merge) - 1) >> merge;		//Rounded up, the last one may hold fewer
+			if (merged < field.minValues) break;
+			if (merged <= room) return merged;
+			if (merged == 1) break;
+		}
+	}
+	merge = 0;
+	return 0;
+}
+
+uint16_t OPCTelemetry::writeField(TelemetryField &field, uint8_t *buf, uint16_t space){
+	OPC *sensor = sensors[field.sensor].sensor;
+	if (space < OPC_FIELD_HEADER + 3) return 0;							//Not even an empty field fits
+	buf[0] = (field.sensor << 4) | field.kind;
+	buf[1] = sensors[field.sensor].type;
+	uint8_t *data = &buf[OPC_FIELD_HEADER];
+
+	if (field.kind == OPC_FIELD_HEALTH){
+		if (space < OPC_FIELD_HEADER + 10) return 0;
+		unsigned long age = sensor->getSampleTime() ? sensor->getSampleAge()/1000 : 0xFFFF;
+		uint32_t giveUps = sensor->getRetry().getGiveUps();
+		uint8_t status = 0;
+		if (sensor->getLogQuality()) status |= OPC_HEALTH_QUALITY;
+		if (sensor->isAsleep()) status |= OPC_HEALTH_ASLEEP;
+		if (sensor->warmingUp()) status |= OPC_HEALTH_WARMUP;
+		if (sensor->getFrameFlags() & OPC_FLAG_STALE) status |= OPC_HEALTH_STALE;
+		if (sensor->getFrameFlags() & OPC_FLAG_SUSPECT) status |= OPC_HEALTH_SUSPECT;
+		putU32(&data[0], sensor->getTot());
+		putU16(&data[4], (giveUps > 0xFFFF) ? 0xFFFF : giveUps);
+		putU16(&data[6], (age > 0xFFFF) ? 0xFFFF : age);
+		data[8] = sensor->getInitState();
+		data[9] = status;
+		buf[2] = 10;
+		return OPC_FIELD_HEADER + 10;
+	}
+
+	float values[OPC_MAX_BINS];
+	uint8_t nValues;
+	uint16_t count;
+	if (field.kind == OPC_FIELD_SAMPLE){
+		nValues = sensor->getData(values, OPC_MAX_BINS);
+		unsigned long age = sensor->getSampleAge();
+		count = (age > 0xFFFF) ? 0xFFFF : age;
+	} else {
+		nValues = field.nValues;
+		for (uint8_t i = 0; i < nValues; i++) values[i] = field.sums[i]/field.count;
+		count = field.count;
+	}
+	if (nValues > field.maxValues) nValues = field.maxValues;
+
+	uint8_t merge;
+	uint8_t fit = fitValues(field, nValues, space, merge);
+	if (!fit && nValues) return 0;										//Too big, even cut down
+	if (fit < nValues) field.truncated++;
+	for (uint8_t i = 0; i < fit; i++){
+		float value = 0;
+		for (uint8_t j = i << merge; j < ((i + 1) << merge) && j < nValues; j++) value += values[j];	//Neighbours added together
+		putU16(&data[3 + i*2], opcToHalf(value));
+	}
+	data[0] = merge;
+	putU16(&data[1], count);
+	buf[2] = 3 + fit*2;
+	return OPC_FIELD_HEADER + 3 + fit*2;
+}
+
+uint16_t OPCTelemetry::pack(uint8_t *buf){
+	memset(buf, 0, size);
+	buf[0] = OPC_TELEMETRY_SYNC;
+	buf[1] = OPC_TELEMETRY_VERSION;
+	putU16(&buf[2], sequence++);
+	putU32(&buf[4], millis());
+
+	uint8_t order[OPC_TELEMETRY_MAX_FIELDS];							//Fields by priority, less the packets each has missed
+	for (uint8_t i = 0; i < nFields; i++){
+		uint8_t j = i;
+		int rank = (int)fields[i].priority - fields[i].missed;
+		while (j > 0 && (int)fields[order[j - 1]].priority - fields[order[j - 1]].missed > rank){
+			order[j] = order[j - 1];
+			j--;
+		}
+		order[j] = i;
+	}
+
+	uint16_t at = OPC_TELEMETRY_HEADER;
+	uint8_t placed = 0, left = 0;
+	for (uint8_t i = 0; i < nFields; i++){
+		TelemetryField &field = fields[order[i]];
+		if (field.kind == OPC_FIELD_SAMPLE && !sensors[field.sensor].sensor->getSampleTime()) continue;	//Nothing to send yet
+		if (field.kind == OPC_FIELD_HISTOGRAM && !field.count) continue;
+
+		uint16_t written = writeField(field, &buf[at], size - 2 - at);
+		if (!written){
+			memset(&buf[at], 0, size - 2 - at);							//Undo the field header
+			field.dropped++;
+			if (field.missed < 0xFF) field.missed++;
+			left++;
+			continue;
+		}
+		at += written;
+		placed++;
+		field.sent++;
+		field.missed = 0;
+		if (field.kind == OPC_FIELD_HISTOGRAM){							//Start the next average
+			field.count = 0;
+			memset(field.sums, 0, sizeof(field.sums));
+		}
+	}
+
+	buf[8] = placed;
+	buf[9] = left;
+	putU16(&buf[size - 2], opcCRC16(buf, size - 2));
+	return size;
+}
+
+uint16_t OPCTelemetry::getSize(){ return size; }
+
+uint16_t OPCTelemetry::getSequence(){ return sequence; }
+
+uint32_t OPCTelemetry::getSent(uint8_t field){
+	if (field >= nFields) return 0;
+	return fields[field].sent;
+}
+
+uint32_t OPCTelemetry::getTruncated(uint8_t field){
+	if (field >= nFields) return 0;
+	return fields[field].truncated;
+}
+
+uint32_t OPCTelemetry::getDropped(uint8_t field){
+	if (field >= nFields) return 0;
+	return fields[field].dropped;
+}
+#endif
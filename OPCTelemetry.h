@@ -0,0 +1,146 @@
+//Optical Particle Counter Library
+
+//University of Minnesota - Candler MURI
+
+/*This is the header file for the telemetry packer.
+The radio and satellite links send fixed-size packets, often only 50 to 340
+bytes, so the CSV lines from .logUpdate() do not fit. An OPCTelemetry object
+packs the latest samples, health counters, and averaged histograms of several
+sensors into one packet of a set size.
+
+Each field has a priority. The fields are placed from the highest priority
+(0) down, and a field that does not fit whole is cut down by its rule:
+ - OPC_TRUNC_NONE: the field is sent whole or left out
+ - OPC_TRUNC_TAIL: values are dropped from the end, down to the fewest allowed
+ - OPC_TRUNC_MERGE: neighbouring values are added together in pairs, as many
+   times as it takes, down to the fewest allowed. Use this for histograms.
+A field that is left out moves up one priority step for each packet it
+misses, so a low priority field still gets through now and then. Histograms
+keep averaging until they are sent.
+
+Each packet has a sync byte, a sequence number, the time, and a CRC-16 at the
+end, and is padded to its full size. Values are sent as 16 bit floats, which
+hold about three digits.
+
+Packet layout, little endian:
+ - sync (OPC_TELEMETRY_SYNC), version, sequence (2), time in ms (4), fields,
+   fields left out
+ - each field: sensor and kind (sensor index << 4 | OPC_FIELD_*), sensor type,
+   payload length, payload
+ - padding, then the CRC-16/CCITT of every byte before it
+
+The packet format, the CRC, and the unpacker (opcUnpack()) have no Arduino
+dependencies, so the same code reads the packets on the ground.
+*/
+
+
+#ifndef OPCTelemetry_h
+#define OPCTelemetry_h
+
+#include <stdint.h>
+#include "OPCBins.h"
+#ifdef ARDUINO
+#include "OPCSensor.h"
+#endif
+
+#define OPC_TELEMETRY_SYNC 0xC3											//First byte of every packet
+#define OPC_TELEMETRY_VERSION 1
+#define OPC_TELEMETRY_HEADER 10											//Bytes before the first field
+#define OPC_TELEMETRY_MIN 16											//Smallest packet
+#define OPC_TELEMETRY_MAX 340											//Largest packet
+#define OPC_TELEMETRY_MAX_SENSORS 8
+#define OPC_TELEMETRY_MAX_FIELDS 16
+#define OPC_FIELD_HEADER 3												//Bytes before the payload of a field
+
+#define OPC_FIELD_SAMPLE 0												//Field kinds: latest values of .getData()
+#define OPC_FIELD_HISTOGRAM 1											//Average of .getData() since the field was last sent
+#define OPC_FIELD_HEALTH 2												//Hits, quality, sample age, and retry counters
+
+#define OPC_TRUNC_NONE 0												//Truncation rules
+#define OPC_TRUNC_TAIL 1
+#define OPC_TRUNC_MERGE 2
+
+#define OPC_HEALTH_QUALITY 0x01											//Health status bits
+#define OPC_HEALTH_ASLEEP 0x02
+#define OPC_HEALTH_WARMUP 0x04
+#define OPC_HEALTH_STALE 0x08											//The last frame repeated past the stale limit
+#define OPC_HEALTH_SUSPECT 0x10											//The last frame failed a plausibility check
+
+uint16_t opcToHalf(float value);										//16 bit float
+float opcFromHalf(uint16_t half);
+
+struct OPCTelemetryField{												//One unpacked field
+	uint8_t sensor;														//Index of the sensor in the packer
+	uint8_t kind;														//OPC_FIELD_*
+	uint8_t type;														//Sensor type (OPC_TYPE_*)
+	uint8_t merge;														//Each value is the sum of 2^merge reported values
+	uint8_t nValues;
+	uint16_t count;														//Sample age (ms, capped) for a sample, samples averaged for a histogram
+	float values[OPC_MAX_BINS];
+	uint32_t hits;														//Health fields only
+	uint16_t giveUps;
+	uint16_t sampleAge;													//Age of the last good sample (s, capped)
+	uint8_t initState;
+	uint8_t status;														//OPC_HEALTH_* bits
+};
+
+struct OPCTelemetryPacket{												//One unpacked packet
+	uint16_t sequence;
+	uint32_t time;														//millis() when it was packed
+	uint8_t nFields;
+	uint8_t left;														//Fields left out of the packet
+	OPCTelemetryField fields[OPC_TELEMETRY_MAX_FIELDS];
+};
+
+bool opcUnpack(const uint8_t *buf, uint16_t len, OPCTelemetryPacket &packet);	//False if the sync, CRC, or layout is bad
+
+
+
+#ifdef ARDUINO
+class OPCTelemetry
+{
+	private:
+	struct TelemetrySensor{
+		OPC *sensor;
+		uint8_t type;
+		uint64_t lastSample;											//Sample time of the last sample added to the histograms (us)
+	} sensors[OPC_TELEMETRY_MAX_SENSORS];
+
+	struct TelemetryField{
+		uint8_t sensor;
+		uint8_t kind;
+		uint8_t priority;												//0 is the highest
+		uint8_t rule;													//OPC_TRUNC_*
+		uint8_t maxValues;												//Values sent when whole
+		uint8_t minValues;												//Fewest values after truncation
+		uint8_t missed;													//Packets missed in a row
+		uint16_t count;													//Samples in the histogram
+		uint8_t nValues;												//Bins in the histogram
+		float sums[OPC_MAX_BINS];										//Histogram sums
+		uint32_t sent;
+		uint32_t truncated;
+		uint32_t dropped;
+	} fields[OPC_TELEMETRY_MAX_FIELDS];
+
+	uint8_t nSensors;
+	uint8_t nFields;
+	uint16_t size;														//Packet size (bytes)
+	uint16_t sequence;
+	uint8_t fitValues(TelemetryField &field, uint8_t nValues, uint16_t space, uint8_t &merge);	//Values that fit in the space, 0 if none
+	uint16_t writeField(TelemetryField &field, uint8_t *buf, uint16_t space);	//Bytes written, 0 if it did not fit
+
+	public:
+	OPCTelemetry(uint16_t packetSize);
+	int8_t addSensor(OPC &sensor, uint8_t type);						//Returns the sensor index, or -1 if full
+	bool addField(uint8_t sensor, uint8_t kind, uint8_t priority, uint8_t rule = OPC_TRUNC_NONE, uint8_t maxValues = OPC_MAX_BINS, uint8_t minValues = 1);
+	void update();														//Add new samples to the histograms. Call from the loop.
+	uint16_t pack(uint8_t *buf);										//Make the next packet. Returns the packet size.
+	uint16_t getSize();
+	uint16_t getSequence();												//Sequence number of the next packet
+	uint32_t getSent(uint8_t field);									//Times each field was sent, cut down, or left out
+	uint32_t getTruncated(uint8_t field);
+	uint32_t getDropped(uint8_t field);
+};
+#endif
+
+#endif
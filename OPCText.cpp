@@ -0,0 +1,157 @@
+//Optical Particle Counter Library
+
+//University of Minnesota - Candler MURI
+
+/*This is the definitions file for the fixed buffer text builder.
+Floats are scaled to whole numbers before they are written. A float times a
+power of ten up to 10^6 is exact in a double, so the rounding is exact as
+well, and ties go to the even digit the same way printf does it.*/
+
+#include "OPCText.h"
+
+
+
+//////////TEXT//////////
+
+
+
+OPCText::OPCText(char *buffer, uint16_t bufferSize){
+	text = buffer;
+	size = bufferSize;
+	clear();
+}
+
+void OPCText::clear(){
+	length = 0;
+	full = (size == 0);
+	if (size) text[0] = '\0';
+}
+
+void OPCText::add(char c){
+	if (length + 1 >= size){											//Leave room for the end of the string
+		full = true;
+		return;
+	}
+	text[length++] = c;
+	text[length] = '\0';
+}
+
+void OPCText::add(const char *part){
+	while (*part && !full) add(*part++);
+}
+
+void OPCText::addFlash(const char *part){
+	for (char c = pgm_read_byte(part); c && !full; c = pgm_read_byte(++part)) add(c);
+}
+
+void OPCText::add(unsigned long value){
+	char digits[11];
+	uint8_t at = sizeof(digits) - 1;
+	digits[at] = '\0';
+	do {
+		digits[--at] = '0' + value%10;
+		value /= 10;
+	} while (value);
+	add(&digits[at]);
+}
+
+void OPCText::addFixed(long value, uint8_t decimals){					//Integer math only: the sign, the whole part, then the decimals
+	unsigned long magnitude = (value < 0) ? -(unsigned long)value : value;
+	unsigned long scale = 1;
+	for (uint8_t i = 0; i < decimals; i++) scale *= 10;
+	
+	if (value < 0) add('-');
+	add(magnitude/scale);
+	if (!decimals) return;
+	add('.');
+	unsigned long fraction = magnitude%scale;
+	for (unsigned long place = scale/10; place > 0; place /= 10){		//Leading zeros of the decimals are kept
+		add((char)('0' + (fraction/place)%10));
+	}
+}
+
+void OPCText::add(float value, uint8_t digits){
+	if (isnan(value)){
+		add("nan");
+		return;
+	}
+	if (isinf(value)){
+		add("inf");
+		return;
+	}
+	double scaled = value;
+	if (scaled < 0){
+		add('-');
+		scaled = -scaled;
+	}
+	uint64_t scale = 1;
+	for (uint8_t i = 0; i < digits; i++) scale *= 10;
+	scaled *= scale;
+	if (scaled >= 1.8e19){												//Too big to scale, as Print does it
+		add("ovf");
+		return;
+	}
+
+	uint64_t whole = (uint64_t)scaled;
+	double rest = scaled - whole;
+	if (rest > 0.5 || (rest == 0.5 && (whole & 1))) whole++;			//Round half to even
+
+	char out[24];
+	uint8_t at = sizeof(out) - 1;
+	out[at] = '\0';
+	for (uint8_t i = 0; i < digits; i++){
+		out[--at] = '0' + whole%10;
+		whole /= 10;
+	}
+	if (digits) out[--at] = '.';
+	do {
+		out[--at] = '0' + whole%10;
+		whole /= 10;
+	} while (whole);
+	add(&out[at]);
+}
+
+void OPCText::addHex(unsigned long value){
+	char digits[9];
+	uint8_t at = sizeof(digits) - 1;
+	digits[at] = '\0';
+	do {
+		uint8_t digit = value & 0x0F;
+		digits[--at] = (digit < 10) ? ('0' + digit) : ('A' + digit - 10);
+		value >>= 4;
+	} while (value);
+	add(&digits[at]);
+}
+
+void OPCText::line(){ add("\r\n"); }
+
+void OPCText::line(const char *label){
+	addFlash(label);
+	line();
+}
+
+void OPCText::line(const char *label, unsigned long value){
+	addFlash(label);
+	add(value);
+	line();
+}
+
+void OPCText::line(const char *label, float value, uint8_t digits){
+	addFlash(label);
+	add(value, digits);
+	line();
+}
+
+const char *OPCText::c_str(){ return text; }
+
+uint16_t OPCText::getLength(){ return length; }
+
+bool OPCText::isFull(){ return full; }
+
+
+
+//////////READOUT//////////
+
+
+
+OPCReadout::OPCReadout() : OPCText(buffer, OPC_READOUT_SIZE){}
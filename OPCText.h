@@ -0,0 +1,69 @@
+//Optical Particle Counter Library
+
+//University of Minnesota - Candler MURI
+
+/*This is the header file for the fixed buffer text builder.
+The CSV lines, headers, and readouts of the sensors are built with OPCText
+instead of String, so they never touch the heap. An OPCText writes into a
+buffer it is given, and stops at the end of it: anything that does not fit
+is cut off, and .isFull() says so.
+
+Constant text, such as the CSV headers and the readout labels, is kept in
+program memory (PROGMEM and PSTR()) and added with .addFlash(), so it stays
+out of RAM on boards that copy constants into RAM. On the Teensy, constants
+are read from flash anyway, and both work the same.
+
+Numbers are written the way Print and String write them: floats are
+rounded to the digits asked for, and hex is in capitals.
+*/
+
+
+#ifndef OPCText_h
+#define OPCText_h
+
+#include <arduino.h>
+
+#define OPC_READOUT_SIZE 640											//Longest readout, the N3 histogram is about 500
+#define OPC_LINE_SIZE 400												//Longest CSV line or header of a sensor, the N3 header is about 330
+
+
+
+class OPCText
+{
+	private:
+	char *text;
+	uint16_t size;														//Buffer size, with the end of the string
+	uint16_t length;
+	bool full;															//Something did not fit and was cut off
+
+	public:
+	OPCText(char *buffer, uint16_t bufferSize);
+	void add(char c);
+	void add(const char *part);											//Text in RAM
+	void addFlash(const char *part);									//Text in program memory
+	void add(unsigned long value);
+	void add(float value, uint8_t digits);
+	void addFixed(long value, uint8_t decimals);						//Fixed point, such as centi-degrees with 2 decimals
+	void addHex(unsigned long value);
+	void line();														//End the line
+	void line(const char *label);										//A line of text in program memory
+	void line(const char *label, unsigned long value);					//A label in program memory, a value, and the end of the line
+	void line(const char *label, float value, uint8_t digits);
+	void clear();
+	const char *c_str();
+	uint16_t getLength();
+	bool isFull();
+};
+
+
+
+class OPCReadout: public OPCText										//An OPCText with its own buffer, for a readout
+{
+	private:
+	char buffer[OPC_READOUT_SIZE];
+
+	public:
+	OPCReadout();
+};
+
+#endif
@@ -0,0 +1,607 @@
+//Optical Particle Counter Library
+
+//University of Minnesota - Candler MURI
+
+/*This is the flight log decoder. It turns a CSV log (from .logUpdate()) or a
+binary log (from .logBinary()) into a columnar file, with one contiguous
+array for each field, which numpy, MATLAB, or a plotting tool can load
+without parsing any text.
+
+The input is memory mapped and split into chunks, and the chunks are decoded
+on all cores. Each log is read twice: the first pass counts the rows in each
+chunk, which gives every chunk the place of its rows in the output, and the
+second pass decodes the rows straight into the memory mapped output file.
+ - CSV: a chunk owns the lines that start in it. The first line is the
+   header, and gives the column names. Lines that do not start with a number
+   (blank padding, repeated headers) are skipped. Every column is a double,
+   with NaN for "-". The flags columns are read as hex.
+ - Binary: records are found by their sync byte, type, and length, the same
+   way after padding or damage as at the start of the file. A chunk starts
+   at the first record it finds, and if that is not where the chunk before
+   it ended up, the chunk is counted again from there. Each record type gets
+   its own table, with the hits, logTime, and flags of the header, then the
+   fields of its schema (OPCSchema.h) in their own types. A bad log has 0 or
+   NaN in its data fields, and no OPC_FLAG_GOOD in its flags. Derived,
+   rebinned, normalized, and fused records have no schema, so their tables
+   only have the header fields. Sensor records from a board with another
+   struct layout (the top byte of the flags, OPCRecord.h) would be read at
+   the wrong offsets, so they are passed over and counted instead.
+A journal image has to go through extras/journal/opcrecover.cpp first.
+
+Output layout, little endian:
+ - "OPCCOL01", number of tables (4 bytes), 0 (4)
+ - for each table: name length (1), name, columns (4), rows (8)
+   - for each column: name length (1), name, type (OPC_SCHEMA_*, 1), offset of the array in the file (8)
+ - the arrays, each on an 8 byte boundary
+
+Build on a computer from the library folder:
+	g++ -O2 -pthread -I. extras/decoder/opcdecode.cpp OPCSchema.cpp -o opcdecode
+
+Usage: opcdecode [-t threads] [-b] log output.col
+ - threads: threads to decode with (default: all cores)
+ - -b: benchmark, decoding with 1, 2, 4, ... threads up to the limit
+*/
+
+#include "OPCSchema.h"
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define HEADER_BYTES 16													//sizeof(OPCRecordHeader)
+#define VARIABLE_MAX 512												//Longest record data without a schema
+#define CHUNK_MIN (1UL << 20)											//Smallest chunk worth a thread
+
+struct Column{
+	std::string name;
+	uint8_t type;														//OPC_SCHEMA_*
+	uint16_t source;													//Binary: bytes from the start of the record
+	bool flags;															//CSV: read as hex
+	uint8_t *out;														//Array in the output file
+};
+
+struct Table{
+	std::string name;
+	std::vector<Column> columns;
+	uint64_t rows;
+};
+
+struct Chunk{
+	uint64_t start, end;												//Rows that start in here belong to the chunk
+	uint64_t first;														//Binary: first record found
+	uint64_t handoff;													//Binary: first record past the end
+	uint64_t rows[256];													//Rows of each record type (CSV: rows[0])
+	uint64_t base[256];													//Row of the first one in the output
+	uint64_t skipped;													//Binary: bytes, CSV: lines
+	uint64_t foreign;													//Binary: sensor records with another struct layout
+};
+
+static const uint8_t *data;												//The mapped log
+static uint64_t len;
+static bool binary;
+static uint64_t body;													//CSV: where the rows start, after the header
+static std::vector<Column> csvColumns;
+
+template <typename F> static void parallelFor(unsigned items, unsigned threads, F work){	//Threads take the next item until there are none
+	std::atomic<unsigned> next(0);
+	auto worker = [&](){
+		for (unsigned i = next++; i < items; i = next++) work(i);
+	};
+	std::vector<std::thread> pool;
+	for (unsigned t = 1; t < threads && t < items; t++) pool.push_back(std::thread(worker));
+	worker();
+	for (size_t t = 0; t < pool.size(); t++) pool[t].join();
+}
+
+static void fillMissing(uint8_t *out, uint8_t type){					//NaN for floats, 0 for integers
+	if (type == OPC_SCHEMA_F32){
+		float nan = NAN;
+		memcpy(out, &nan, 4);
+	} else if (type == OPC_SCHEMA_F64){
+		double nan = NAN;
+		memcpy(out, &nan, 8);
+	} else memset(out, 0, opcSchemaSize(type));
+}
+
+
+
+//////////BINARY//////////
+
+
+
+static uint32_t recordLength(uint64_t at){								//Length of the record at this byte, or 0 if there is none
+	if (at + HEADER_BYTES > len || data[at] != OPC_RECORD_SYNC) return 0;
+	uint8_t type = data[at + 1];
+	uint16_t length = data[at + 2] | (data[at + 3] << 8);
+	const OPCSchema *schema = opcSchema(type);
+
+	bool good = (data[at + 12] & OPC_FLAG_GOOD) != 0;
+
+	if (schema){														//A sensor record is a good log with its struct, or a bad log without
+		if ((length != 0 && length != schema->size) || good != (length != 0)) return 0;
+	} else if (type == OPC_TYPE_FUSION){
+		if (length < 8 || length > VARIABLE_MAX) return 0;				//Always has the tick time
+	} else {															//Derived, rebinned, and normalized records carry the type of their sensor
+		uint8_t sensor = type & ~(OPC_TYPE_DERIVED | OPC_TYPE_REBIN | OPC_TYPE_NORMAL);
+		if ((type & (OPC_TYPE_DERIVED | OPC_TYPE_REBIN | OPC_TYPE_NORMAL)) == 0 || (type & OPC_TYPE_FUSION) || !opcSchema(sensor)) return 0;
+		if (length > VARIABLE_MAX || good != (length != 0)) return 0;
+	}
+	if (at + HEADER_BYTES + length > len) return 0;
+	return HEADER_BYTES + length;
+}
+
+static bool foreignLayout(uint64_t at){									//Sensor record with another struct layout, in the top byte of the flags
+	return data[at + 15] != OPC_PACKING_SCHEMA && opcSchema(data[at + 1]);
+}
+
+static uint64_t nextSync(uint64_t at){
+	if (at >= len) return len;
+	const uint8_t *sync = (const uint8_t *)memchr(data + at, OPC_RECORD_SYNC, len - at);
+	return sync ? (uint64_t)(sync - data) : len;
+}
+
+static void countRecords(Chunk &chunk, uint64_t from){					//Pass one: the records that start in the chunk
+	memset(chunk.rows, 0, sizeof(chunk.rows));
+	chunk.first = len;
+	uint64_t at = from;
+	while (at < len){
+		uint32_t total = recordLength(at);
+		if (!total){
+			at = nextSync(at + 1);
+			continue;
+		}
+		if (chunk.first == len) chunk.first = at;
+		if (at >= chunk.end) break;
+		if (!foreignLayout(at)) chunk.rows[data[at + 1]]++;
+		at += total;
+	}
+	chunk.handoff = (at < len) ? at : len;
+}
+
+static void tableFor(Table &table, uint8_t type){						//Header fields, then the schema fields
+	const OPCSchema *schema = opcSchema(type);
+	char name[16];
+	if (schema) table.name = schema->name;
+	else {
+		snprintf(name, sizeof(name), "type0x%02X", type);
+		table.name = name;
+	}
+
+	Column column = {"hits", OPC_SCHEMA_U32, 4, false, NULL};
+	table.columns.push_back(column);
+	column.name = "logTime";
+	column.source = 8;
+	table.columns.push_back(column);
+	column.name = "flags";
+	column.source = 12;
+	table.columns.push_back(column);
+	if (!schema){
+		column.name = "length";
+		column.type = OPC_SCHEMA_U16;
+		column.source = 2;
+		table.columns.push_back(column);
+		return;
+	}
+
+	for (uint8_t f = 0; f < schema->nFields; f++){
+		const OPCSchemaField &field = schema->fields[f];
+		uint8_t size = opcSchemaSize(field.type);
+		for (uint8_t i = 0; i < field.count; i++){
+			column.name = field.name;
+			if (field.count > 1) column.name += std::to_string(i);		//Arrays become one column per value
+			column.type = field.type;
+			column.source = HEADER_BYTES + field.offset + i*size;
+			table.columns.push_back(column);
+		}
+	}
+}
+
+static void decodeRecords(Chunk &chunk, uint64_t from, uint64_t stop, Table **tables){	//Pass two: from the agreed start to the next chunk's
+	uint64_t row[256];
+	memcpy(row, chunk.base, sizeof(row));
+	uint64_t at = from, expected = from;
+	chunk.skipped = 0;
+	chunk.foreign = 0;
+
+	while (at < stop){
+		uint32_t total = recordLength(at);
+		if (!total){
+			at = nextSync(at + 1);
+			continue;
+		}
+		chunk.skipped += at - expected;
+		if (foreignLayout(at)){
+			chunk.foreign++;
+			at += total;
+			expected = at;
+			continue;
+		}
+		const uint8_t *record = data + at;
+		uint8_t type = record[1];
+		std::vector<Column> &columns = tables[type]->columns;
+		uint64_t r = row[type]++;
+
+		for (size_t c = 0; c < columns.size(); c++){
+			Column &column = columns[c];
+			uint8_t size = opcSchemaSize(column.type);
+			if (column.source + size <= total) memcpy(column.out + r*size, record + column.source, size);
+			else fillMissing(column.out + r*size, column.type);		//A bad log has no data
+		}
+		at += total;
+		expected = at;
+	}
+	if (stop > expected) chunk.skipped += stop - expected;
+}
+
+
+
+//////////CSV//////////
+
+
+
+static const double powers[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+static bool isRow(uint8_t c){ return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.'; }
+
+static uint64_t lineEnd(uint64_t at){
+	const uint8_t *newline = (const uint8_t *)memchr(data + at, '\n', len - at);
+	return newline ? (uint64_t)(newline - data) : len;
+}
+
+static double parseValue(const char *&p, const char *end, bool hex){	//One field, leaving p on the comma or the end of the line.
+	double value = NAN;													//Anything that is not a number is NaN.
+	uint64_t mantissa = 0;
+	bool digits = false;
+
+	if (hex){
+		for (; p < end; p++){
+			uint8_t c = *p, d;
+			if (c >= '0' && c <= '9') d = c - '0';
+			else if (c >= 'a' && c <= 'f') d = c - 'a' + 10;
+			else if (c >= 'A' && c <= 'F') d = c - 'A' + 10;
+			else break;
+			mantissa = mantissa*16 + d;
+			digits = true;
+		}
+		if (digits) value = (double)mantissa;
+	} else {
+		bool negative = (p < end && *p == '-');
+		if (p < end && (*p == '-' || *p == '+')) p++;
+		int exponent = 0;
+		for (; p < end && *p >= '0' && *p <= '9'; p++, digits = true){
+			if (mantissa < 100000000000000000ULL) mantissa = mantissa*10 + (*p - '0');
+			else exponent++;											//Digits past 17 are too fine for a double
+		}
+		if (p < end && *p == '.'){
+			for (p++; p < end && *p >= '0' && *p <= '9'; p++, digits = true){
+				if (mantissa < 100000000000000000ULL){
+					mantissa = mantissa*10 + (*p - '0');
+					exponent--;
+				}
+			}
+		}
+		if (digits && p < end && (*p == 'e' || *p == 'E')){
+			p++;
+			bool negativeExp = (p < end && *p == '-');
+			if (p < end && (*p == '-' || *p == '+')) p++;
+			int e = 0;
+			for (; p < end && *p >= '0' && *p <= '9'; p++) if (e < 10000) e = e*10 + (*p - '0');
+			exponent += negativeExp ? -e : e;
+		}
+		if (digits){
+			value = (double)mantissa;
+			if (exponent < 0 && exponent >= -22) value /= powers[-exponent];	//Exact for the numbers .logUpdate() prints
+			else if (exponent > 0 && exponent <= 22) value *= powers[exponent];
+			else if (exponent) value *= pow(10.0, exponent);
+			if (negative) value = -value;
+		}
+	}
+	if (p < end && *p != ',' && *p != '\r' && *p != ' ') value = NAN;	//Trailing characters: not a number after all
+	while (p < end && *p != ',') p++;
+	return value;
+}
+
+static void readHeader(){												//Column names from the first line, if it is a header
+	uint64_t at = 0;
+	while (at < len && (data[at] == '\n' || data[at] == '\r')) at++;	//Skip any padding
+	uint64_t end = lineEnd(at);
+	bool header = (at < len) && !isRow(data[at]);
+	body = header ? end + 1 : at;
+	if (body > len) body = len;
+
+	std::vector<std::string> names;
+	std::string name;
+	for (uint64_t i = at; i <= end; i++){
+		if (i == end || data[i] == ','){
+			names.push_back(header ? name : "col" + std::to_string(names.size()));
+			name.clear();
+		} else if (data[i] != '\r') name += (char)data[i];
+	}
+
+	csvColumns.clear();
+	for (size_t i = 0; i < names.size(); i++){
+		Column column = {names[i], OPC_SCHEMA_F64, 0, names[i] == "flags", NULL};
+		unsigned copy = 1;												//Several sensors on one line repeat the prefix names
+		for (size_t j = 0; j < i; j++) if (names[j] == names[i]) copy++;
+		if (copy > 1) column.name += "." + std::to_string(copy);
+		csvColumns.push_back(column);
+	}
+}
+
+static uint64_t lineStart(uint64_t at){									//First line that starts at or after this byte
+	if (at <= body) return body;
+	if (at >= len) return len;
+	if (data[at - 1] == '\n') return at;
+	uint64_t end = lineEnd(at);
+	return (end < len) ? end + 1 : len;
+}
+
+static void countLines(Chunk &chunk){									//Pass one
+	uint64_t rows = 0, skipped = 0;
+	for (uint64_t at = chunk.start; at < chunk.end; at = lineEnd(at) + 1){
+		if (isRow(data[at])) rows++;
+		else if (data[at] != '\n' && data[at] != '\r') skipped++;
+	}
+	chunk.rows[0] = rows;
+	chunk.skipped = skipped;
+}
+
+static void decodeLines(Chunk &chunk){									//Pass two
+	uint64_t row = chunk.base[0];
+	size_t nColumns = csvColumns.size();
+	for (uint64_t at = chunk.start; at < chunk.end;){
+		uint64_t end = lineEnd(at);
+		if (isRow(data[at])){
+			const char *p = (const char *)data + at, *stop = (const char *)data + end;
+			size_t c = 0;
+			for (; c < nColumns; c++){
+				double value = parseValue(p, stop, csvColumns[c].flags);
+				memcpy(csvColumns[c].out + row*8, &value, 8);
+				if (p >= stop){
+					c++;
+					break;
+				}
+				p++;
+			}
+			for (; c < nColumns; c++) fillMissing(csvColumns[c].out + row*8, OPC_SCHEMA_F64);	//A short line
+			row++;
+		}
+		at = end + 1;
+	}
+}
+
+
+
+//////////OUTPUT//////////
+
+
+
+static void putBytes(std::vector<uint8_t> &buf, const void *bytes, size_t n){
+	const uint8_t *b = (const uint8_t *)bytes;
+	buf.insert(buf.end(), b, b + n);
+}
+
+static void putName(std::vector<uint8_t> &buf, const std::string &name){
+	uint8_t n = name.size() > 255 ? 255 : name.size();
+	buf.push_back(n);
+	putBytes(buf, name.data(), n);
+}
+
+static uint8_t *mapOutput(const char *path, std::vector<Table> &tables, uint64_t &size){	//Lay out the file, and point each column at its array
+	std::vector<uint8_t> directory;
+	putBytes(directory, "OPCCOL01", 8);
+	uint32_t words[2] = {(uint32_t)tables.size(), 0};
+	putBytes(directory, words, 8);
+	std::vector<size_t> patches;										//Where each column's offset goes
+	for (size_t t = 0; t < tables.size(); t++){
+		putName(directory, tables[t].name);
+		uint32_t nColumns = tables[t].columns.size();
+		putBytes(directory, &nColumns, 4);
+		putBytes(directory, &tables[t].rows, 8);
+		for (size_t c = 0; c < nColumns; c++){
+			putName(directory, tables[t].columns[c].name);
+			directory.push_back(tables[t].columns[c].type);
+			patches.push_back(directory.size());
+			directory.resize(directory.size() + 8);
+		}
+	}
+
+	size = (directory.size() + 7) & ~7ULL;
+	std::vector<uint64_t> offsets;
+	for (size_t t = 0; t < tables.size(); t++){
+		for (size_t c = 0; c < tables[t].columns.size(); c++){
+			offsets.push_back(size);
+			memcpy(&directory[patches[offsets.size() - 1]], &size, 8);
+			size += (tables[t].rows*opcSchemaSize(tables[t].columns[c].type) + 7) & ~7ULL;
+		}
+	}
+
+	int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0 || ftruncate(fd, size) != 0){
+		if (fd >= 0) close(fd);
+		return NULL;
+	}
+	uint8_t *out = (uint8_t *)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (out == MAP_FAILED) return NULL;
+
+	memcpy(out, &directory[0], directory.size());
+	size_t k = 0;
+	for (size_t t = 0; t < tables.size(); t++){
+		for (size_t c = 0; c < tables[t].columns.size(); c++) tables[t].columns[c].out = out + offsets[k++];
+	}
+	return out;
+}
+
+
+
+//////////DECODE//////////
+
+
+
+struct Result{
+	std::vector<Table> tables;
+	uint64_t skipped;
+	uint64_t recounted;													//Binary chunks that did not start on the record chain
+	uint64_t foreign;													//Sensor records with another struct layout
+	double seconds;
+	bool ok;
+};
+
+static Result decode(const char *path, unsigned threads){
+	Result result;
+	result.skipped = 0;
+	result.recounted = 0;
+	result.foreign = 0;
+	result.ok = false;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	if (!binary) readHeader();
+	uint64_t from = binary ? 0 : body;
+	uint64_t span = len - from;
+	uint64_t nChunks = span/CHUNK_MIN;									//A few chunks for each thread, so an uneven chunk does not hold up the rest
+	if (nChunks > threads*4ULL) nChunks = threads*4ULL;
+	if (nChunks < 1) nChunks = 1;
+
+	std::vector<Chunk> chunks(nChunks);
+	for (uint64_t k = 0; k < nChunks; k++){
+		chunks[k].start = from + span*k/nChunks;
+		chunks[k].end = from + span*(k + 1)/nChunks;
+	}
+	if (!binary){
+		for (uint64_t k = 0; k < nChunks; k++){
+			chunks[k].start = lineStart(chunks[k].start);
+			chunks[k].end = (k + 1 < nChunks) ? lineStart(chunks[k].end) : len;
+		}
+	}
+
+	parallelFor(nChunks, threads, [&](unsigned k){
+		if (binary) countRecords(chunks[k], chunks[k].start);
+		else countLines(chunks[k]);
+	});
+
+	if (binary){														//Each chunk has to pick up where the one before it left off
+		for (uint64_t k = 1; k < nChunks; k++){
+			if (chunks[k].first == chunks[k - 1].handoff) continue;
+			countRecords(chunks[k], chunks[k - 1].handoff);
+			result.recounted++;
+		}
+	}
+
+	Table *byType[256] = {NULL};
+	uint64_t rows[256] = {0};
+	int nTypes = binary ? 256 : 1;
+	for (int type = 0; type < nTypes; type++){
+		for (uint64_t k = 0; k < nChunks; k++){
+			chunks[k].base[type] = rows[type];
+			rows[type] += chunks[k].rows[type];
+		}
+	}
+	if (binary){
+		for (int type = 0; type < 256; type++){
+			if (!rows[type]) continue;
+			result.tables.push_back(Table());
+			tableFor(result.tables.back(), type);
+			result.tables.back().rows = rows[type];
+		}
+		for (size_t t = 0, type = 0; type < 256; type++) if (rows[type]) byType[type] = &result.tables[t++];
+	} else {
+		Table table;
+		table.name = "csv";
+		table.columns = csvColumns;
+		table.rows = rows[0];
+		result.tables.push_back(table);
+	}
+
+	uint64_t size;
+	uint8_t *out = mapOutput(path, result.tables, size);
+	if (!out) return result;
+	if (!binary) csvColumns = result.tables[0].columns;
+
+	parallelFor(nChunks, threads, [&](unsigned k){
+		if (!binary) decodeLines(chunks[k]);
+		else decodeRecords(chunks[k], k ? chunks[k - 1].handoff : 0, chunks[k].handoff, byType);
+	});
+
+	munmap(out, size);
+	for (uint64_t k = 0; k < nChunks; k++){
+		result.skipped += chunks[k].skipped;
+		if (binary) result.foreign += chunks[k].foreign;
+	}
+	result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	result.ok = true;
+	return result;
+}
+
+int main(int argc, char **argv){
+	unsigned threads = std::thread::hardware_concurrency();
+	bool bench = false;
+	int arg = 1;
+	for (; arg < argc && argv[arg][0] == '-'; arg++){
+		if (!strcmp(argv[arg], "-b")) bench = true;
+		else if (!strcmp(argv[arg], "-t") && arg + 1 < argc) threads = atoi(argv[++arg]);
+		else break;
+	}
+	if (argc - arg != 2){
+		fprintf(stderr, "Usage: %s [-t threads] [-b] log output.col\n", argv[0]);
+		return 1;
+	}
+	if (threads < 1) threads = 1;
+
+	int fd = open(argv[arg], O_RDONLY);
+	struct stat info;
+	if (fd < 0 || fstat(fd, &info) != 0 || info.st_size == 0){
+		fprintf(stderr, "Can not read %s\n", argv[arg]);
+		return 1;
+	}
+	len = info.st_size;
+	data = (const uint8_t *)mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED){
+		fprintf(stderr, "Can not map %s\n", argv[arg]);
+		return 1;
+	}
+	binary = (data[0] == OPC_RECORD_SYNC);
+
+	std::vector<unsigned> runs;
+	if (bench){
+		for (unsigned t = 1; t < threads; t *= 2) runs.push_back(t);
+		decode(argv[arg + 1], threads);									//Warm up the page cache
+	}
+	runs.push_back(threads);
+
+	if (bench) printf("%8s %10s %10s %8s\n", "threads", "seconds", "MB/s", "speedup");
+	double single = 0;
+	Result result;
+	for (size_t i = 0; i < runs.size(); i++){
+		result = decode(argv[arg + 1], runs[i]);
+		if (!result.ok){
+			fprintf(stderr, "Can not write %s\n", argv[arg + 1]);
+			return 1;
+		}
+		if (i == 0) single = result.seconds;
+		if (bench) printf("%8u %10.3f %10.1f %8.2f\n", runs[i], result.seconds, len/result.seconds/1e6, single/result.seconds);
+	}
+
+	printf("%s: %llu bytes, %s, %u threads, %.3f s, %.1f MB/s\n", argv[arg], (unsigned long long)len, binary ? "binary" : "CSV",
+		   threads, result.seconds, len/result.seconds/1e6);
+	for (size_t t = 0; t < result.tables.size(); t++){
+		printf("  %-12s %12llu rows %4u columns\n", result.tables[t].name.c_str(), (unsigned long long)result.tables[t].rows,
+			   (unsigned)result.tables[t].columns.size());
+	}
+	if (result.skipped) printf("  %llu %s skipped\n", (unsigned long long)result.skipped, binary ? "bytes" : "lines");
+	if (result.recounted) printf("  %llu chunks recounted\n", (unsigned long long)result.recounted);
+	if (result.foreign) printf("  %llu records from a board with another struct layout were not decoded\n", (unsigned long long)result.foreign);
+	munmap((void *)data, len);
+	return 0;
+}
@@ -0,0 +1,112 @@
+//Optical Particle Counter Library
+
+//University of Minnesota - Candler MURI
+
+/*This is the journal recovery tool. It reads a journal image (the log file,
+or a raw dump of the card), finds every good entry with OPCJournalScanner,
+and rebuilds a clean log from them:
+ - the CSV lines go to the text output, one per line, in boot and sequence order
+ - the binary records go to the record output, back to back
+Entries found twice (a block written again after a retry) are only kept once.
+
+For each boot, it reports the entries found, the sequence numbers that are
+missing, and how many entries came after the last commit, which are the ones
+a brown-out could have cut short.
+
+Build on a computer from the library folder:
+	g++ -O2 -I. extras/journal/opcrecover.cpp OPCJournal.cpp OPCLogger.cpp OPCRecord.cpp -o opcrecover
+
+Usage: opcrecover image text.csv [records.bin]
+*/
+
+#include "OPCJournal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <algorithm>
+#include <vector>
+
+static bool entryOrder(const OPCJournalEntry &a, const OPCJournalEntry &b){
+	if (a.boot != b.boot) return a.boot < b.boot;
+	if (a.sequence != b.sequence) return a.sequence < b.sequence;
+	return a.offset < b.offset;
+}
+
+int main(int argc, char **argv){
+	if (argc < 3){
+		fprintf(stderr, "Usage: %s image text.csv [records.bin]\n", argv[0]);
+		return 1;
+	}
+	FILE *in = fopen(argv[1], "rb");
+	if (!in){
+		fprintf(stderr, "Can not open %s\n", argv[1]);
+		return 1;
+	}
+	fseek(in, 0, SEEK_END);
+	long size = ftell(in);
+	fseek(in, 0, SEEK_SET);
+	std::vector<uint8_t> image(size > 0 ? size : 1);
+	if (size > 0 && fread(&image[0], 1, size, in) != (size_t)size){
+		fprintf(stderr, "Can not read %s\n", argv[1]);
+		return 1;
+	}
+	fclose(in);
+
+	clock_t start = clock();											//Scan
+	OPCJournalScanner scanner(&image[0], size > 0 ? size : 0);
+	std::vector<OPCJournalEntry> entries;
+	OPCJournalEntry entry;
+	bool sorted = true;
+	while (scanner.next(entry)){
+		if (!entries.empty() && entryOrder(entry, entries.back())) sorted = false;
+		entries.push_back(entry);
+	}
+	if (!sorted) std::stable_sort(entries.begin(), entries.end(), entryOrder);	//Only a card dump of several files is out of order
+	double seconds = (double)(clock() - start)/CLOCKS_PER_SEC;
+
+	FILE *text = fopen(argv[2], "wb");
+	FILE *records = (argc > 3) ? fopen(argv[3], "wb") : NULL;
+	if (!text || (argc > 3 && !records)){
+		fprintf(stderr, "Can not open the outputs\n");
+		return 1;
+	}
+
+	printf("%s: %ld bytes, %u entries, %llu bytes skipped, %.1f MB/s\n", argv[1], size, scanner.getFound(),
+		   (unsigned long long)scanner.getSkipped(), seconds > 0 ? size/seconds/1e6 : 0.0);
+	printf("%6s %10s %10s %10s %10s %12s\n", "boot", "entries", "first", "last", "missing", "uncommitted");
+
+	unsigned long duplicates = 0;
+	size_t i = 0;
+	while (i < entries.size()){											//One boot at a time
+		uint16_t boot = entries[i].boot;
+		uint32_t first = entries[i].sequence, last = first;
+		unsigned long kept = 0, missing = 0, sinceCommit = 0;
+		bool haveLast = false;
+
+		for (; i < entries.size() && entries[i].boot == boot; i++){
+			OPCJournalEntry &e = entries[i];
+			if (haveLast && e.sequence == last){						//Same entry twice
+				duplicates++;
+				continue;
+			}
+			if (haveLast) missing += e.sequence - last - 1;
+			last = e.sequence;
+			haveLast = true;
+			kept++;
+			sinceCommit++;
+
+			if (e.kind == OPC_JOURNAL_COMMIT) sinceCommit = 0;
+			else if (e.kind == OPC_JOURNAL_TEXT){
+				fwrite(e.data, 1, e.length, text);
+				fputc('\n', text);
+			} else if (e.kind == OPC_JOURNAL_RECORD && records) fwrite(e.data, 1, e.length, records);
+		}
+		missing += first;												//Entries lost from the start of the boot
+		printf("%6u %10lu %10lu %10lu %10lu %12lu\n", boot, kept, (unsigned long)first, (unsigned long)last, missing, sinceCommit);
+	}
+	if (duplicates) printf("%lu duplicate entries dropped\n", duplicates);
+
+	fclose(text);
+	if (records) fclose(records);
+	return 0;
+}
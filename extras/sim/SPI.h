@@ -0,0 +1,55 @@
+//Optical Particle Counter Library
+
+//University of Minnesota - Candler MURI
+
+/*This is the stand-in for the SPI library used by the flight simulator.
+Each transfer goes to the simulated device whose slave select pin is low. If
+more than one is low, every selected device sees the byte, the answers are
+mixed on the bus, and the transfer is counted as a contention. A transaction
+begun while another is still open is counted as nested.
+*/
+
+
+#ifndef SimSPI_h
+#define SimSPI_h
+
+#include "arduino.h"
+
+#define MSBFIRST 1
+#define SPI_MODE1 1
+
+struct SPISettings
+{
+	SPISettings() {}
+	SPISettings(uint32_t clock, uint8_t order, uint8_t mode) {}
+};
+
+class SimSPIDevice														//Anything that can answer on the SPI bus
+{
+	public:
+	virtual ~SimSPIDevice() {}
+	virtual uint8_t transfer(uint8_t value) = 0;
+	virtual void select(bool selected) {}								//Called when the slave select pin changes
+};
+
+class SPIClass
+{
+	private:
+	unsigned long contentions;
+	uint8_t depth;														//Transactions open
+	unsigned long nested;
+
+	public:
+	SPIClass() : contentions(0), depth(0), nested(0) {}
+	void begin() {}
+	void beginTransaction(SPISettings settings) { if (depth++) nested++; }
+	void endTransaction() { if (depth) depth--; }
+	uint8_t transfer(uint8_t value);
+	void attach(uint8_t pin, SimSPIDevice *device);						//Connect a simulated device to a slave select pin
+	unsigned long getContentions() { return contentions; }				//Transfers with more than one device selected
+	unsigned long getNested() { return nested; }						//Transactions begun inside another
+};
+
+extern SPIClass SPI;
+
+#endif
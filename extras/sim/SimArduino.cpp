@@ -0,0 +1,242 @@
+//Optical Particle Counter Library
+
+//University of Minnesota - Candler MURI
+
+/*This is the definitions file for the Arduino stand-in and the virtual clock
+of the flight simulator. See arduino.h and SimClock.h.*/
+
+#include "arduino.h"
+#include "SPI.h"
+#include "i2c_t3.h"
+#include "SimClock.h"
+#include <vector>
+
+SimConsole Serial;
+SPIClass SPI;
+i2c_t3 Wire;
+
+
+
+//////////CLOCK//////////
+
+
+
+static uint64_t clockUs = 0;											//Virtual time
+
+struct SimCall{
+	const char *name;
+	unsigned long calls;
+	uint64_t total;														//us
+	uint64_t longest;													//us
+	unsigned long overThreshold;
+};
+
+struct SimLongCall{
+	const char *name;
+	uint64_t start;
+	uint64_t length;
+};
+
+static SimCall calls[SIM_MAX_CALLS];
+static uint8_t nCalls = 0;
+static std::vector<SimLongCall> longCalls;
+static uint64_t threshold = 1000000;
+static const char *openName = NULL;
+static uint64_t openStart = 0;
+static unsigned long delayCalls = 0;
+static uint64_t delayTime = 0;
+
+unsigned long millis(){ return (uint32_t)(clockUs/1000); }				//Both wrap at 32 bits, as on the microcontroller
+
+unsigned long micros(){ return (uint32_t)clockUs; }
+
+void delay(unsigned long ms){
+	delayCalls++;
+	delayTime += ms*1000ULL;
+	clockUs += ms*1000ULL;
+}
+
+void delayMicroseconds(unsigned int us){
+	delayCalls++;
+	delayTime += us;
+	clockUs += us;
+}
+
+uint64_t simMicros(){ return clockUs; }
+
+void simAdvance(unsigned long ms){ clockUs += ms*1000ULL; }
+
+void simAdvanceMicros(uint64_t us){ clockUs += us; }
+
+void simBegin(const char *name){
+	openName = name;
+	openStart = clockUs;
+}
+
+void simEnd(){
+	if (!openName) return;
+	uint64_t length = clockUs - openStart;
+
+	uint8_t i = 0;
+	while ((i < nCalls) && strcmp(calls[i].name, openName)) i++;
+	if (i == nCalls){
+		if (nCalls == SIM_MAX_CALLS){									//No room, so the call is lumped in with the last name
+			i = nCalls - 1;
+		} else {
+			nCalls++;
+			calls[i].name = openName;
+			calls[i].calls = 0;
+			calls[i].total = 0;
+			calls[i].longest = 0;
+			calls[i].overThreshold = 0;
+		}
+	}
+
+	calls[i].calls++;
+	calls[i].total += length;
+	if (length > calls[i].longest) calls[i].longest = length;
+	if (length >= threshold){
+		calls[i].overThreshold++;
+		SimLongCall entry = {openName, openStart, length};
+		longCalls.push_back(entry);
+	}
+	openName = NULL;
+}
+
+void simSetThreshold(unsigned long ms){ threshold = ms*1000ULL; }
+
+void simResetReport(){
+	nCalls = 0;
+	longCalls.clear();
+	delayCalls = 0;
+	delayTime = 0;
+}
+
+String simClockString(uint64_t us){
+	char text[32];
+	uint64_t ms = us/1000;
+	snprintf(text, sizeof(text), "%lu:%02lu:%02lu.%03lu", (unsigned long)(ms/3600000), (unsigned long)((ms/60000)%60),
+			 (unsigned long)((ms/1000)%60), (unsigned long)(ms%1000));
+	return String(text);
+}
+
+void simReport(FILE *out){
+	fprintf(out, "Blocking report (virtual time spent inside library calls)\n");
+	fprintf(out, "%-24s %8s %12s %10s %12s %8s\n", "call", "calls", "total s", "mean ms", "longest ms", "long");
+	for (uint8_t i = 0; i < nCalls; i++){
+		fprintf(out, "%-24s %8lu %12.3f %10.3f %12.3f %8lu\n", calls[i].name, calls[i].calls, calls[i].total/1e6,
+				calls[i].calls ? calls[i].total/1e3/calls[i].calls : 0.0, calls[i].longest/1e3, calls[i].overThreshold);
+	}
+	fprintf(out, "delay() and delayMicroseconds(): %lu calls, %.3f s\n", delayCalls, delayTime/1e6);
+
+	fprintf(out, "\nCalls of %.0f ms or more (%lu)\n", threshold/1e3, (unsigned long)longCalls.size());
+	for (size_t i = 0; i < longCalls.size(); i++){
+		fprintf(out, "  %s  %-24s %10.3f ms\n", simClockString(longCalls[i].start).c_str(), longCalls[i].name, longCalls[i].length/1e3);
+	}
+}
+
+
+
+//////////PINS AND SPI//////////
+
+
+
+static uint8_t pinState[256];
+static SimSPIDevice *spiDevices[256];
+
+void pinMode(uint8_t pin, uint8_t mode){}
+
+void digitalWrite(uint8_t pin, uint8_t value){
+	bool changed = (pinState[pin] != value);
+	pinState[pin] = value;
+	if (changed && spiDevices[pin]) spiDevices[pin]->select(value == LOW);
+}
+
+uint8_t digitalRead(uint8_t pin){ return pinState[pin]; }
+
+void SPIClass::attach(uint8_t pin, SimSPIDevice *device){
+	spiDevices[pin] = device;
+	pinState[pin] = HIGH;
+}
+
+uint8_t SPIClass::transfer(uint8_t value){								//The bus reads back zeros if no device is selected
+	uint8_t selected = 0;
+	uint8_t result = 0xFF;
+	for (unsigned int pin = 0; pin < 256; pin++){
+		if (!spiDevices[pin] || (pinState[pin] != LOW)) continue;
+		result &= spiDevices[pin]->transfer(value);						//Two drivers on the line: a low from either wins
+		selected++;
+	}
+	if (selected > 1) contentions++;
+	return selected ? result : 0x00;
+}
+
+
+
+//////////STRING AND PRINT//////////
+
+
+
+void String::number(unsigned long long value, bool negative, unsigned char base){
+	char digits[72];
+	int at = sizeof(digits) - 1;
+	digits[at] = 0;
+	if (base < 2) base = 10;
+	do {
+		int digit = value % base;
+		digits[--at] = (digit < 10) ? ('0' + digit) : ('A' + digit - 10);
+		value /= base;
+	} while (value && (at > 1));
+	if (negative) digits[--at] = '-';
+	text = &digits[at];
+}
+
+String::String(unsigned char value, unsigned char base){ number(value, false, base); }
+String::String(int value, unsigned char base){ number((base == DEC) && (value < 0) ? -(long long)value : (unsigned int)value, (base == DEC) && (value < 0), base); }
+String::String(unsigned int value, unsigned char base){ number(value, false, base); }
+String::String(long value, unsigned char base){ number((base == DEC) && (value < 0) ? -(long long)value : (unsigned long)value, (base == DEC) && (value < 0), base); }
+String::String(unsigned long value, unsigned char base){ number(value, false, base); }
+
+String::String(float value, unsigned char decimals){
+	char buffer[64];
+	snprintf(buffer, sizeof(buffer), "%.*f", decimals, value);
+	text = buffer;
+}
+
+String::String(double value, unsigned char decimals){
+	char buffer[64];
+	snprintf(buffer, sizeof(buffer), "%.*f", decimals, value);
+	text = buffer;
+}
+
+int String::indexOf(char value, unsigned int from) const {
+	size_t at = text.find(value, from);
+	return (at == std::string::npos) ? -1 : (int)at;
+}
+
+String String::substring(unsigned int from, unsigned int to) const {
+	if (from > to){ unsigned int swap = from; from = to; to = swap; }
+	if (from > text.size()) return String();
+	return String(text.substr(from, to - from));
+}
+
+size_t Print::write(const uint8_t *buffer, size_t size){
+	for (size_t i = 0; i < size; i++) write(buffer[i]);
+	return size;
+}
+
+size_t Print::print(long value, int base){ return print(String(value, (unsigned char)base)); }
+
+size_t Print::print(unsigned long value, int base){ return print(String(value, (unsigned char)base)); }
+
+size_t Stream::readBytes(uint8_t *buffer, size_t length){
+	size_t count = 0;
+	while ((count < length) && (available() > 0)) buffer[count++] = read();
+	return count;
+}
+
+size_t SimConsole::write(uint8_t value){
+	written++;
+	if (echo) fputc(value, stdout);
+	return 1;
+}
@@ -0,0 +1,36 @@
+//Optical Particle Counter Library
+
+//University of Minnesota - Candler MURI
+
+/*This is the header file for the virtual clock of the flight simulator.
+The clock only moves when the library calls delay() or delayMicroseconds(),
+or when the simulation moves it with simAdvance(). Nothing takes real time,
+so a three hour flight runs in a second or two.
+
+Every call into the library can be wrapped with simBegin() and simEnd(). The
+virtual time that passes between them is time the library held the loop, and
+it is added to the blocking report under the given name. Any single call at
+or above the threshold is also listed on its own, with the flight time it
+happened at.
+*/
+
+
+#ifndef SimClock_h
+#define SimClock_h
+
+#include "arduino.h"
+
+#define SIM_MAX_CALLS 24												//Most names in the blocking report
+
+
+uint64_t simMicros();													//Virtual time since the start, with no rollover (us)
+void simAdvance(unsigned long ms);										//Move the clock without counting it as blocking
+void simAdvanceMicros(uint64_t us);
+void simBegin(const char *name);										//Start timing a library call
+void simEnd();															//Stop timing it and add it to the report
+void simSetThreshold(unsigned long ms);									//Calls at least this long are listed one by one (default 1000)
+void simReport(FILE *out);												//Print the blocking report
+void simResetReport();
+String simClockString(uint64_t us);										//h:mm:ss.mmm of a virtual time
+
+#endif
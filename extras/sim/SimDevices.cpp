@@ -0,0 +1,575 @@
+//Optical Particle Counter Library
+
+//University of Minnesota - Candler MURI
+
+/*This is the definitions file for the simulated sensors of the flight
+simulator. See SimDevices.h for what each model does.*/
+
+#include "SimDevices.h"
+
+#define SIM_SPS_LATENCY 5000											//Time for each response to arrive (us)
+#define SIM_HPM_LATENCY 20000
+#define SIM_PMS_LATENCY 10000
+#define SIM_ALPHA_READY 10000											//Time from the busy answer to the ready answer (us)
+#define SIM_HPM_SPINUP 6000000											//Time from power on to the first auto send frame (us)
+
+static unsigned int crcA001(const uint8_t *data, uint8_t len){			//Same checksum as the R1 and N3
+	unsigned int crc = 0xFFFF;
+	for (uint8_t i = 0; i < len; i++){
+		crc ^= data[i];
+		for (uint8_t b = 0; b < 8; b++) crc = (crc & 1) ? ((crc >> 1) ^ 0xA001) : (crc >> 1);
+	}
+	return crc;
+}
+
+static void putU16BE(uint8_t *at, uint16_t value){
+	at[0] = value >> 8;
+	at[1] = value & 0xFF;
+}
+
+static void putFloatBE(uint8_t *at, float value){						//The SPS sends floats MSB first
+	uint8_t bytes[4];
+	memcpy(bytes, &value, 4);
+	for (uint8_t i = 0; i < 4; i++) at[i] = bytes[3 - i];
+}
+
+static uint16_t clampU16(float value){
+	if (value < 0) return 0;
+	if (value > 65535) return 65535;
+	return (uint16_t)value;
+}
+
+static float flat = 0;													//Concentration of a flat aerosol, 0 for none
+
+void simSetFlat(float concentration){ flat = concentration; }
+
+float simAerosol(){														//A two hour ascent to 30 km, then a one hour descent. The
+	if (flat > 0) return flat;
+	float hours = simMicros()/3.6e9;									//concentration falls off with a 2 km scale height.
+	float altitude = (hours < 2) ? 15*hours : 30 - 30*(hours - 2);
+	if (altitude < 0) altitude = 0;
+	float ripple = 0.1*sin(simMicros()/1e6*0.37);						//Layers drifting past, so a working sensor never
+	return 50*exp(-altitude/2) + 0.5 + ripple;							//sends the same frame for long, even in clean air
+}
+
+
+
+//////////FAULTS//////////
+
+
+
+bool SimFaults::add(unsigned long startMs, unsigned long endMs, uint8_t mode){
+	if (n == SIM_MAX_FAULTS) return false;
+	list[n].start = startMs;
+	list[n].end = endMs;
+	list[n].mode = mode;
+	n++;
+	return true;
+}
+
+uint8_t SimFaults::mode(){												//The first entry that covers the time wins
+	uint64_t now = simMicros()/1000;
+	for (uint8_t i = 0; i < n; i++){
+		if ((now >= list[i].start) && (now < list[i].end)) return list[i].mode;
+	}
+	return SIM_NORMAL;
+}
+
+float SimFaults::aerosol(){
+	if (mode() != SIM_FROZEN){
+		holding = false;
+		return simAerosol();
+	}
+	if (!holding) held = simAerosol();
+	holding = true;
+	return held;
+}
+
+
+
+//////////SERIAL//////////
+
+
+
+SimSerialDevice::SimSerialDevice(){ memset(&stats, 0, sizeof(stats)); }
+
+void SimSerialDevice::send(const uint8_t *bytes, size_t len, uint64_t due){
+	SimPending entry;
+	entry.due = due;
+	entry.bytes.assign(bytes, bytes + len);
+	pending.push_back(entry);
+}
+
+void SimSerialDevice::clear(){ pending.clear(); }
+
+void SimSerialDevice::deliver(){
+	uint64_t now = simMicros();
+	while (!pending.empty() && (pending.front().due <= now)){
+		std::vector<uint8_t> &bytes = pending.front().bytes;
+		for (size_t i = 0; i < bytes.size(); i++){
+			if (rx.size() < SIM_RX_BUFFER) rx.push_back(bytes[i]);
+			else stats.overruns++;										//The buffer is full, so the byte is lost
+		}
+		pending.pop_front();
+	}
+}
+
+size_t SimSerialDevice::write(uint8_t value){
+	if (faults.mode() != SIM_UNRESPONSIVE) receive(value);
+	return 1;
+}
+
+int SimSerialDevice::available(){
+	service();
+	deliver();
+	return rx.size();
+}
+
+int SimSerialDevice::read(){
+	if (!available()) return -1;
+	uint8_t value = rx.front();
+	rx.pop_front();
+	return value;
+}
+
+int SimSerialDevice::peek(){
+	if (!available()) return -1;
+	return rx.front();
+}
+
+
+
+//////////PLANTOWER//////////
+
+
+
+SimPlantower::SimPlantower(){											//The Plantower comes up powered and in active mode
+	at = 0;
+	powered = true;
+	active = true;
+	nextFrame = simMicros() + 1000000;
+}
+
+void SimPlantower::receive(uint8_t value){
+	if ((at == 0) && (value != 0x42)) return;
+	if ((at == 1) && (value != 0x4D)){
+		at = 0;
+		return;
+	}
+	command[at++] = value;
+	if (at < 7) return;
+	at = 0;
+
+	uint16_t sum = 0;
+	for (uint8_t i = 0; i < 5; i++) sum += command[i];
+	if (sum != ((command[5] << 8) | command[6])) return;				//A bad command is ignored
+	stats.commands++;
+
+	uint8_t cmd = command[2];
+	uint8_t mode = command[4];
+	if (cmd == 0xE4){													//Sleep or wake
+		if (!mode && powered) stats.powerOffs++;
+		if (mode && !powered) nextFrame = simMicros() + 1000000;
+		powered = mode;
+	} else if (cmd == 0xE1) active = mode;								//Passive or active
+	else if (cmd == 0xE2){												//Read in passive mode, answered with a frame instead of an ack
+		if (powered && !active) sendFrame(simMicros() + SIM_PMS_LATENCY);
+		return;
+	}
+
+	uint8_t ack[8] = {0x42, 0x4D, 0x00, 0x04, cmd, mode, 0, 0};			//Each command is answered with a short frame
+	sum = 0;
+	for (uint8_t i = 0; i < 6; i++) sum += ack[i];
+	putU16BE(&ack[6], sum);
+	send(ack, 8, simMicros() + SIM_PMS_LATENCY);
+}
+
+void SimPlantower::service(){											//One frame a second while powered and active
+	uint64_t now = simMicros();
+	if (!powered || !active){
+		if (nextFrame < now) nextFrame = now;
+		return;
+	}
+
+	while (nextFrame <= now){
+		sendFrame(nextFrame);
+		nextFrame += 1000000;
+	}
+}
+
+void SimPlantower::sendFrame(uint64_t due){								//One data frame, unless the fault schedule says otherwise
+	uint8_t mode = faults.mode();
+	if ((mode != SIM_NORMAL) && (mode != SIM_CORRUPT) && (mode != SIM_FROZEN)) return;
+
+	float c = faults.aerosol();
+	uint16_t words[13] = {28, clampU16(c*0.2), clampU16(c*0.3), clampU16(c*0.35), clampU16(c*0.2), clampU16(c*0.3),
+						  clampU16(c*0.35), clampU16(c*100), clampU16(c*30), clampU16(c*5), clampU16(c*0.5),
+						  clampU16(c*0.1), clampU16(c*0.02)};
+	uint8_t frame[32] = {0x42, 0x4D};
+	for (uint8_t i = 0; i < 13; i++) putU16BE(&frame[2 + i*2], words[i]);
+	uint16_t sum = 0;
+	for (uint8_t i = 0; i < 30; i++) sum += frame[i];
+	if (mode == SIM_CORRUPT){
+		sum ^= 0x0001;
+		stats.corrupt++;
+	} else stats.frames++;
+	putU16BE(&frame[30], sum);
+	send(frame, 32, due);
+}
+
+
+
+//////////SPS//////////
+
+
+
+SimSPS::SimSPS(){
+	inFrame = false;
+	escaped = false;
+	running = false;
+	format = 0x03;
+	lastSent = simMicros()/1000000;
+}
+
+void SimSPS::receive(uint8_t value){									//Frames are unstuffed as they arrive
+	if (value == 0x7E){
+		if (!inFrame || frame.empty()){									//Start of a frame
+			inFrame = true;
+			frame.clear();
+			return;
+		}
+		inFrame = false;
+	} else {
+		if (!inFrame) return;
+		if (value == 0x7D){
+			escaped = true;
+			return;
+		}
+		if (escaped) value ^= 0x20;
+		escaped = false;
+		frame.push_back(value);
+		return;
+	}
+
+	if (frame.size() < 4) return;										//Address, command, length, and checksum at the least
+	uint8_t sum = 0;
+	for (size_t i = 0; i + 1 < frame.size(); i++) sum += frame[i];
+	if ((uint8_t)~sum != frame.back()) return;							//A bad command is ignored
+	stats.commands++;
+
+	uint8_t cmd = frame[1];
+	uint8_t mode = faults.mode();
+	uint64_t measurement = simMicros()/1000000;							//A new measurement every second
+
+	if (cmd == 0x00){													//Start measurement
+		if ((frame[2] >= 2) && (frame.size() >= 6)) format = frame[4];
+		if (!running) lastSent = measurement;
+		running = true;
+		reply(cmd, NULL, 0, false);
+	} else if (cmd == 0x01){											//Stop measurement
+		if (running) stats.powerOffs++;
+		running = false;
+		reply(cmd, NULL, 0, false);
+	} else if (cmd == 0x56){											//Fan clean
+		reply(cmd, NULL, 0, false);
+	} else if (cmd == 0x03){											//Read measurement. The frame is empty if there is no new one.
+		if (!running || (mode == SIM_DROPOUT) || (measurement <= lastSent)){
+			reply(cmd, NULL, 0, false);
+			return;
+		}
+		lastSent = measurement;
+
+		float c = faults.aerosol();
+		float values[10] = {c*0.2f, c*0.3f, c*0.33f, c*0.35f, c*40, c*48, c*50, c*50.5f, c*50.6f, 0.6f};
+		uint8_t data[40];
+		uint8_t len = 0;
+		for (uint8_t i = 0; i < 10; i++){
+			if (format == 0x05){										//Integer format, size in nanometers
+				putU16BE(&data[len], clampU16((i == 9) ? values[i]*1000 : values[i]));
+				len += 2;
+			} else {
+				putFloatBE(&data[len], values[i]);
+				len += 4;
+			}
+		}
+		reply(cmd, data, len, mode == SIM_CORRUPT);
+	}
+}
+
+void SimSPS::reply(uint8_t cmd, const uint8_t *data, uint8_t len, bool corrupt){	//MISO frame: address, command, state, length, data, checksum
+	uint8_t raw[48] = {0x00, cmd, 0x00, len};
+	if (len > 0) memcpy(&raw[4], data, len);
+	uint8_t sum = 0;
+	for (uint8_t i = 0; i < 4 + len; i++) sum += raw[i];
+	raw[4 + len] = ~sum;
+	if (corrupt) raw[4 + len] ^= 0x01;
+
+	uint8_t out[100];
+	uint8_t n = 0;
+	out[n++] = 0x7E;
+	for (uint8_t i = 0; i < 5 + len; i++){								//Byte stuffing
+		uint8_t b = raw[i];
+		if ((b == 0x7E) || (b == 0x7D) || (b == 0x11) || (b == 0x13)){
+			out[n++] = 0x7D;
+			out[n++] = b ^ 0x20;
+		} else out[n++] = b;
+	}
+	out[n++] = 0x7E;
+
+	if (len > 0){
+		if (corrupt) stats.corrupt++;
+		else stats.frames++;
+	}
+	send(out, n, simMicros() + SIM_SPS_LATENCY);
+}
+
+
+
+//////////HPM//////////
+
+
+
+SimHPM::SimHPM(){														//The HPM comes up measuring, with auto send on
+	at = 0;
+	measuring = true;
+	autoSend = true;
+	nextFrame = simMicros() + SIM_HPM_SPINUP;
+}
+
+void SimHPM::receive(uint8_t value){
+	if ((at == 0) && (value != 0x68)) return;
+	command[at++] = value;
+	if (at < 4) return;
+	at = 0;
+
+	if (((0x68 + command[1] + command[2] + command[3]) & 0xFF) != 0) return;	//A bad command is ignored
+	stats.commands++;
+
+	uint8_t cmd = command[2];
+	uint8_t mode = faults.mode();
+	uint64_t now = simMicros();
+	const uint8_t ack[2] = {0xA5, 0xA5};
+	const uint8_t nack[2] = {0x96, 0x96};
+
+	if (cmd == 0x01){													//Start measuring
+		if (!measuring) nextFrame = now + SIM_HPM_SPINUP;
+		measuring = true;
+		send(ack, 2, now + SIM_HPM_LATENCY);
+	} else if (cmd == 0x02){											//Stop measuring
+		if (measuring) stats.powerOffs++;
+		measuring = false;
+		send(ack, 2, now + SIM_HPM_LATENCY);
+	} else if ((cmd == 0x20) || (cmd == 0x40)){							//Auto send off or on
+		autoSend = (cmd == 0x40);
+		send(ack, 2, now + SIM_HPM_LATENCY);
+	} else if (cmd == 0x04){											//Read the measurement
+		if (!measuring || (mode == SIM_DROPOUT)){
+			send(nack, 2, now + SIM_HPM_LATENCY);
+			return;
+		}
+		float c = faults.aerosol();
+		uint8_t frame[16] = {0x40, 0x0D, 0x04};
+		putU16BE(&frame[3], clampU16(c*0.2));
+		putU16BE(&frame[5], clampU16(c*0.3));
+		putU16BE(&frame[7], clampU16(c*0.33));
+		putU16BE(&frame[9], clampU16(c*0.35));
+		uint16_t sum = 0;
+		for (uint8_t i = 0; i < 15; i++) sum += frame[i];
+		frame[15] = (65536 - sum) % 256;
+		if (mode == SIM_CORRUPT){
+			frame[15] ^= 0x01;
+			stats.corrupt++;
+		} else stats.frames++;
+		send(frame, 16, now + SIM_HPM_LATENCY);
+	}
+}
+
+void SimHPM::service(){													//Auto send frames, once a second
+	uint64_t now = simMicros();
+	if (!measuring || !autoSend){
+		if (nextFrame < now) nextFrame = now;
+		return;
+	}
+
+	while (nextFrame <= now){
+		uint8_t mode = faults.mode();
+		if ((mode == SIM_NORMAL) || (mode == SIM_CORRUPT) || (mode == SIM_FROZEN)){
+			float c = faults.aerosol();
+			uint8_t frame[32] = {0x42, 0x4D, 0x00, 0x1C};
+			putU16BE(&frame[4], clampU16(c*0.2));
+			putU16BE(&frame[6], clampU16(c*0.3));
+			putU16BE(&frame[8], clampU16(c*0.33));
+			putU16BE(&frame[10], clampU16(c*0.35));
+			uint16_t sum = 0;
+			for (uint8_t i = 0; i < 30; i++) sum += frame[i];
+			if (mode == SIM_CORRUPT){
+				sum ^= 0x0001;
+				stats.corrupt++;
+			} else stats.frames++;
+			putU16BE(&frame[30], sum);
+			send(frame, 32, nextFrame);
+		}
+		nextFrame += 1000000;
+	}
+}
+
+
+
+//////////ALPHASENSE//////////
+
+
+
+#define SIM_ALPHA_IDLE 0												//Handshake states
+#define SIM_ALPHA_BUSY 1
+#define SIM_ALPHA_CONTROL 2
+#define SIM_ALPHA_DATA 3
+
+SimAlpha::SimAlpha(uint8_t type){										//The fan and laser start off
+	model = type;
+	state = SIM_ALPHA_IDLE;
+	pendingCommand = 0;
+	busyTime = 0;
+	outLen = 0;
+	outAt = 0;
+	fan = false;
+	laser = false;
+	lastReset = simMicros();
+	heldLen = 0;
+	memset(carry, 0, sizeof(carry));
+	memset(&stats, 0, sizeof(stats));
+}
+
+bool SimAlpha::isLaserOn(){ return laser; }
+
+bool SimAlpha::isFanOn(){ return fan; }
+
+void SimAlpha::select(bool selected){ state = SIM_ALPHA_IDLE; }			//The handshake starts over on either edge
+
+uint8_t SimAlpha::transfer(uint8_t value){
+	uint8_t mode = faults.mode();
+	if (mode == SIM_UNRESPONSIVE){
+		state = SIM_ALPHA_IDLE;
+		return 0x00;
+	}
+
+	if (state == SIM_ALPHA_DATA){										//Clocking out a response
+		uint8_t b = out[outAt++];
+		if (outAt >= outLen) state = SIM_ALPHA_IDLE;
+		return b;
+	}
+
+	if (state == SIM_ALPHA_CONTROL){									//The byte after a ready 0x03
+		stats.commands++;
+		if (model == SIM_R1){
+			if ((value == 0x00) && laser) stats.powerOffs++;
+			if (value == 0x03) fan = laser = true;
+			if (value == 0x00) fan = laser = false;
+		} else {
+			if ((value == 0x06) && laser) stats.powerOffs++;
+			if (value == 0x02) fan = false;
+			if (value == 0x03) fan = true;
+			if (value == 0x06) laser = false;
+			if (value == 0x07) laser = true;
+		}
+		state = SIM_ALPHA_IDLE;
+		return 0x03;
+	}
+
+	if ((value != 0x03) && (value != 0x30) && (value != 0x32)){			//Not a command
+		state = SIM_ALPHA_IDLE;
+		return 0x00;
+	}
+
+	uint64_t now = simMicros();
+	if ((state != SIM_ALPHA_BUSY) || (pendingCommand != value)){		//A new command is busy first
+		state = SIM_ALPHA_BUSY;
+		pendingCommand = value;
+		busyTime = now;
+		return 0x31;
+	}
+	if ((mode == SIM_DROPOUT) || ((now - busyTime) < SIM_ALPHA_READY)) return 0x31;
+
+	if (value == 0x03) state = SIM_ALPHA_CONTROL;
+	else {
+		if (value == 0x30) histogram(mode == SIM_CORRUPT);
+		else pm(mode == SIM_CORRUPT);
+		state = SIM_ALPHA_DATA;
+		outAt = 0;
+	}
+	return 0xF3;
+}
+
+void SimAlpha::histogram(bool corrupt){									//Counts since the last histogram read, which resets them
+	uint64_t now = simMicros();
+	float period = (now - lastReset)/1e6;
+	lastReset = now;
+	if ((faults.mode() == SIM_FROZEN) && heldLen){						//The same histogram again, and the new counts are lost
+		memcpy(out, heldOut, heldLen);
+		outLen = heldLen;
+		stats.frames++;
+		return;
+	}
+	float c = laser ? simAerosol() : 0;
+	float flow = 5.5;													//Sample flow (ml/s)
+	float pm[3] = {c*0.1f, c*0.15f, c*0.2f};
+	uint16_t temp = clampU16((-20 + 45)/175.0*65535);					//-20 C, 30 percent
+	uint16_t humid = clampU16(0.3*65535);
+	uint8_t nBins = (model == SIM_R1) ? 16 : 24;
+
+	memset(out, 0, sizeof(out));
+	float share = 0.5;
+	for (uint8_t i = 0; i < nBins; i++){								//Each bin has half the counts of the one below. The part counts
+		float expected = c*flow*period*share + carry[i];				//are carried to the next read, so short and long histograms
+		uint16_t count = clampU16(expected);							//count at the same rate.
+		carry[i] = expected - count;
+		memcpy(&out[i*2], &count, 2);
+		share *= 0.5;
+	}
+	memset(&out[nBins*2], 20, 4);										//Bin times
+
+	if (model == SIM_R1){
+		memcpy(&out[36], &flow, 4);
+		memcpy(&out[40], &temp, 2);
+		memcpy(&out[42], &humid, 2);
+		memcpy(&out[44], &period, 4);
+		memcpy(&out[50], pm, 12);
+		outLen = 64;
+	} else {
+		uint16_t periodCs = clampU16(period*100);						//Centiseconds
+		uint16_t flowCs = clampU16(flow*100);
+		memcpy(&out[52], &periodCs, 2);
+		memcpy(&out[54], &flowCs, 2);
+		memcpy(&out[56], &temp, 2);
+		memcpy(&out[58], &humid, 2);
+		memcpy(&out[60], pm, 12);
+		uint16_t fanRevs = fan ? 1000 : 0;
+		uint16_t laserStatus = laser ? 600 : 0;
+		memcpy(&out[80], &fanRevs, 2);
+		memcpy(&out[82], &laserStatus, 2);
+		outLen = 86;
+	}
+
+	uint16_t crc = crcA001(out, outLen - 2);
+	memcpy(&out[outLen - 2], &crc, 2);
+	if (corrupt){
+		out[0] ^= 0x01;
+		stats.corrupt++;
+	} else {
+		memcpy(heldOut, out, outLen);
+		heldLen = outLen;
+		stats.frames++;
+	}
+}
+
+void SimAlpha::pm(bool corrupt){										//PM values only. The histogram keeps counting.
+	float c = laser ? faults.aerosol() : 0;
+	float values[3] = {c*0.1f, c*0.15f, c*0.2f};
+	memcpy(out, values, 12);
+	uint16_t crc = crcA001(out, 12);
+	memcpy(&out[12], &crc, 2);
+	outLen = 14;
+	if (corrupt){
+		out[0] ^= 0x01;
+		stats.corrupt++;
+	} else stats.frames++;
+}
@@ -0,0 +1,184 @@
+//Optical Particle Counter Library
+
+//University of Minnesota - Candler MURI
+
+/*This is the header file for the simulated sensors of the flight simulator.
+Each model speaks the same protocol as the real sensor, closely enough that
+the library can not tell the difference:
+ - SimPlantower: 42 4D frames once a second in active mode, or one for each
+   read command in passive mode, and the power and mode commands
+ - SimSPS: SHDLC frames over UART, in either output format, with byte stuffing
+ - SimHPM: the 68 01 commands, the A5 A5 acknowledgement, and the read response
+ - SimAlpha: the R1 or N3 on SPI. Command bytes get the busy (0x31) and then
+   ready (0xF3) answer, 10 ms apart, and the handshake starts over whenever the
+   slave select pin goes high.
+
+Frames are made when the library looks for them, from the virtual clock, so
+nothing runs in the background. The serial models hold at most 64 received
+bytes, like the Teensy buffer. Bytes that arrive while it is full are lost.
+
+Every model has a fault schedule. Each entry is a stretch of flight time (in
+milliseconds from the start of the simulation) and one of the modes below.
+A frozen model acts like a sensor that has stopped updating inside: it keeps
+sending good frames, with the values it had when the fault began.
+*/
+
+
+#ifndef SimDevices_h
+#define SimDevices_h
+
+#include "arduino.h"
+#include "SPI.h"
+#include "SimClock.h"
+#include <deque>
+#include <vector>
+
+#define SIM_NORMAL 0													//Fault modes
+#define SIM_DROPOUT 1													//Commands are answered, but no data comes. On SPI, the sensor stays busy.
+#define SIM_CORRUPT 2													//Data comes with a bad checksum
+#define SIM_UNRESPONSIVE 3												//Nothing is answered. On SPI, the bus reads back zeros.
+#define SIM_FROZEN 4													//Data comes with a good checksum, but it is the same as when the fault began
+
+#define SIM_MAX_FAULTS 8
+#define SIM_RX_BUFFER 64												//Serial receive buffer size
+
+#define SIM_R1 0														//SimAlpha models
+#define SIM_N3 1
+
+
+float simAerosol();														//Particles per cubic centimeter at the current flight time
+void simSetFlat(float concentration);									//Hold the aerosol still at a concentration, 0 for the flight profile
+
+class SimFaults															//Fault schedule of one model
+{
+	private:
+	struct SimFault{
+		unsigned long start, end;										//Flight time (ms)
+		uint8_t mode;
+	} list[SIM_MAX_FAULTS];
+	uint8_t n;
+	bool holding;														//A frozen fault has begun
+	float held;															//Concentration when it began
+
+	public:
+	SimFaults() : n(0), holding(false), held(0) {}
+	bool add(unsigned long startMs, unsigned long endMs, uint8_t mode);	//Returns false if the schedule is full
+	uint8_t mode();														//Mode at the current flight time
+	float aerosol();													//simAerosol(), held still while the model is frozen
+};
+
+struct SimStats															//What each model saw and sent
+{
+	unsigned long frames;												//Good data frames sent
+	unsigned long corrupt;												//Data frames sent with a bad checksum
+	unsigned long commands;												//Commands received
+	unsigned long powerOffs;											//Power off commands received
+	unsigned long overruns;												//Bytes lost to a full receive buffer
+};
+
+
+
+class SimSerialDevice: public Stream									//Base of the UART models
+{
+	private:
+	struct SimPending{
+		uint64_t due;													//Virtual time the bytes finish arriving (us)
+		std::vector<uint8_t> bytes;
+	};
+	std::deque<uint8_t> rx;												//Receive buffer of the microcontroller
+	std::deque<SimPending> pending;										//Bytes still on the wire
+	void deliver();														//Move the bytes that have arrived into the buffer
+
+	protected:
+	virtual void service() {}											//Make the data frames that are due
+	virtual void receive(uint8_t value) = 0;							//A byte from the microcontroller
+	void send(const uint8_t *bytes, size_t len, uint64_t due);			//Bytes that finish arriving at a virtual time (us)
+	void clear();														//Drop everything on the wire (power off)
+
+	public:
+	SimFaults faults;
+	SimStats stats;
+
+	SimSerialDevice();
+	size_t write(uint8_t value);
+	using Print::write;
+	int available();
+	int read();
+	int peek();
+};
+
+class SimPlantower: public SimSerialDevice
+{
+	private:
+	uint8_t command[7];													//Command being received
+	uint8_t at;
+	bool powered, active;
+	uint64_t nextFrame;													//Virtual time of the next frame (us)
+	void service();
+	void receive(uint8_t value);
+	void sendFrame(uint64_t due);										//Data frame, finishing at the given time
+
+	public:
+	SimPlantower();
+};
+
+class SimSPS: public SimSerialDevice
+{
+	private:
+	std::vector<uint8_t> frame;											//Command frame being received, unstuffed
+	bool inFrame, escaped;
+	bool running;
+	uint8_t format;														//Output format from the start command
+	uint64_t lastSent;													//Number of the last measurement sent
+	void receive(uint8_t value);
+	void reply(uint8_t cmd, const uint8_t *data, uint8_t len, bool corrupt);
+
+	public:
+	SimSPS();
+};
+
+class SimHPM: public SimSerialDevice
+{
+	private:
+	uint8_t command[4];
+	uint8_t at;
+	bool measuring, autoSend;
+	uint64_t nextFrame;
+	void service();
+	void receive(uint8_t value);
+
+	public:
+	SimHPM();
+};
+
+
+
+class SimAlpha: public SimSPIDevice										//Alphasense R1 or N3
+{
+	private:
+	uint8_t model;														//SIM_R1 or SIM_N3
+	uint8_t state;														//Where the handshake is
+	uint8_t pendingCommand;												//Command byte being answered
+	uint64_t busyTime;													//Virtual time of the busy answer (us)
+	uint8_t out[96];													//Data being clocked out
+	uint8_t outLen, outAt;
+	uint8_t heldOut[96];												//Last good histogram, sent again while frozen
+	uint8_t heldLen;
+	bool fan, laser;
+	uint64_t lastReset;													//Virtual time the histogram was last read and reset (us)
+	float carry[24];													//Part counts left over from the last histogram of each bin
+	void histogram(bool corrupt);										//Make the 0x30 response
+	void pm(bool corrupt);												//Make the 0x32 response
+
+	public:
+	SimFaults faults;
+	SimStats stats;
+
+	SimAlpha(uint8_t type);
+	uint8_t transfer(uint8_t value);
+	void select(bool selected);
+	bool isLaserOn();
+	bool isFanOn();
+};
+
+#endif
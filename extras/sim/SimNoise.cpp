@@ -0,0 +1,146 @@
+//Optical Particle Counter Library
+
+//University of Minnesota - Candler MURI
+
+/*This is the definitions file for the fault-injecting transports of the
+flight simulator. See SimNoise.h.*/
+
+#include "SimNoise.h"
+
+
+
+//////////NOISE//////////
+
+
+
+SimNoise::SimNoise(){
+	setSeed(1);
+	setRates(0);
+	resetStats();
+}
+
+void SimNoise::setRates(float bitError, float drop, float insert, float truncate){
+	rates.bitError = bitError;
+	rates.drop = drop;
+	rates.insert = insert;
+	rates.truncate = truncate;
+}
+
+void SimNoise::setSeed(uint32_t seed){ state = seed ? seed : 1; }
+
+uint32_t SimNoise::random32(){											//xorshift32
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+
+bool SimNoise::chance(float rate){
+	if (rate <= 0) return false;
+	return (random32() < rate*4294967296.0);
+}
+
+uint8_t SimNoise::randomByte(){ return random32() >> 24; }
+
+uint8_t SimNoise::flip(uint8_t value){
+	if (rates.bitError <= 0) return value;
+	uint8_t mask = 0;
+	for (uint8_t bit = 0; bit < 8; bit++){
+		if (chance(rates.bitError)) mask |= (1 << bit);
+	}
+	if (mask) stats.flipped++;
+	return value ^ mask;
+}
+
+unsigned long SimNoise::errors(){ return stats.flipped + stats.dropped + stats.inserted + stats.truncations; }
+
+void SimNoise::resetStats(){ memset(&stats, 0, sizeof(stats)); }
+
+
+
+//////////SERIAL//////////
+
+
+
+SimNoisyStream::SimNoisyStream(Stream *sensor){
+	inner = sensor;
+	skip = 0;
+}
+
+void SimNoisyStream::pull(){											//The buffer holds 64 bytes, like the model under it
+	while (inner->available() > 0){
+		uint8_t value = inner->read();
+		stats.bytes++;
+
+		if (skip > 0){													//Inside a truncation
+			skip--;
+			stats.lost++;
+			continue;
+		}
+		if (chance(rates.truncate)){
+			stats.truncations++;
+			stats.lost++;
+			skip = randomByte() & 0x1F;
+			continue;
+		}
+		if (chance(rates.drop)){
+			stats.dropped++;
+			continue;
+		}
+		if (chance(rates.insert) && (rx.size() < SIM_RX_BUFFER)){
+			rx.push_back(randomByte());
+			stats.inserted++;
+		}
+		if (rx.size() < SIM_RX_BUFFER) rx.push_back(flip(value));
+	}
+}
+
+size_t SimNoisyStream::write(uint8_t value){ return inner->write(value); }
+
+int SimNoisyStream::available(){
+	pull();
+	return rx.size();
+}
+
+int SimNoisyStream::read(){
+	if (!available()) return -1;
+	uint8_t value = rx.front();
+	rx.pop_front();
+	stats.delivered++;
+	return value;
+}
+
+int SimNoisyStream::peek(){
+	if (!available()) return -1;
+	return rx.front();
+}
+
+
+
+//////////SPI//////////
+
+
+
+SimNoisySPI::SimNoisySPI(SimSPIDevice *sensor){ inner = sensor; }
+
+void SimNoisySPI::select(bool selected){ inner->select(selected); }
+
+uint8_t SimNoisySPI::transfer(uint8_t value){							//Every transfer clocks one byte back, so a drop or insertion
+	stats.bytes++;														//slips the rest of the response by one byte
+	stats.delivered++;
+
+	if (chance(rates.truncate)){										//The sensor loses the slave select
+		stats.truncations++;
+		inner->select(false);
+		return 0x00;
+	}
+	if (chance(rates.insert)){											//An extra byte: the sensor does not move on
+		stats.inserted++;
+		return randomByte();
+	}
+	if (chance(rates.drop)){											//A lost byte: the sensor moves on twice
+		stats.dropped++;
+		inner->transfer(value);
+	}
+	return flip(inner->transfer(value));
+}
@@ -0,0 +1,99 @@
+//Optical Particle Counter Library
+
+//University of Minnesota - Candler MURI
+
+/*This is the header file for the fault-injecting transports of the flight
+simulator. A SimNoisyStream sits between a serial model and the library, and
+a SimNoisySPI sits between an SPI model and the bus. Each byte coming back
+from the sensor can be hit by line noise:
+ - bit errors: every bit is flipped with the bit error rate
+ - drops: the byte is lost
+ - insertions: a random byte shows up before it
+ - truncations: the rest of the frame is lost. On serial, a run of up to 32
+   bytes is dropped. On SPI, the sensor is deselected, as if the line glitched.
+
+The rates other than the bit error rate are per byte. The commands sent to the
+sensor are not touched, so only the decoders of the library are tested. The
+random numbers come from a seeded generator, so every run is the same.
+*/
+
+
+#ifndef SimNoise_h
+#define SimNoise_h
+
+#include "arduino.h"
+#include "SPI.h"
+#include "SimDevices.h"
+
+struct SimNoiseRates
+{
+	float bitError;														//Chance each bit is flipped
+	float drop;															//Chance each byte is lost
+	float insert;														//Chance of a random byte before each byte
+	float truncate;														//Chance each byte ends the frame
+};
+
+struct SimNoiseStats
+{
+	unsigned long bytes;												//Bytes that went through
+	unsigned long flipped;												//Bytes with at least one flipped bit
+	unsigned long dropped;												//Single bytes lost
+	unsigned long inserted;
+	unsigned long truncations;
+	unsigned long lost;													//Bytes lost to truncations
+	unsigned long delivered;											//Bytes the library read
+};
+
+class SimNoise															//Noise source shared by both transports
+{
+	private:
+	uint32_t state;
+	uint32_t random32();
+
+	protected:
+	bool chance(float rate);
+	uint8_t randomByte();
+	uint8_t flip(uint8_t value);										//Apply the bit error rate to a byte
+
+	public:
+	SimNoiseRates rates;
+	SimNoiseStats stats;
+
+	SimNoise();
+	void setRates(float bitError, float drop = 0, float insert = 0, float truncate = 0);
+	void setSeed(uint32_t seed);
+	unsigned long errors();												//Number of error events injected
+	void resetStats();
+};
+
+
+
+class SimNoisyStream: public Stream, public SimNoise
+{
+	private:
+	Stream *inner;
+	std::deque<uint8_t> rx;												//Bytes that made it through, as the library sees them
+	unsigned int skip;													//Bytes left in a truncation
+	void pull();														//Run the bytes from the model through the noise
+
+	public:
+	SimNoisyStream(Stream *sensor);
+	size_t write(uint8_t value);
+	using Print::write;
+	int available();
+	int read();
+	int peek();
+};
+
+class SimNoisySPI: public SimSPIDevice, public SimNoise
+{
+	private:
+	SimSPIDevice *inner;
+
+	public:
+	SimNoisySPI(SimSPIDevice *sensor);
+	uint8_t transfer(uint8_t value);
+	void select(bool selected);
+};
+
+#endif
@@ -0,0 +1,149 @@
+//Optical Particle Counter Library
+
+//University of Minnesota - Candler MURI
+
+/*This is the stand-in for the Arduino core used by the flight simulator.
+It has only what the library uses: the clock, the pins, String, Print,
+Stream, and Serial. The clock is virtual. delay() moves it forward right away
+and records the wait, so hours of flight run in seconds. See SimClock.h.
+*/
+
+
+#ifndef SimArduino_h
+#define SimArduino_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+
+typedef uint8_t byte;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define DEC 10
+#define HEX 16
+#define PI 3.1415926535897932384626433832795
+#define PROGMEM
+#define PSTR(text) (text)
+#define F(text) (text)
+#define pgm_read_byte(address) (*(const uint8_t *)(address))
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+uint8_t digitalRead(uint8_t pin);
+
+
+
+class String															//Arduino String on top of std::string
+{
+	private:
+	std::string text;
+	void number(unsigned long long value, bool negative, unsigned char base);
+
+	public:
+	String() {}
+	String(const char *value) : text(value ? value : "") {}
+	String(const std::string &value) : text(value) {}
+	String(char value) : text(1, value) {}
+	String(unsigned char value, unsigned char base = DEC);
+	String(int value, unsigned char base = DEC);
+	String(unsigned int value, unsigned char base = DEC);
+	String(long value, unsigned char base = DEC);
+	String(unsigned long value, unsigned char base = DEC);
+	String(float value, unsigned char decimals = 2);
+	String(double value, unsigned char decimals = 2);
+
+	String &operator+=(const String &other) { text += other.text; return *this; }
+	String &operator+=(const char *other) { text += other; return *this; }
+	String &operator+=(char other) { text += other; return *this; }
+	friend String operator+(const String &a, const String &b) { return String(a.text + b.text); }
+	friend String operator+(const String &a, const char *b) { return String(a.text + b); }
+	friend String operator+(const char *a, const String &b) { return String(std::string(a) + b.text); }
+	friend String operator+(const String &a, char b) { return String(a.text + b); }
+	friend String operator+(char a, const String &b) { return String(std::string(1, a) + b.text); }
+	bool operator==(const String &other) const { return text == other.text; }
+
+	unsigned int length() const { return text.size(); }
+	const char *c_str() const { return text.c_str(); }
+	bool reserve(unsigned int size) { text.reserve(size); return true; }
+	char charAt(unsigned int index) const { return (index < text.size()) ? text[index] : 0; }
+	int indexOf(char value, unsigned int from = 0) const;
+	String substring(unsigned int from, unsigned int to) const;
+	String substring(unsigned int from) const { return substring(from, text.size()); }
+	long toInt() const { return atol(text.c_str()); }
+	float toFloat() const { return atof(text.c_str()); }
+};
+
+
+
+class Print
+{
+	public:
+	virtual ~Print() {}
+	virtual size_t write(uint8_t value) = 0;
+	virtual size_t write(const uint8_t *buffer, size_t size);
+	size_t write(const char *text) { return write((const uint8_t *)text, strlen(text)); }
+	size_t write(int value) { return write((uint8_t)value); }
+	virtual int availableForWrite() { return 64; }
+	virtual void flush() {}
+
+	size_t print(const String &value) { return write((const uint8_t *)value.c_str(), value.length()); }
+	size_t print(const char *value) { return write(value); }
+	size_t print(char value) { return write((uint8_t)value); }
+	size_t print(unsigned char value, int base = DEC) { return print((unsigned long)value, base); }
+	size_t print(int value, int base = DEC) { return print((long)value, base); }
+	size_t print(unsigned int value, int base = DEC) { return print((unsigned long)value, base); }
+	size_t print(long value, int base = DEC);
+	size_t print(unsigned long value, int base = DEC);
+	size_t print(double value, int decimals = 2) { return print(String(value, (unsigned char)decimals)); }
+	size_t println() { return write("\r\n"); }
+	template <typename T> size_t println(T value) { size_t n = print(value); return n + println(); }
+	template <typename T> size_t println(T value, int format) { size_t n = print(value, format); return n + println(); }
+};
+
+
+
+class Stream: public Print
+{
+	public:
+	virtual int available() = 0;
+	virtual int read() = 0;
+	virtual int peek() = 0;
+	size_t readBytes(uint8_t *buffer, size_t length);
+	size_t readBytes(char *buffer, size_t length) { return readBytes((uint8_t *)buffer, length); }
+};
+
+
+
+class SimConsole: public Stream											//Serial monitor. Output is dropped unless echo is on.
+{
+	private:
+	bool echo;
+	unsigned long written;
+
+	public:
+	SimConsole() : echo(false), written(0) {}
+	void begin(unsigned long baud) {}
+	void setEcho(bool on) { echo = on; }
+	unsigned long getWritten() { return written; }
+	size_t write(uint8_t value);
+	using Print::write;
+	int available() { return 0; }
+	int read() { return -1; }
+	int peek() { return -1; }
+	operator bool() { return true; }
+};
+
+extern SimConsole Serial;
+
+#endif
@@ -0,0 +1,129 @@
+//Optical Particle Counter Library
+
+//University of Minnesota - Candler MURI
+
+/*This is the fleet benchmark. Four SPS 30s and four Plantowers in passive
+mode, each on its own simulated port, are read once a second, first one
+sensor at a time (request, then wait for the answer), then with an OPCFleet
+(every request, then the answers in any order). The loop polls every 100 us.
+
+For each way it reports the good samples, the average and longest cycle, and
+for the fleet the average and longest lag of each sensor. The cycle of the
+fleet should be about one response time, where the one at a time cycle is
+the sum of them. After each fleet cycle every sensor is logged, and the logs
+must use the collected samples.
+
+Usage: fleetbench [cycles]
+ - cycles: reads of the whole fleet for each way (default 600)
+*/
+
+#include "OPCSensor.h"
+#include "OPCFleet.h"
+#include "SimDevices.h"
+
+#define BENCH_SPS 4
+#define BENCH_PMS 4
+#define BENCH_SENSORS (BENCH_SPS + BENCH_PMS)
+#define BENCH_POLL 100													//Time between polls of the loop (us)
+
+struct BenchCycles{
+	unsigned long good;
+	uint64_t total;														//Sum of the cycle times (us)
+	unsigned long longest;
+};
+
+static void addCycle(BenchCycles &cycles, unsigned long length){
+	cycles.total += length;
+	if (length > cycles.longest) cycles.longest = length;
+}
+
+static void printCycles(const char *name, BenchCycles &cycles, unsigned long n){
+	printf("%-14s %8lu good  %8.2f ms average  %8.2f ms longest\n", name, cycles.good,
+		   cycles.total/1000.0/n, cycles.longest/1000.0);
+}
+
+static void waitSecond(uint64_t start){									//Cycles start once a second, as in the flight code
+	uint64_t next = start + 1000000;
+	if (simMicros() < next) simAdvanceMicros(next - simMicros());
+}
+
+int main(int argc, char **argv){
+	unsigned long n = (argc > 1) ? atol(argv[1]) : 600;
+
+	SimSPS spsModels[BENCH_SPS];
+	SimPlantower pmsModels[BENCH_PMS];
+	SPS *sps[BENCH_SPS];
+	Plantower *pms[BENCH_PMS];
+	OPC *sensors[BENCH_SENSORS];
+	for (uint8_t i = 0; i < BENCH_SPS; i++){
+		sps[i] = new SPS(&spsModels[i]);
+		sps[i]->initOPC();
+		sensors[i] = sps[i];
+	}
+	for (uint8_t i = 0; i < BENCH_PMS; i++){
+		pms[i] = new Plantower(&pmsModels[i], 1000);
+		pms[i]->initOPC();
+		pms[i]->passiveMode();
+		sensors[BENCH_SPS + i] = pms[i];
+	}
+	simAdvance(1000);
+
+	BenchCycles serial = {0, 0, 0};										//One sensor at a time
+	for (unsigned long c = 0; c < n; c++){
+		uint64_t start = simMicros();
+		for (uint8_t i = 0; i < BENCH_SENSORS; i++){
+			uint64_t asked = simMicros();
+			sensors[i]->requestData();
+			uint8_t state = OPC_COLLECT_WAITING;
+			while ((state = sensors[i]->collectData()) == OPC_COLLECT_WAITING){
+				if (simMicros() - asked >= 1000000) break;
+				simAdvanceMicros(BENCH_POLL);
+			}
+			if (state == OPC_COLLECT_GOOD) serial.good++;
+		}
+		addCycle(serial, simMicros() - start);
+		waitSecond(start);
+	}
+
+	OPCFleet fleet;														//Every request, then every answer
+	for (uint8_t i = 0; i < BENCH_SENSORS; i++) fleet.addSensor(*sensors[i]);
+	BenchCycles parallel = {0, 0, 0};
+	uint64_t lags[BENCH_SENSORS] = {0};
+	unsigned long logged = 0;
+	char line[OPC_LINE_SIZE];
+	for (unsigned long c = 0; c < n; c++){
+		uint64_t start = simMicros();
+		fleet.request();
+		while (!fleet.update()) simAdvanceMicros(BENCH_POLL);
+		parallel.good += fleet.getGood();
+		addCycle(parallel, fleet.getCycleTime());
+		for (uint8_t i = 0; i < BENCH_SENSORS; i++) lags[i] += fleet.getLag(i);
+
+		for (uint8_t i = 0; i < BENCH_SPS; i++){						//Each log takes the collected sample
+			int hits = sps[i]->getTot();
+			sps[i]->logLine(line, sizeof(line));
+			if (sps[i]->getTot() != hits) logged++;
+		}
+		for (uint8_t i = 0; i < BENCH_PMS; i++){
+			int hits = pms[i]->getTot();
+			pms[i]->logLine(line, sizeof(line));
+			if (pms[i]->getTot() != hits) logged++;
+		}
+		waitSecond(start);
+	}
+
+	printf("%lu cycles of %d SPS and %d Plantowers, polled every %d us\n\n", n, BENCH_SPS, BENCH_PMS, BENCH_POLL);
+	printCycles("One at a time", serial, n);
+	printCycles("Fleet", parallel, n);
+	printf("Speedup        %8.2fx\n", (double)serial.total/parallel.total);
+	printf("Fleet logs     %8lu of %lu good samples\n\n", logged, parallel.good);
+
+	printf("%-14s %12s %12s %8s\n", "Sensor", "Average lag", "Longest lag", "Missed");
+	for (uint8_t i = 0; i < BENCH_SENSORS; i++){
+		char name[16];
+		if (i < BENCH_SPS) snprintf(name, sizeof(name), "SPS %d", i + 1);
+		else snprintf(name, sizeof(name), "Plantower %d", i - BENCH_SPS + 1);
+		printf("%-14s %9.2f ms %9.2f ms %8lu\n", name, lags[i]/1000.0/n, fleet.getMaxLag(i)/1000.0, (unsigned long)fleet.getMissed(i));
+	}
+	return 0;
+}
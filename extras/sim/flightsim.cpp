@@ -0,0 +1,176 @@
+//Optical Particle Counter Library
+
+//University of Minnesota - Candler MURI
+
+/*This is the flight simulator. It runs every sensor class against its
+simulated sensor on the virtual clock, with a loop like the flight code: the
+Plantower is read every 10 ms, and every sensor is logged once a second.
+
+The fault schedule below trips each recovery path of the library at least
+once: the quality flag after five bad logs, the 20 minute reset, the retry
+policy on commands that are never answered, the checksums, and the stale frame
+check on a sensor that keeps sending the same good frame.
+
+After the flight, an R1 and an N3 in ALPHA_READ_PM mode are logged for half an
+hour in a flat aerosol. Their PM-only frames repeat exactly, as in steady air,
+and none of them should be thrown out as stale.
+
+Usage: flightsim [hours] [--console]
+ - hours: length of the flight (default 3)
+ - --console: echo what the library prints to Serial
+*/
+
+#include "OPCSensor.h"
+#include "OPCStartup.h"
+#include "SimDevices.h"
+
+#define R1_PIN 10
+#define N3_PIN 9
+#define FLAT_R1_PIN 8
+#define FLAT_N3_PIN 7
+#define MINUTES(m) ((m)*60000UL)
+
+struct FlightSensor{													//Log counts for one sensor
+	const char *name;
+	const char *call;													//Name in the blocking report
+	OPC *sensor;
+	SimStats *stats;
+	unsigned long good, bad, drops;
+	bool quality;
+};
+
+template <typename T> void logOnce(T &sensor, FlightSensor &entry){	//.logUpdate() is not virtual, so each class is called directly
+	int hits = sensor.getTot();
+	simBegin(entry.call);
+	sensor.logUpdate();
+	simEnd();
+
+	if (sensor.getTot() != hits) entry.good++;
+	else entry.bad++;
+	if (!entry.good) return;											//The quality flag starts low until the first good log
+	bool quality = sensor.getLogQuality();
+	if (quality != entry.quality){										//Every change of the quality flag is listed as it happens
+		if (!quality) entry.drops++;
+		printf("  %s  %-10s quality %s\n", simClockString(simMicros()).c_str(), entry.name, quality ? "restored" : "lost");
+	}
+	entry.quality = quality;
+}
+
+int main(int argc, char **argv){
+	float hours = 3;
+	for (int i = 1; i < argc; i++){
+		if (!strcmp(argv[i], "--console")) Serial.setEcho(true);
+		else hours = atof(argv[i]);
+	}
+	uint64_t flightEnd = (uint64_t)(hours*3.6e9);
+
+	SimPlantower pmsModel;												//The sensors
+	SimSPS spsModel;
+	SimHPM hpmModel;
+	SimAlpha r1Model(SIM_R1);
+	SimAlpha n3Model(SIM_N3);
+	SPI.attach(R1_PIN, &r1Model);
+	SPI.attach(N3_PIN, &n3Model);
+
+	pmsModel.faults.add(MINUTES(30), MINUTES(55), SIM_DROPOUT);			//Long enough to trip the 20 minute reset
+	spsModel.faults.add(MINUTES(40), MINUTES(45), SIM_CORRUPT);
+	spsModel.faults.add(MINUTES(100), MINUTES(125), SIM_UNRESPONSIVE);
+	spsModel.faults.add(MINUTES(150), MINUTES(175), SIM_FROZEN);		//Good frames that never change, long enough to trip the reset
+	hpmModel.faults.add(MINUTES(60), MINUTES(61), SIM_DROPOUT);			//Only the quality flag
+	r1Model.faults.add(MINUTES(70), MINUTES(95), SIM_UNRESPONSIVE);
+	n3Model.faults.add(MINUTES(20), MINUTES(22), SIM_CORRUPT);
+	n3Model.faults.add(MINUTES(130), MINUTES(155), SIM_DROPOUT);		//Busy the whole time, so every command runs out its retries
+
+	Plantower pms(&pmsModel, 1000);										//The library
+	SPS sps(&spsModel);
+	HPM hpm(&hpmModel);
+	R1 r1(R1_PIN);
+	N3 n3(N3_PIN);
+
+	FlightSensor sensors[5] = {
+		{"Plantower", "Plantower.logUpdate", &pms, &pmsModel.stats, 0, 0, 0, true},
+		{"SPS", "SPS.logUpdate", &sps, &spsModel.stats, 0, 0, 0, true},
+		{"HPM", "HPM.logUpdate", &hpm, &hpmModel.stats, 0, 0, 0, true},
+		{"R1", "R1.logUpdate", &r1, &r1Model.stats, 0, 0, 0, true},
+		{"N3", "N3.logUpdate", &n3, &n3Model.stats, 0, 0, 0, true}};
+
+	OPCStartup startup;													//Startup, polled from a loop as the flight code would
+	for (uint8_t i = 0; i < 5; i++) startup.addSensor(*sensors[i].sensor);
+	simBegin("startup.begin");
+	startup.begin();
+	simEnd();
+	while (true){
+		simBegin("startup.update");
+		bool done = startup.update();
+		simEnd();
+		if (done) break;
+		simAdvance(1);
+	}
+
+	printf("Startup: %lu ms, %lu SPI contentions, %lu nested transactions\n", startup.getStartupTime(), SPI.getContentions(), SPI.getNested());
+	const char *states[3] = {"busy", "ready", "failed"};
+	for (uint8_t i = 0; i < 5; i++){
+		printf("  %-10s %-6s %6lu ms\n", sensors[i].name, states[startup.getState(i)], startup.getReadyTime(i));
+	}
+	printf("  R1 laser %s, N3 fan %s, N3 laser %s\n", r1Model.isLaserOn() ? "on" : "off", n3Model.isFanOn() ? "on" : "off",
+		   n3Model.isLaserOn() ? "on" : "off");
+	printf("\n");
+
+	printf("Events\n");
+	uint64_t nextLog = simMicros();										//The flight loop
+	while (simMicros() < flightEnd){
+		simBegin("Plantower.readData");
+		pms.readData();
+		simEnd();
+
+		if (simMicros() >= nextLog){
+			nextLog += 1000000;
+			logOnce(pms, sensors[0]);
+			logOnce(sps, sensors[1]);
+			logOnce(hpm, sensors[2]);
+			logOnce(r1, sensors[3]);
+			logOnce(n3, sensors[4]);
+			if (nextLog < simMicros()) nextLog = simMicros();			//A long block skips the logs it missed
+		}
+		simAdvance(10);
+	}
+
+	printf("\nFlight: %s\n\n", simClockString(simMicros()).c_str());
+	printf("%-10s %8s %8s %14s %10s %8s %8s %8s %9s\n", "sensor", "good", "bad", "quality drops", "power offs", "frames", "corrupt", "stale",
+		   "overruns");
+	for (uint8_t i = 0; i < 5; i++){
+		FlightSensor &entry = sensors[i];
+		printf("%-10s %8lu %8lu %14lu %10lu %8lu %8lu %8lu %9lu\n", entry.name, entry.good, entry.bad, entry.drops, entry.stats->powerOffs,
+			   entry.stats->frames, entry.stats->corrupt, (unsigned long)entry.sensor->getStaleFrames(), entry.stats->overruns);
+	}
+	printf("SPI contentions: %lu, nested transactions: %lu\n\n", SPI.getContentions(), SPI.getNested());
+	simReport(stdout);
+
+	SimAlpha flatR1Model(SIM_R1);										//Steady air: every PM-only frame is the same
+	SimAlpha flatN3Model(SIM_N3);
+	SPI.attach(FLAT_R1_PIN, &flatR1Model);
+	SPI.attach(FLAT_N3_PIN, &flatN3Model);
+	R1 flatR1(FLAT_R1_PIN);
+	N3 flatN3(FLAT_N3_PIN);
+	flatR1.initOPC();
+	flatN3.initOPC('f');
+	flatR1.setReadMode(ALPHA_READ_PM, 10000);
+	flatN3.setReadMode(ALPHA_READ_PM, 10000);
+	simSetFlat(5);
+
+	FlightSensor flat[2] = {
+		{"R1", "flat R1.logUpdate", &flatR1, &flatR1Model.stats, 0, 0, 0, true},
+		{"N3", "flat N3.logUpdate", &flatN3, &flatN3Model.stats, 0, 0, 0, true}};
+	uint64_t flatEnd = simMicros() + (uint64_t)MINUTES(30)*1000;
+	printf("\nFlat aerosol, ALPHA_READ_PM\n");
+	while (simMicros() < flatEnd){
+		logOnce(flatR1, flat[0]);
+		logOnce(flatN3, flat[1]);
+		simAdvance(1000);
+	}
+	printf("%-10s %8s %8s %8s\n", "sensor", "good", "bad", "stale");
+	for (uint8_t i = 0; i < 2; i++){
+		printf("%-10s %8lu %8lu %8lu\n", flat[i].name, flat[i].good, flat[i].bad, (unsigned long)flat[i].sensor->getStaleFrames());
+	}
+	return 0;
+}
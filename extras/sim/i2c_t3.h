@@ -0,0 +1,39 @@
+//Optical Particle Counter Library
+
+//University of Minnesota - Candler MURI
+
+/*This is the stand-in for the Teensy i2c_t3 library used by the flight
+simulator. No I2C devices are simulated, so every request comes back empty.
+*/
+
+
+#ifndef SimI2C_h
+#define SimI2C_h
+
+#include "arduino.h"
+
+enum i2c_mode {I2C_MASTER, I2C_SLAVE};
+enum i2c_pins {I2C_PINS_16_17, I2C_PINS_18_19, I2C_PINS_3_4, I2C_PINS_37_38, I2C_PINS_33_34};
+enum i2c_pullup {I2C_PULLUP_EXT, I2C_PULLUP_INT};
+enum i2c_rate {I2C_RATE_100, I2C_RATE_400};
+enum i2c_stop {I2C_NOSTOP, I2C_STOP};
+
+class i2c_t3: public Stream
+{
+	public:
+	void begin(i2c_mode mode, uint8_t address, i2c_pins pins, i2c_pullup pullup, i2c_rate rate) {}
+	void beginTransmission(uint8_t address) {}
+	uint8_t endTransmission(i2c_stop stop = I2C_STOP) { return 0; }
+	void sendRequest(uint8_t address, size_t length, i2c_stop stop) {}
+	void finish() {}
+	size_t write(uint8_t value) { return 1; }
+	using Print::write;
+	int available() { return 0; }
+	int read() { return -1; }
+	int peek() { return -1; }
+	uint8_t readByte() { return 0; }
+};
+
+extern i2c_t3 Wire;
+
+#endif
@@ -0,0 +1,197 @@
+//Optical Particle Counter Library
+
+//University of Minnesota - Candler MURI
+
+/*This is the line noise benchmark. Each decoder of the library reads its
+simulated sensor through a fault-injecting transport (SimNoise.h) for an hour
+of flight time, once for each noise profile. The Plantower is read every 10 ms,
+and the rest once a second, as in the flight code. The stale frame check is
+turned off, so only the line noise costs frames.
+
+For each run it reports:
+ - errors: error events injected on the line
+ - frames/s: good frames the decoder returned, per second of flight
+ - recovered: good frames as a share of the frames the sensor sent
+ - wasted/error: bytes read by the decoder that did not end up in a good
+   frame, per error. The waste of the clean run (empty responses, handshake
+   bytes) is taken out first, so this is the cost of each error alone.
+
+Usage: noisebench [minutes]
+ - minutes: flight time of each run (default 60)
+*/
+
+#include "OPCSensor.h"
+#include "SimDevices.h"
+#include "SimNoise.h"
+
+#define R1_PIN 10
+#define N3_PIN 9
+
+struct BenchProfile{
+	const char *name;
+	float bitError, drop, insert, truncate;
+};
+
+struct BenchResult{
+	unsigned long sent;													//Frames the sensor sent
+	unsigned long good;													//Frames the decoder returned
+	unsigned long errors;
+	unsigned long delivered;											//Bytes the decoder read
+};
+
+static unsigned long runTime = 3600;									//Flight time of each run (s)
+
+static void finish(BenchResult &result, SimNoise &line, SimStats &stats, unsigned long sentBefore){
+	result.sent = stats.frames - sentBefore;
+	result.errors = line.errors();
+	result.delivered = line.stats.delivered;
+}
+
+static BenchResult benchPlantower(const BenchProfile &p){
+	BenchResult result = {0, 0, 0, 0};
+	SimPlantower model;
+	SimNoisyStream line(&model);
+	Plantower pms(&line, 1000);
+	pms.initOPC();
+	pms.setStaleLimit(0);												//Line noise only, not a stuck sensor
+
+	line.setRates(p.bitError, p.drop, p.insert, p.truncate);			//The noise starts once the sensor is up
+	line.resetStats();
+	unsigned long sentBefore = model.stats.frames;
+	uint64_t end = simMicros() + runTime*1000000ULL;
+	while (simMicros() < end){
+		if (pms.readData()) result.good++;
+		simAdvance(10);
+	}
+	finish(result, line, model.stats, sentBefore);
+	return result;
+}
+
+static BenchResult benchSPS(const BenchProfile &p){
+	BenchResult result = {0, 0, 0, 0};
+	SimSPS model;
+	SimNoisyStream line(&model);
+	SPS sps(&line);
+	sps.initOPC();
+	sps.setStaleLimit(0);												//Line noise only, not a stuck sensor
+
+	line.setRates(p.bitError, p.drop, p.insert, p.truncate);
+	line.resetStats();
+	unsigned long sentBefore = model.stats.frames;
+	uint64_t end = simMicros() + runTime*1000000ULL;
+	while (simMicros() < end){
+		if (sps.readData()) result.good++;
+		simAdvance(1000);
+	}
+	finish(result, line, model.stats, sentBefore);
+	return result;
+}
+
+static BenchResult benchHPM(const BenchProfile &p){
+	BenchResult result = {0, 0, 0, 0};
+	SimHPM model;
+	SimNoisyStream line(&model);
+	HPM hpm(&line);
+	hpm.initOPC();
+	hpm.setStaleLimit(0);												//Line noise only, not a stuck sensor
+
+	line.setRates(p.bitError, p.drop, p.insert, p.truncate);
+	line.resetStats();
+	unsigned long sentBefore = model.stats.frames;
+	uint64_t end = simMicros() + runTime*1000000ULL;
+	while (simMicros() < end){
+		if (hpm.readData()) result.good++;
+		simAdvance(1000);
+	}
+	finish(result, line, model.stats, sentBefore);
+	return result;
+}
+
+static BenchResult benchR1(const BenchProfile &p){
+	BenchResult result = {0, 0, 0, 0};
+	SimAlpha model(SIM_R1);
+	SimNoisySPI line(&model);
+	SPI.attach(R1_PIN, &line);
+	R1 r1(R1_PIN);
+	r1.initOPC();
+	r1.setStaleLimit(0);												//Line noise only, not a stuck sensor
+
+	line.setRates(p.bitError, p.drop, p.insert, p.truncate);
+	line.resetStats();
+	unsigned long sentBefore = model.stats.frames;
+	uint64_t end = simMicros() + runTime*1000000ULL;
+	while (simMicros() < end){
+		if (r1.readData()) result.good++;
+		simAdvance(1000);
+	}
+	finish(result, line, model.stats, sentBefore);
+	SPI.attach(R1_PIN, NULL);
+	return result;
+}
+
+static BenchResult benchN3(const BenchProfile &p){
+	BenchResult result = {0, 0, 0, 0};
+	SimAlpha model(SIM_N3);
+	SimNoisySPI line(&model);
+	SPI.attach(N3_PIN, &line);
+	N3 n3(N3_PIN);
+	n3.initOPC('d');
+	n3.setStaleLimit(0);												//Line noise only, not a stuck sensor
+
+	line.setRates(p.bitError, p.drop, p.insert, p.truncate);
+	line.resetStats();
+	unsigned long sentBefore = model.stats.frames;
+	uint64_t end = simMicros() + runTime*1000000ULL;
+	while (simMicros() < end){
+		if (n3.readData()) result.good++;
+		simAdvance(1000);
+	}
+	finish(result, line, model.stats, sentBefore);
+	SPI.attach(N3_PIN, NULL);
+	return result;
+}
+
+int main(int argc, char **argv){
+	if (argc > 1) runTime = atof(argv[1])*60;
+
+	const BenchProfile profiles[] = {
+		{"clean", 0, 0, 0, 0},
+		{"BER 1e-5", 1e-5, 0, 0, 0},
+		{"BER 1e-4", 1e-4, 0, 0, 0},
+		{"BER 1e-3", 1e-3, 0, 0, 0},
+		{"drop 1e-3", 0, 1e-3, 0, 0},
+		{"insert 1e-3", 0, 0, 1e-3, 0},
+		{"truncate 1e-3", 0, 0, 0, 1e-3},
+		{"mixed 1e-4", 1e-4, 1e-4, 1e-4, 1e-4}};
+	const uint8_t nProfiles = sizeof(profiles)/sizeof(profiles[0]);
+
+	struct BenchDecoder{
+		const char *name;
+		BenchResult (*run)(const BenchProfile &p);
+		unsigned int frameBytes;										//Bytes the decoder reads for one good frame
+	} decoders[5] = {
+		{"Plantower", benchPlantower, 32},
+		{"SPS SHDLC", benchSPS, 47},
+		{"HPM", benchHPM, 16},
+		{"R1", benchR1, 66},											//The data and the two handshake bytes
+		{"N3", benchN3, 88}};
+
+	printf("Line noise benchmark: %lu s of flight for each run\n\n", runTime);
+	printf("%-10s %-14s %8s %10s %10s %13s\n", "decoder", "profile", "errors", "frames/s", "recovered", "wasted/error");
+
+	for (uint8_t d = 0; d < 5; d++){
+		double cleanWaste = 0;											//Bytes wasted per second with no noise
+		for (uint8_t i = 0; i < nProfiles; i++){
+			BenchResult result = decoders[d].run(profiles[i]);
+			double waste = (double)result.delivered - (double)result.good*decoders[d].frameBytes;
+			if (i == 0) cleanWaste = waste/runTime;
+
+			printf("%-10s %-14s %8lu %10.3f %9.1f%% ", decoders[d].name, profiles[i].name, result.errors,
+				   (double)result.good/runTime, result.sent ? 100.0*result.good/result.sent : 0.0);
+			if (result.errors) printf("%13.1f\n", (waste - cleanWaste*runTime)/result.errors);
+			else printf("%13s\n", "-");
+		}
+		printf("\n");
+	}
+	return 0;
+}
@@ -0,0 +1,97 @@
+#!/bin/sh
+#Optical Particle Counter Library
+
+#University of Minnesota - Candler MURI
+
+#This is the build size report. It compiles each part of the library on its
+#own and lists the flash and RAM it costs, then the RAM of one object of each
+#sensor, then what each optional feature (OPCConfig.h) adds to the sensors.
+#
+#Run it from the library folder. Any arguments are passed to the compiler,
+#so a payload can check its own configuration:
+#		extras/size/opcsize.sh -DOPC_USE_SPS=0 -DOPC_USE_R1=0
+#
+#It builds for the Teensy 3.6 by default. INCLUDES must point at the Teensy
+#core and the SPI and i2c_t3 libraries:
+#		INCLUDES="-I$CORE/teensy3 -I$LIBS/SPI -I$LIBS/i2c_t3" extras/size/opcsize.sh
+#For another board, set CXX, SIZE, NM, and CXXFLAGS as well. For the host,
+#with the simulator headers:
+#		CXX=g++ SIZE=size NM=nm CXXFLAGS="-Os -std=gnu++11 -DARDUINO" INCLUDES=-Iextras/sim extras/size/opcsize.sh
+#
+#Flash is text and data, RAM is data and bss. Each part is compiled with
+#-ffunction-sections, and the linker drops what a sketch never calls, so
+#the flash of a part is the most it can cost.
+
+CXX=${CXX:-arm-none-eabi-g++}
+SIZE=${SIZE:-arm-none-eabi-size}
+NM=${NM:-arm-none-eabi-nm}
+CXXFLAGS=${CXXFLAGS:-"-Os -mcpu=cortex-m4 -mthumb -mfloat-abi=hard -mfpu=fpv4-sp-d16 -fno-exceptions -fno-rtti -fsingle-precision-constant -std=gnu++14 -DARDUINO=10813 -DTEENSYDUINO=157 -D__MK66FX1M0__ -DF_CPU=180000000"}
+FLAGS="$CXXFLAGS -ffunction-sections -fdata-sections $INCLUDES -I. $*"
+
+SENSORS="OPCSensor.cpp OPCPlantower.cpp OPCSPS.cpp OPCSPSWire.cpp OPCR1.cpp OPCHPM.cpp OPCN3.cpp OPCAlpha.cpp OPCText.cpp OPCConsole.cpp OPCRetry.cpp"
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+objsize(){																#Flash and RAM of one object file
+	$SIZE "$1" | awk 'NR == 2 { print $1 + $2, $2 + $3 }'
+}
+
+build(){																#Flash of the sensor parts, with extra flags
+	total=0
+	for src in $SENSORS; do
+		$CXX $FLAGS "$@" -c "$src" -o "$WORK/feature.o" || exit 1
+		total=$((total + $(objsize "$WORK/feature.o" | cut -d' ' -f1)))
+	done
+	echo $total
+}
+
+
+
+printf '%-20s %8s %8s\n' "Part" "Flash" "RAM"
+flashTotal=0
+ramTotal=0
+for src in OPC*.cpp; do
+	obj="$WORK/${src%.cpp}.o"
+	$CXX $FLAGS -c "$src" -o "$obj" || exit 1
+	set -- $(objsize "$obj")
+	printf '%-20s %8d %8d\n' "${src%.cpp}" "$1" "$2"
+	flashTotal=$((flashTotal + $1))
+	ramTotal=$((ramTotal + $2))
+done
+printf '%-20s %8d %8d\n\n' "Total" "$flashTotal" "$ramTotal"
+
+
+
+cat > "$WORK/objects.cpp" <<EOF											#One array the size of each sensor object
+#include "OPCSensor.h"
+#if OPC_USE_PLANTOWER
+char opcSizePlantower[sizeof(Plantower)];
+#endif
+#if OPC_USE_SPS
+char opcSizeSPS[sizeof(SPS)];
+#endif
+#if OPC_USE_R1
+char opcSizeR1[sizeof(R1)];
+#endif
+#if OPC_USE_HPM
+char opcSizeHPM[sizeof(HPM)];
+#endif
+#if OPC_USE_N3
+char opcSizeN3[sizeof(N3)];
+#endif
+EOF
+$CXX $FLAGS -fno-common -c "$WORK/objects.cpp" -o "$WORK/objects.o" || exit 1
+printf '%-20s %8s\n' "Sensor object" "RAM"
+$NM -S "$WORK/objects.o" | grep opcSize | while read address size type name; do
+	printf '%-20s %8d\n' "${name#*opcSize}" "0x$size"
+done
+echo
+
+
+
+base=$(build)															#Flash each feature adds to the sensors
+printf '%-20s %8s\n' "Feature" "Flash"
+for feature in READOUT SPS_I2C RESET; do
+	without=$(build -DOPC_USE_$feature=0)
+	printf '%-20s %8d\n' "OPC_USE_$feature" $((base - without))
+done
@@ -0,0 +1,68 @@
+//Optical Particle Counter Library
+
+//University of Minnesota - Candler MURI
+
+/*This is the ground side of the telemetry packer. It reads a file of
+fixed-size packets, as saved from the downlink, and prints one CSV line for
+each field. Packets with a bad sync byte or CRC are counted and skipped, and
+gaps in the sequence numbers are listed as lost packets.
+
+Build on a computer from the library folder:
+	g++ -I. extras/telemetry/opcunpack.cpp OPCTelemetry.cpp OPCRecord.cpp -o opcunpack
+
+Usage: opcunpack file size
+ - size: packet size in bytes, as given to the OPCTelemetry constructor
+*/
+
+#include "OPCTelemetry.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+int main(int argc, char **argv){
+	if (argc < 3){
+		fprintf(stderr, "Usage: %s file size\n", argv[0]);
+		return 1;
+	}
+	FILE *file = fopen(argv[1], "rb");
+	if (!file){
+		fprintf(stderr, "Can not open %s\n", argv[1]);
+		return 1;
+	}
+	int size = atoi(argv[2]);
+	if (size < OPC_TELEMETRY_MIN || size > OPC_TELEMETRY_MAX){
+		fprintf(stderr, "Packet size must be %d to %d bytes\n", OPC_TELEMETRY_MIN, OPC_TELEMETRY_MAX);
+		return 1;
+	}
+
+	uint8_t buf[OPC_TELEMETRY_MAX];
+	OPCTelemetryPacket packet;
+	const char *kinds[3] = {"sample", "histogram", "health"};
+	unsigned long good = 0, bad = 0, lost = 0;
+	long lastSequence = -1;
+
+	printf("sequence,time (ms),sensor,type,kind,count,merge,values\n");
+	while (fread(buf, 1, size, file) == (size_t)size){
+		if (!opcUnpack(buf, size, packet)){
+			bad++;
+			continue;
+		}
+		good++;
+		if (lastSequence >= 0) lost += (uint16_t)(packet.sequence - lastSequence - 1);	//The sequence wraps at 65536
+		lastSequence = packet.sequence;
+
+		for (uint8_t i = 0; i < packet.nFields; i++){
+			OPCTelemetryField &field = packet.fields[i];
+			printf("%u,%lu,%u,%u,%s,", packet.sequence, (unsigned long)packet.time, field.sensor, field.type, kinds[field.kind]);
+			if (field.kind == OPC_FIELD_HEALTH){						//Hits, give ups, sample age (s), init state, and status bits in the values
+				printf(",,%lu;%u;%u;%u;%u\n", (unsigned long)field.hits, field.giveUps, field.sampleAge, field.initState, field.status);
+				continue;
+			}
+			printf("%u,%u,", field.count, field.merge);
+			for (uint8_t j = 0; j < field.nValues; j++) printf("%s%g", j ? ";" : "", field.values[j]);
+			printf("\n");
+		}
+	}
+	fclose(file);
+	fprintf(stderr, "%lu good packets, %lu bad, %lu lost\n", good, bad, lost);
+	return 0;
+}